@@ -42,6 +42,8 @@
 #ifdef ACTIVE_RESPONSE
 #include "encode.h"
 #include "sfdaq.h"
+#include "idle_processing_funcs.h"
+#include "util.h"
 #endif
 
 // these can't be pkt flags because we do the handling
@@ -78,6 +80,27 @@ typedef int (*send_t) (
 static send_t s_send = DAQ_Inject;
 static uint64_t s_injects = 0;
 
+// responses are copied into a fixed pool of slots and injected together
+// at the end of each burst so the encoder and the daq/device don't
+// interleave per response.  anything too big for a slot is sent directly.
+#define RSP_SLOT_LEN (ETHERNET_HEADER_LEN + VLAN_HEADER_LEN + ETHERNET_MTU)
+
+typedef struct
+{
+    DAQ_PktHdr_t hdr;
+    uint32_t len;
+    int rev;
+    uint8_t buf[RSP_SLOT_LEN];
+} RspSlot;
+
+static RspSlot* s_queue = NULL;
+static uint32_t s_queue_size = 0;
+static uint32_t s_queued = 0;
+
+static uint32_t s_rate = 0;
+static uint32_t s_rate_count = 0;
+static time_t s_rate_sec = 0;
+
 static inline PROTO_ID GetInnerProto (const Packet* p)
 {
     if ( !p->next_layer ) return PROTO_MAX;
@@ -170,6 +193,66 @@ void Active_KillSession (Packet* p, EncodeFlags* pf)
 
 //--------------------------------------------------------------------
 
+void Active_FlushQueue (void)
+{
+    uint32_t i;
+
+    for ( i = 0; i < s_queued; i++ )
+    {
+        RspSlot* rs = s_queue + i;
+
+        if ( s_send(&rs->hdr, rs->rev, rs->buf, rs->len) )
+            pc.rsp_dropped++;
+        else
+            pc.rsp_sent++;
+    }
+    s_queued = 0;
+}
+
+static inline int Active_RateLimited (const DAQ_PktHdr_t* h)
+{
+    if ( !s_rate )
+        return 0;
+
+    if ( h->ts.tv_sec != s_rate_sec )
+    {
+        s_rate_sec = h->ts.tv_sec;
+        s_rate_count = 0;
+    }
+    return ( ++s_rate_count > s_rate );
+}
+
+static void Active_Send (
+    const DAQ_PktHdr_t* h, int rev, const uint8_t* buf, uint32_t len)
+{
+    RspSlot* rs;
+
+    if ( Active_RateLimited(h) )
+    {
+        pc.rsp_dropped++;
+        return;
+    }
+    if ( !s_queue_size || len > RSP_SLOT_LEN )
+    {
+        if ( s_send(h, rev, buf, len) )
+            pc.rsp_dropped++;
+        else
+            pc.rsp_sent++;
+        return;
+    }
+    if ( s_queued == s_queue_size )
+        Active_FlushQueue();
+
+    rs = s_queue + s_queued++;
+    rs->hdr = *h;
+    rs->rev = rev;
+    rs->len = len;
+    memcpy(rs->buf, buf, len);
+    pc.rsp_queued++;
+}
+
+//--------------------------------------------------------------------
+
 int Active_Init (SnortConfig* sc)
 {
     s_attempts = sc->respond_attempts;
@@ -191,11 +274,31 @@ int Active_Init (SnortConfig* sc)
         if (NULL != sc->eth_dst)
             Encode_SetDstMAC(sc->eth_dst);
     }
+    s_rate = sc->respond_rate;
+
+    if ( s_attempts && sc->respond_queue && !s_queue )
+    {
+        s_queue_size = sc->respond_queue;
+        s_queue = (RspSlot*)SnortAlloc(s_queue_size * sizeof(*s_queue));
+        IdleProcessingRegisterHandler(Active_FlushQueue);
+    }
     return 0;
 }
 
 int Active_Term (void)
 {
+    // the queue was flushed before the daq stopped so anything left was
+    // queued during shutdown (eg stream5 flushing its sessions) and can't
+    // be sent anymore
+    pc.rsp_discarded += s_queued;
+    s_queued = 0;
+
+    if ( s_queue )
+    {
+        free(s_queue);
+        s_queue = NULL;
+        s_queue_size = 0;
+    }
     Active_Close();
     return 0;
 }
@@ -235,7 +338,7 @@ void Active_SendReset(Packet* p, EncodeFlags ef)
         rej = Encode_Reject(ENC_TCP_RST, flags|value, p, &len);
         if ( !rej ) return;
 
-        s_send(p->pkth, !(ef & ENC_FLAG_FWD), rej, len);
+        Active_Send(p->pkth, !(ef & ENC_FLAG_FWD), rej, len);
     }
 }
 
@@ -251,7 +354,7 @@ void Active_SendUnreach(Packet* p, EncodeType type)
     rej = Encode_Reject(type, flags, p, &len);
     if ( !rej ) return;
 
-    s_send(p->pkth, 1, rej, len);
+    Active_Send(p->pkth, 1, rej, len);
 }
 
 void Active_SendData (
@@ -271,7 +374,7 @@ void Active_SendData (
         seg = Encode_Response(ENC_TCP_FIN, flags, p, &plen, buf, blen);
 
         if ( !seg ) return;
-        s_send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
+        Active_Send(p->pkth, !(flags & ENC_FLAG_FWD), seg, plen);
     }
 }
 
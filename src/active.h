@@ -32,6 +32,9 @@
 #ifdef ACTIVE_RESPONSE
 #include "encode.h"
 
+#define DEFAULT_RESPOND_QUEUE  0
+#define MAX_RESPOND_QUEUE      65535
+
 int Active_Init(SnortConfig*);
 int Active_Term(void);
 
@@ -46,6 +49,11 @@ int Active_ResetQueue(void);
 int Active_SendResponses(Packet*);
 uint64_t Active_GetInjects(void);
 
+// responses are queued and injected in batches; this must be called
+// while the headers of the packets that triggered them are still valid
+// (ie at the end of each burst) and is also called when idle.
+void Active_FlushQueue(void);
+
 // NULL flags implies ENC_FLAG_FWD
 void Active_KillSession(Packet*, EncodeFlags*);
 
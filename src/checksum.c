@@ -0,0 +1,168 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    checksum.c
+//
+// bulk ones complement sums for the checksum routines in checksum.h.
+// the 16 bit words are zero extended into 32 bit lanes and added with
+// sse2 or, when the cpu supports it, avx2.  the lanes can't overflow
+// for anything up to IP_MAXPACKET since each lane gets at most one
+// 0xffff per 16 (32) bytes.  the kernel is selected on first use.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sf_types.h"
+#include "checksum.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define CKSUM_SSE2
+
+#if (__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))
+#include <immintrin.h>
+#define CKSUM_AVX2
+#endif
+#endif
+
+typedef unsigned int (*CksumBulkFunc)(const unsigned short*, int);
+
+static unsigned int in_chksum_bulk_select(const unsigned short*, int);
+
+static CksumBulkFunc bulk_func = in_chksum_bulk_select;
+
+static inline unsigned int fold (uint64_t sum)
+{
+    sum = (sum >> 32) + (sum & 0xffffffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    sum = (sum >> 16) + (sum & 0xffff);
+    return (unsigned int)sum;
+}
+
+//--------------------------------------------------------------------
+// kernels; blen is a multiple of 32
+//--------------------------------------------------------------------
+
+static unsigned int in_chksum_bulk_c (const unsigned short* w, int blen)
+{
+    uint64_t cksum = 0;
+
+    while ( blen )
+    {
+        cksum += w[0];  cksum += w[1];  cksum += w[2];  cksum += w[3];
+        cksum += w[4];  cksum += w[5];  cksum += w[6];  cksum += w[7];
+        cksum += w[8];  cksum += w[9];  cksum += w[10]; cksum += w[11];
+        cksum += w[12]; cksum += w[13]; cksum += w[14]; cksum += w[15];
+        w += 16;
+        blen -= 32;
+    }
+    return fold(cksum);
+}
+
+#ifdef CKSUM_SSE2
+static unsigned int in_chksum_bulk_sse2 (const unsigned short* w, int blen)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero, acc1 = zero;
+    uint32_t lanes[4];
+    uint64_t cksum;
+
+    while ( blen )
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)w);
+        __m128i b = _mm_loadu_si128((const __m128i*)(w + 8));
+
+        acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(a, zero));
+        acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(a, zero));
+        acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(b, zero));
+        acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(b, zero));
+
+        w += 16;
+        blen -= 32;
+    }
+    _mm_storeu_si128((__m128i*)lanes, acc0);
+    cksum = (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    _mm_storeu_si128((__m128i*)lanes, acc1);
+    cksum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+    return fold(cksum);
+}
+#endif
+
+#ifdef CKSUM_AVX2
+__attribute__((target("avx2")))
+static unsigned int in_chksum_bulk_avx2 (const unsigned short* w, int blen)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero, acc1 = zero;
+    uint32_t lanes[8];
+    uint64_t cksum = 0;
+    int i;
+
+    while ( blen )
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)w);
+
+        acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(a, zero));
+        acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(a, zero));
+
+        w += 16;
+        blen -= 32;
+    }
+    acc0 = _mm256_add_epi32(acc0, acc1);
+    _mm256_storeu_si256((__m256i*)lanes, acc0);
+
+    for ( i = 0; i < 8; i++ )
+        cksum += lanes[i];
+
+    return fold(cksum);
+}
+#endif
+
+static unsigned int in_chksum_bulk_select (const unsigned short* w, int blen)
+{
+    bulk_func = in_chksum_bulk_c;
+
+#ifdef CKSUM_SSE2
+    bulk_func = in_chksum_bulk_sse2;
+#endif
+#ifdef CKSUM_AVX2
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports("avx2") )
+        bulk_func = in_chksum_bulk_avx2;
+#endif
+
+    return bulk_func(w, blen);
+}
+
+//--------------------------------------------------------------------
+// public
+//--------------------------------------------------------------------
+
+unsigned int in_chksum_bulk (const unsigned short* w, int blen)
+{
+    return bulk_func(w, blen);
+}
+
@@ -54,6 +54,26 @@ typedef struct
     uint16_t len;
 } pseudoheader;
 
+/*
+*  bulk sum of blen bytes (a multiple of 32) using the best available
+*  vector kernel; the result is folded to 16 bits (see checksum.c)
+*/
+unsigned int in_chksum_bulk(const unsigned short *w, int blen);
+
+/* below this the unrolled loops are as fast */
+#define CKSUM_BULK_MIN 256
+
+#define IN_CHKSUM_BULK(cksum, w, blen) \
+   do { \
+     if ( (blen) >= CKSUM_BULK_MIN ) \
+     { \
+       int n = (blen) & ~31; \
+       (cksum) += in_chksum_bulk((w), n); \
+       (w)     += n >> 1; \
+       (blen)  -= n; \
+     } \
+   } while (0)
+
 /*
 *  checksum IP  - header=20+ bytes
 *
@@ -132,6 +152,8 @@ static inline unsigned short in_chksum_tcp(pseudoheader *ph,
    dlen  -= 20; /* bytes   */
    d     += 10; /* short's */
 
+   IN_CHKSUM_BULK(cksum, d, dlen);
+
    while(dlen >=32)
    {
      cksum += d[0];
@@ -235,6 +257,8 @@ static inline unsigned short in_chksum_tcp6(pseudoheader6 *ph,
    dlen  -= 20; /* bytes   */
    d     += 10; /* short's */
 
+   IN_CHKSUM_BULK(cksum, d, dlen);
+
    while(dlen >=32)
    {
      cksum += d[0];
@@ -333,6 +357,8 @@ static inline unsigned short in_chksum_udp6(pseudoheader6 *ph,
    dlen  -= 8; /* bytes   */
    d     += 4; /* short's */
 
+   IN_CHKSUM_BULK(cksum, d, dlen);
+
    while(dlen >=32)
    {
      cksum += d[0];
@@ -409,6 +435,8 @@ static inline unsigned short in_chksum_udp(pseudoheader *ph,
    dlen  -= 8; /* bytes   */
    d     += 4; /* short's */
 
+   IN_CHKSUM_BULK(cksum, d, dlen);
+
    while(dlen >=32)
    {
      cksum += d[0];
@@ -467,6 +495,8 @@ static inline unsigned short in_chksum_icmp( unsigned short * w, int blen )
   unsigned  short answer=0;
   unsigned int cksum = 0;
 
+  IN_CHKSUM_BULK(cksum, w, blen);
+
   while(blen >=32)
   {
      cksum += w[0];
@@ -548,6 +578,8 @@ static inline unsigned short in_chksum_icmp6(pseudoheader6 *ph,
   cksum += h[16];
   cksum += h[17];
 
+  IN_CHKSUM_BULK(cksum, w, blen);
+
   while(blen >=32)
   {
      cksum += w[0];
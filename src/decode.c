@@ -569,6 +569,99 @@ static inline void PushLayer(PROTO_ID type, Packet* p, const uint8_t* hdr, uint3
     }
 }
 
+//--------------------------------------------------------------------
+// decode.c::burst
+//--------------------------------------------------------------------
+
+/*
+ * Staged look ahead over a burst of ethernet frames.  The full decoders
+ * still run one frame at a time on the single Packet, but before that
+ * the burst is walked stage by stage: all L2 headers are parsed to find
+ * the L3 header, then all L3 headers are parsed to find the transport
+ * header, prefetching each as it is found.  By the time a frame reaches
+ * DecodeEthPkt() its headers are in cache.  Only plain, vlan tagged and
+ * unfragmented IPv4/IPv6 frames are staged; anything else is left to the
+ * normal decoder.
+ */
+#define BURST_MAX_VLANS  2
+
+void DecodeEthBurstStages (
+    unsigned n, const DAQ_PktHdr_t** pkthdrs, const uint8_t** pkts)
+{
+    uint16_t l3[DAQ_BURST_MAX];
+    unsigned i;
+
+    if ( n > DAQ_BURST_MAX )
+        n = DAQ_BURST_MAX;
+
+    // L2: skip ethernet and vlan tags
+    for ( i = 0; i < n; i++ )
+    {
+        const uint8_t* pkt = pkts[i];
+        uint32_t len = pkthdrs[i]->caplen;
+        uint32_t off = ETHERNET_HEADER_LEN;
+        uint16_t type;
+        int tags = 0;
+
+        l3[i] = 0;
+
+        if ( len < ETHERNET_HEADER_LEN )
+            continue;
+
+        type = (pkt[off-2] << 8) | pkt[off-1];
+
+        while ( (type == ETHERNET_TYPE_8021Q) && (tags++ < BURST_MAX_VLANS) &&
+            (len >= off + VLAN_HEADER_LEN) )
+        {
+            off += VLAN_HEADER_LEN;
+            type = (pkt[off-2] << 8) | pkt[off-1];
+        }
+        if ( (type != ETHERNET_TYPE_IP) && (type != ETHERNET_TYPE_IPV6) )
+            continue;
+
+        l3[i] = (uint16_t)off;
+#ifdef __GNUC__
+        __builtin_prefetch(pkt + off);
+#endif
+    }
+
+    // L3: find the transport header
+    for ( i = 0; i < n; i++ )
+    {
+        const uint8_t* ip = pkts[i] + l3[i];
+        uint32_t len = pkthdrs[i]->caplen;
+        uint32_t off;
+
+        if ( !l3[i] || (len < l3[i] + IP_HEADER_LEN) )
+            continue;
+
+        switch ( ip[0] >> 4 )
+        {
+        case 4:
+            // fragments are reassembled by frag3 so there is
+            // nothing useful to fetch ahead
+            if ( ((ip[6] << 8) | ip[7]) & 0x3fff )
+                continue;
+            off = l3[i] + ((ip[0] & 0x0f) << 2);
+            break;
+
+        case 6:
+            // extension headers are left to DecodeIPV6()
+            if ( (ip[6] != IPPROTO_TCP) && (ip[6] != IPPROTO_UDP) )
+                continue;
+            off = l3[i] + IP6_HDR_LEN;
+            break;
+
+        default:
+            continue;
+        }
+#ifdef __GNUC__
+        if ( off < len )
+            __builtin_prefetch(pkts[i] + off);
+#endif
+    }
+}
+
 //--------------------------------------------------------------------
 // decode.c::ARP
 //--------------------------------------------------------------------
@@ -2009,9 +2102,11 @@ static inline void ICMP4MiscTests (Packet *p)
         if (p->icmph->type == ICMP_ECHOREPLY)
         {
             int i;
+            const Options *ipo = p->ip_option_count ? GetIpOptions(p) : NULL;
+
             for (i = 0; i < p->ip_option_count; i++)
             {
-                if (p->ip_options[i].code == IPOPT_RR)
+                if (ipo[i].code == IPOPT_RR)
                     DecoderEvent(p, EVARGS(ICMP_TRACEROUTE_IPOPTS), 1, 1);
             }
         }
@@ -2064,21 +2159,22 @@ static inline void IPMiscTests(Packet *p)
     {
         /* Yes, it's an ICMP-related vuln in IP options. */
         uint8_t i, length, pointer;
+        const Options *ipo = p->ip_option_count ? GetIpOptions(p) : NULL;
 
         /* Alert on IP packets with either 0x07 (Record Route) or 0x44 (Timestamp)
            options that are specially crafted. */
         for (i = 0; i < p->ip_option_count; i++)
         {
-            if (p->ip_options[i].data == NULL)
+            if (ipo[i].data == NULL)
                 continue;
 
-            if (p->ip_options[i].code == IPOPT_RR)
+            if (ipo[i].code == IPOPT_RR)
             {
-                length = p->ip_options[i].len;
+                length = ipo[i].len;
                 if (length < 1)
                     continue;
 
-                pointer = p->ip_options[i].data[0];
+                pointer = ipo[i].data[0];
 
                 /* If the pointer goes past the end of the data, then the data
                    is full. That's okay. */
@@ -2089,13 +2185,13 @@ static inline void IPMiscTests(Packet *p)
                 if (((length + 3) - pointer) % 4)
                     DecoderEvent(p, EVARGS(ICMP_DOS_ATTEMPT), 1, 1);
             }
-            else if (p->ip_options[i].code == IPOPT_TS)
+            else if (ipo[i].code == IPOPT_TS)
             {
-                length = p->ip_options[i].len;
+                length = ipo[i].len;
                 if (length < 2)
                     continue;
 
-                pointer = p->ip_options[i].data[0];
+                pointer = ipo[i].data[0];
 
                 /* If the pointer goes past the end of the data, then the data
                    is full. That's okay. */
@@ -2107,7 +2203,7 @@ static inline void IPMiscTests(Packet *p)
                     DecoderEvent(p, EVARGS(ICMP_DOS_ATTEMPT), 1, 1);
                 /* If there is a timestamp + address, we need a multiple of 8
                    bytes instead. */
-                if ((p->ip_options[i].data[1] & 0x01) && /* address flag */
+                if ((ipo[i].data[1] & 0x01) && /* address flag */
                    (((length + 3) - pointer) % 8))
                     DecoderEvent(p, EVARGS(ICMP_DOS_ATTEMPT), 1, 1);
             }
@@ -2188,6 +2284,7 @@ static inline void CheckPGMVuln(Packet *p)
 static inline void CheckIGMPVuln(Packet *p)
 {
     int i, alert = 0;
+    const Options *ipo = NULL;
 
     if (p->dsize >= 1 && p->data[0] == 0x11)
     {
@@ -2201,14 +2298,17 @@ static inline void CheckIGMPVuln(Packet *p)
             }
         }
 
+        if (p->ip_option_count > 0)
+            ipo = GetIpOptions(p);
+
         for(i=0; i< (int) p->ip_option_count; i++) {
             /* All IGMPv2 packets contain IP option code 148 (router alert).
                This vulnerability only applies to IGMPv3, so return early. */
-            if (p->ip_options[i].code == 148) {
+            if (ipo[i].code == 148) {
                 return; /* No alert. */
             }
 
-            if (p->ip_options[i].len == 1) {
+            if (ipo[i].len == 1) {
                 alert++;
             }
         }
@@ -2425,6 +2525,14 @@ void DecodeIP(const uint8_t * pkt, const uint32_t len, Packet * p)
     {
         p->ip_options_data = pkt + IP_HEADER_LEN;
         DecodeIPOptions((pkt + IP_HEADER_LEN), p->ip_options_len, p);
+
+        if ( p->ip_option_count )
+        {
+            p->opts_pending |= OPTS_PENDING_IP;
+            pc.ip_opts++;
+        }
+        else
+            p->opts_pending &= ~OPTS_PENDING_IP;
     }
     else
     {
@@ -2443,6 +2551,7 @@ void DecodeIP(const uint8_t * pkt, const uint32_t len, Packet * p)
         }
 #endif
         p->ip_option_count = 0;
+        p->opts_pending &= ~OPTS_PENDING_IP;
     }
 
     /* set the real IP length for logging */
@@ -3787,6 +3896,7 @@ void DecodeIPV6(const uint8_t *pkt, uint32_t len, Packet *p)
     }
 #endif
     p->ip_option_count = 0;
+    p->opts_pending &= ~OPTS_PENDING_IP;
 
     /* set the real IP length for logging */
     p->actual_ip_len = ntohs(p->ip6h->len);
@@ -4981,6 +5091,19 @@ static inline void TCPMiscTests(Packet *p)
     }
 }
 
+/* The DAQ sets this when the NIC has already verified the TCP checksum.
+ * It describes the outermost TCP header only so tunneled packets are
+ * still checked here. */
+static inline int TcpChecksumOffloaded(const Packet *p)
+{
+#ifdef DAQ_PKT_FLAG_HW_TCP_CS_GOOD
+    return ( (p->pkth->flags & DAQ_PKT_FLAG_HW_TCP_CS_GOOD) &&
+        !p->encapsulated && !(p->packet_flags & PKT_UNSURE_ENCAP) );
+#else
+    return 0;
+#endif
+}
+
 /*
  * Function: DecodeTCP(uint8_t *, const uint32_t, Packet *)
  *
@@ -5057,7 +5180,11 @@ void DecodeTCP(const uint8_t * pkt, const uint32_t len, Packet * p)
     /* Checksum code moved in front of the other decoder alerts.
        If it's a bad checksum (maybe due to encrypted ESP traffic), the other
        alerts could be false positives. */
-    if (ScTcpChecksums())
+    if (ScTcpChecksums() && TcpChecksumOffloaded(p))
+    {
+        pc.hw_tcp_cksums++;
+    }
+    else if (ScTcpChecksums())
     {
         uint16_t csum;
         if(IS_IP4(p))
@@ -5198,6 +5325,12 @@ void DecodeTCP(const uint8_t * pkt, const uint32_t len, Packet * p)
 
         p->tcp_options_data = pkt + TCP_HEADER_LEN;
         DecodeTCPOptions((uint8_t *) (pkt + TCP_HEADER_LEN), p->tcp_options_len, p);
+
+        if ( p->tcp_option_count )
+        {
+            p->opts_pending |= OPTS_PENDING_TCP;
+            pc.tcp_opts++;
+        }
     }
     else
     {
@@ -5376,6 +5509,7 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
 
     int code = 2;
     uint8_t byte_skip;
+    Options opt = {0};  /* scratch; the array is filled in on demand */
 
     /* Here's what we're doing so that when we find out what these
      * other buggers of TCP option codes are, we can do something
@@ -5404,7 +5538,7 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
 
     while((option_ptr < end_ptr) && (opt_count < TCP_OPTLENMAX) && (code >= 0) && !done)
     {
-        p->tcp_options[opt_count].code = *option_ptr;
+        opt.code = *option_ptr;
 
         if((option_ptr + 1) < end_ptr)
         {
@@ -5420,26 +5554,26 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
         case TCPOPT_EOL:
             done = 1; /* fall through to the NOP case */
         case TCPOPT_NOP:
-            p->tcp_options[opt_count].len = 0;
-            p->tcp_options[opt_count].data = NULL;
+            opt.len = 0;
+            opt.data = NULL;
             byte_skip = 1;
             code = 0;
             break;
         case TCPOPT_MAXSEG:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_MAXSEG,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         case TCPOPT_SACKOK:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_SACKOK,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         case TCPOPT_WSCALE:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_WSCALE,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             if (code == 0)
             {
                 if (
-                    ((uint16_t) p->tcp_options[opt_count].data[0] > 14))
+                    ((uint16_t) opt.data[0] > 14))
                 {
                     /* LOG INVALID WINDOWSCALE alert */
                     if (ScDecoderTcpOptAlerts())
@@ -5455,17 +5589,17 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
         case TCPOPT_ECHOREPLY:
             obsolete_option_found = 1;
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_ECHO,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         case TCPOPT_MD5SIG:
             experimental_option_found = 1;
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_MD5SIG,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         case TCPOPT_SACK:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, -1,
-                                  &p->tcp_options[opt_count], &byte_skip);
-            if(p->tcp_options[opt_count].data == NULL)
+                                  &opt, &byte_skip);
+            if(opt.data == NULL)
                 code = TCP_OPT_BADLEN;
 
             break;
@@ -5475,17 +5609,17 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
         case TCPOPT_CC:  /* all 3 use the same lengths / T/TCP */
         case TCPOPT_CC_NEW:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_CC,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         case TCPOPT_TRAILER_CSUM:
             experimental_option_found = 1;
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_TRAILER_CSUM,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
 
         case TCPOPT_TIMESTAMP:
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, TCPOLEN_TIMESTAMP,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
 
         case TCPOPT_SKEETER:
@@ -5493,7 +5627,7 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
         case TCPOPT_UNASSIGNED:
             obsolete_option_found = 1;
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, -1,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         default:
         case TCPOPT_SCPS:
@@ -5506,7 +5640,7 @@ void DecodeTCPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
         case TCPOPT_SNAP:
             experimental_option_found = 1;
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, -1,
-                                  &p->tcp_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
             break;
         }
 
@@ -5584,6 +5718,7 @@ void DecodeIPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
     uint8_t byte_skip;
     const uint8_t *len_ptr;
     int code = 0;  /* negative error codes are returned from bad options */
+    Options opt = {0};   /* scratch; the array is filled in on demand */
 
 
     DEBUG_WRAP(DebugMessage(DEBUG_DECODE,  "Decoding %d bytes of IP options\n", o_len););
@@ -5591,7 +5726,7 @@ void DecodeIPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
 
     while((option_ptr < end_ptr) && (opt_count < IP_OPTMAX) && (code >= 0))
     {
-        p->ip_options[opt_count].code = *option_ptr;
+        opt.code = *option_ptr;
 
         if((option_ptr + 1) < end_ptr)
         {
@@ -5610,14 +5745,14 @@ void DecodeIPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
             if(*option_ptr == IPOPT_EOL)
                 done = 1;
 
-            p->ip_options[opt_count].len = 0;
-            p->ip_options[opt_count].data = NULL;
+            opt.len = 0;
+            opt.data = NULL;
             byte_skip = 1;
             break;
         default:
             /* handle all the dynamic features */
             code = OptLenValidate(option_ptr, end_ptr, len_ptr, -1,
-                                  &p->ip_options[opt_count], &byte_skip);
+                                  &opt, &byte_skip);
         }
 
         if(code < 0)
@@ -5650,6 +5785,93 @@ void DecodeIPOptions(const uint8_t *start, uint32_t o_len, Packet *p)
     return;
 }
 
+/*
+ * Fill in the option array for options already validated by
+ * DecodeIPOptions() / DecodeTCPOptions().  All count options are known
+ * to be well formed so only the code, length and data are recorded.
+ * EOL and NOP have the same values for ip and tcp.
+ */
+static void MaterializeOptions(
+    const uint8_t *start, uint32_t o_len, Options *opts, uint8_t count)
+{
+    const uint8_t *option_ptr = start;
+    const uint8_t *end_ptr = start + o_len;
+    uint8_t byte_skip;
+    uint8_t i;
+
+    for ( i = 0; i < count && option_ptr < end_ptr; i++ )
+    {
+        opts[i].code = *option_ptr;
+
+        if ( *option_ptr == TCPOPT_EOL || *option_ptr == TCPOPT_NOP )
+        {
+            opts[i].len = 0;
+            opts[i].data = NULL;
+            byte_skip = 1;
+        }
+        else if ( OptLenValidate(option_ptr, end_ptr, option_ptr + 1, -1,
+                                 &opts[i], &byte_skip) < 0 )
+        {
+            break;
+        }
+        option_ptr += byte_skip;
+    }
+}
+
+void MaterializeIPOptions(Packet *p)
+{
+    p->opts_pending &= ~OPTS_PENDING_IP;
+    pc.ip_opts_decoded++;
+
+    MaterializeOptions(p->ip_options_data, p->ip_options_len,
+                       p->ip_options, p->ip_option_count);
+}
+
+void MaterializeTCPOptions(Packet *p)
+{
+    p->opts_pending &= ~OPTS_PENDING_TCP;
+    pc.tcp_opts_decoded++;
+
+    MaterializeOptions(p->tcp_options_data, p->tcp_options_len,
+                       p->tcp_options, p->tcp_option_count);
+}
+
+/*
+ * Return the data of the first tcp option with the given code (not EOL or
+ * NOP) or NULL if there is no such option or it has no data.  If the
+ * option array hasn't been filled in yet the raw options are scanned
+ * instead so that a single lookup doesn't require decoding all of them.
+ */
+const uint8_t *GetTcpOptionData(Packet *p, uint8_t code)
+{
+    const uint8_t *option_ptr = p->tcp_options_data;
+    uint8_t i;
+
+    if ( !(p->opts_pending & OPTS_PENDING_TCP) )
+    {
+        for ( i = 0; i < p->tcp_option_count; i++ )
+        {
+            if ( p->tcp_options[i].code == code )
+                return p->tcp_options[i].data;
+        }
+        return NULL;
+    }
+
+    for ( i = 0; i < p->tcp_option_count; i++ )
+    {
+        if ( *option_ptr == TCPOPT_EOL || *option_ptr == TCPOPT_NOP )
+        {
+            option_ptr++;
+            continue;
+        }
+        if ( *option_ptr == code )
+            return ( option_ptr[1] > 2 ) ? option_ptr + 2 : NULL;
+
+        option_ptr += option_ptr[1];
+    }
+    return NULL;
+}
+
 //--------------------------------------------------------------------
 // decode.c::NON-ETHER STUFF
 //--------------------------------------------------------------------
@@ -636,7 +636,8 @@ struct enc_header {
 #define PKT_IPREP_SOURCE_TRIGGERED  0x08000000
 #define PKT_IPREP_DATA_SET          0x10000000
 #define PKT_FILE_EVENT_SET          0x20000000
-// 0x40000000 are available
+#define PKT_FAST_PATH               0x40000000  /* flow bypass cache hit */
+// 0x80000000 are available
 
 #define PKT_PDU_FULL (PKT_PDU_HEAD | PKT_PDU_TAIL)
 
@@ -1654,102 +1655,52 @@ typedef struct _GTPHdr
 // dynamic-plugins/sf_engine/sf_snort_packet.h
 typedef struct _Packet
 {
+    // hot: the fields below are touched by (nearly) every packet in
+    // decode, session lookup, preprocessing and detection and must fit
+    // in PKT_HOT_MAX bytes; add new fields to the cold part unless
+    // they are really used per packet.
+
     const DAQ_PktHdr_t *pkth;    // packet meta data
     const uint8_t *pkt;         // raw packet data
 
-    //vvv------------------------------------------------
-    // TODO convenience stuff to be refactored for layers
-    //^^^------------------------------------------------
-
-    //vvv-----------------------------
-    EtherARP *ah;
     const EtherHdr *eh;         /* standard TCP/IP/Ethernet/ARP headers */
     const VlanTagHdr *vh;
-    EthLlc *ehllc;
-    EthLlcOther *ehllcother;
-    const PPPoEHdr *pppoeh;     /* Encapsulated PPP of Ether header */
-    const GREHdr *greh;
-    uint32_t *mpls;
 
-    const IPHdr *iph, *orig_iph;/* and orig. headers for ICMP_*_UNREACH family */
-    const IPHdr *inner_iph;     /* if IP-in-IP, this will be the inner IP header */
-    const IPHdr *outer_iph;     /* if IP-in-IP, this will be the outer IP header */
-    const TCPHdr *tcph, *orig_tcph;
-    const UDPHdr *udph, *orig_udph;
-    const UDPHdr *inner_udph;   /* if Teredo + UDP, this will be the inner UDP header */
-    const UDPHdr *outer_udph;   /* if Teredo + UDP, this will be the outer UDP header */
-    const ICMPHdr *icmph, *orig_icmph;
+    const IPHdr *iph;
+    const TCPHdr *tcph;
+    const UDPHdr *udph;
+    const ICMPHdr *icmph;
 
     const uint8_t *data;        /* packet payload pointer */
     const uint8_t *ip_data;     /* IP payload pointer */
-    const uint8_t *outer_ip_data;  /* Outer IP payload pointer */
-    const uint8_t *ip_frag_start;
-    const uint8_t *ip_options_data;
-    const uint8_t *tcp_options_data;
-    //^^^-----------------------------
 
     void *ssnptr;               /* for tcp session tracking info... */
     void *fragtracker;          /* for ip fragmentation tracking info... */
     void *flow;                 /* for flow info */
 
-    //vvv-----------------------------
-    IP4Hdr *ip4h, *orig_ip4h;
-    IP6Hdr *ip6h, *orig_ip6h;
-    ICMP6Hdr *icmp6h, *orig_icmp6h;
+    IP4Hdr *ip4h;
+    IP6Hdr *ip6h;
+    ICMP6Hdr *icmp6h;
 
     IPH_API* iph_api;
-    IPH_API* orig_iph_api;
-    IPH_API* outer_iph_api;
-    IPH_API* outer_orig_iph_api;
-
-    IP4Hdr inner_ip4h, inner_orig_ip4h;
-    IP6Hdr inner_ip6h, inner_orig_ip6h;
-    IP4Hdr outer_ip4h, outer_orig_ip4h;
-    IP6Hdr outer_ip6h, outer_orig_ip6h;
-
-    MplsHdr   mplsHdr;
 
     int family;
-    int orig_family;
-    int outer_family;
-    int bytes_to_inspect;       /* Number of bytes to check against rules */
-                                /* this is not set - always 0 (inspect all) */
-
-    /* int ip_payload_len; */   /* Replacement for IP_LEN(p->iph->ip_len) << 2 */
-    /* int ip_payload_off; */   /* IP_LEN(p->iph->ip_len) << 2 + p->data */
-    //^^^-----------------------------
 
     uint32_t preprocessor_bits; /* flags for preprocessors to check */
     uint32_t preproc_reassembly_pkt_bits;
-
-    uint32_t http_pipeline_count; /* Counter for HTTP pipelined requests */
     uint32_t packet_flags;      /* special flags for the packet */
 
-    uint32_t xtradata_mask;
-    uint32_t per_packet_xtradata;
-
     uint16_t proto_bits;
 
-    //vvv-----------------------------
     uint16_t dsize;             /* packet payload size */
     uint16_t ip_dsize;          /* IP payload size */
     uint16_t alt_dsize;         /* the dsize of a packet before munging (used for log)*/
-    uint16_t actual_ip_len;     /* for logging truncated pkts (usually by small snaplen)*/
-    uint16_t outer_ip_dsize;    /* Outer IP payload size */
-    //^^^-----------------------------
 
-    uint16_t frag_offset;       /* fragment offset number */
-    uint16_t ip_frag_len;
     uint16_t ip_options_len;
     uint16_t tcp_options_len;
 
-    //vvv-----------------------------
     uint16_t sp;                /* source port (TCP/UDP) */
     uint16_t dp;                /* dest port (TCP/UDP) */
-    uint16_t orig_sp;           /* source port (TCP/UDP) of original datagram */
-    uint16_t orig_dp;           /* dest port (TCP/UDP) of original datagram */
-    //^^^-----------------------------
-    // and so on ...
 
     int16_t application_protocol_ordinal;
 
@@ -1765,6 +1716,64 @@ typedef struct _Packet
 
     uint8_t ip_option_count;    /* number of options in this packet */
     uint8_t tcp_option_count;
+    uint8_t next_layer;         /* index into layers for next encap */
+    uint8_t opts_pending;       /* option arrays not yet decoded (OPTS_PENDING_*) */
+
+    // cold: the rest is only used for tunnels, icmp errors, options,
+    // logging and less common link layers.  it is still zeroed per
+    // packet up to PKT_ZERO_LEN.
+
+    EtherARP *ah;
+    EthLlc *ehllc;
+    EthLlcOther *ehllcother;
+    const PPPoEHdr *pppoeh;     /* Encapsulated PPP of Ether header */
+    const GREHdr *greh;
+    uint32_t *mpls;
+
+    const IPHdr *orig_iph;      /* orig. headers for ICMP_*_UNREACH family */
+    const IPHdr *inner_iph;     /* if IP-in-IP, this will be the inner IP header */
+    const IPHdr *outer_iph;     /* if IP-in-IP, this will be the outer IP header */
+    const TCPHdr *orig_tcph;
+    const UDPHdr *orig_udph;
+    const UDPHdr *inner_udph;   /* if Teredo + UDP, this will be the inner UDP header */
+    const UDPHdr *outer_udph;   /* if Teredo + UDP, this will be the outer UDP header */
+    const ICMPHdr *orig_icmph;
+
+    const uint8_t *outer_ip_data;  /* Outer IP payload pointer */
+    const uint8_t *ip_frag_start;
+    const uint8_t *ip_options_data;
+    const uint8_t *tcp_options_data;
+
+    IP4Hdr *orig_ip4h;
+    IP6Hdr *orig_ip6h;
+    ICMP6Hdr *orig_icmp6h;
+
+    IPH_API* orig_iph_api;
+    IPH_API* outer_iph_api;
+    IPH_API* outer_orig_iph_api;
+
+    int orig_family;
+    int outer_family;
+    int bytes_to_inspect;       /* Number of bytes to check against rules */
+                                /* this is not set - always 0 (inspect all) */
+
+    /* int ip_payload_len; */   /* Replacement for IP_LEN(p->iph->ip_len) << 2 */
+    /* int ip_payload_off; */   /* IP_LEN(p->iph->ip_len) << 2 + p->data */
+
+    uint32_t http_pipeline_count; /* Counter for HTTP pipelined requests */
+
+    uint32_t xtradata_mask;
+    uint32_t per_packet_xtradata;
+
+    uint16_t actual_ip_len;     /* for logging truncated pkts (usually by small snaplen)*/
+    uint16_t outer_ip_dsize;    /* Outer IP payload size */
+
+    uint16_t frag_offset;       /* fragment offset number */
+    uint16_t ip_frag_len;
+
+    uint16_t orig_sp;           /* source port (TCP/UDP) of original datagram */
+    uint16_t orig_dp;           /* dest port (TCP/UDP) of original datagram */
+
     uint8_t ip6_extension_count;
     uint8_t ip6_frag_index;
 
@@ -1773,8 +1782,6 @@ typedef struct _Packet
     uint8_t tcp_lastopt_bad;    /* flag to indicate that option decoding was
                                    halted due to a bad option */
 
-    uint8_t next_layer;         /* index into layers for next encap */
-
 #ifndef NO_NON_ETHER_DECODER
     const Fddi_hdr *fddihdr;    /* FDDI support headers */
     Fddi_llc_saps *fddisaps;
@@ -1804,6 +1811,17 @@ typedef struct _Packet
 #endif
 
     // nothing after this point is zeroed ...
+
+    // these shadow headers are fully written by the decoder before
+    // anything points at them (ip4h, ip6h, mpls) or the corresponding
+    // family is set, so they don't need to be cleared per packet
+    IP4Hdr inner_ip4h, inner_orig_ip4h;
+    IP6Hdr inner_ip6h, inner_orig_ip6h;
+    IP4Hdr outer_ip4h, outer_orig_ip4h;
+    IP6Hdr outer_ip6h, outer_orig_ip6h;
+
+    MplsHdr   mplsHdr;
+
     Options ip_options[IP_OPTMAX];         /* ip options decode structure */
     Options tcp_options[TCP_OPTLENMAX];    /* tcp options decode struct */
     IP6Option ip6_extensions[IP6_EXTMAX];  /* IPv6 Extension References */
@@ -1824,7 +1842,19 @@ typedef struct _Packet
 
 } Packet;
 
-#define PKT_ZERO_LEN offsetof(Packet, ip_options)
+#define PKT_ZERO_LEN offsetof(Packet, inner_ip4h)
+
+/* the hot part of Packet ends at ah; keep it within 3 cache lines */
+#define PKT_HOT_MAX  192
+#define PKT_HOT_LEN  offsetof(Packet, ah)
+
+typedef char PacketHotSizeCheck[(PKT_HOT_LEN <= PKT_HOT_MAX) ? 1 : -1];
+
+/* Packet.opts_pending; the decoder validates ip and tcp options and sets
+ * the option counts but only fills in ip_options[] / tcp_options[] when
+ * they are first accessed through GetIpOptions() / GetTcpOptions() */
+#define OPTS_PENDING_IP      0x01
+#define OPTS_PENDING_TCP     0x02
 
 #define PROTO_BIT__NONE     0x0000
 #define PROTO_BIT__IP       0x0001
@@ -1938,6 +1968,9 @@ void DecodeNullPkt(Packet *, const DAQ_PktHdr_t*, const uint8_t *);
 void DecodeRawPkt(Packet *, const DAQ_PktHdr_t*, const uint8_t *);
 void DecodeRawPkt6(Packet *, const DAQ_PktHdr_t*, const uint8_t *);
 
+// staged header look ahead over a burst of ethernet frames
+void DecodeEthBurstStages(unsigned n, const DAQ_PktHdr_t**, const uint8_t**);
+
 // chained decoders
 void DecodeARP(const uint8_t *, uint32_t, Packet *);
 void DecodeEthLoopback(const uint8_t *, uint32_t, Packet *);
@@ -1954,6 +1987,9 @@ void DecodeICMPEmbeddedIP(const uint8_t *, const uint32_t, Packet *);
 void DecodeICMPEmbeddedIP6(const uint8_t *, const uint32_t, Packet *);
 void DecodeIPOptions(const uint8_t *, uint32_t, Packet *);
 void DecodeTCPOptions(const uint8_t *, uint32_t, Packet *);
+void MaterializeIPOptions(Packet *);
+void MaterializeTCPOptions(Packet *);
+const uint8_t *GetTcpOptionData(Packet *, uint8_t code);
 void DecodeTeredo(const uint8_t *, uint32_t, Packet *);
 void DecodeESP(const uint8_t *, uint32_t, Packet *);
 void DecodeGTP(const uint8_t *, uint32_t, Packet *);
@@ -2042,6 +2078,24 @@ static inline bool PacketHasPAFPayload (const Packet* p)
 }
 #endif
 
+// use these instead of reading p->ip_options / p->tcp_options directly;
+// the arrays are only valid up to the option count after this call
+static inline const Options* GetIpOptions (Packet* p)
+{
+    if ( p->opts_pending & OPTS_PENDING_IP )
+        MaterializeIPOptions(p);
+
+    return p->ip_options;
+}
+
+static inline const Options* GetTcpOptions (Packet* p)
+{
+    if ( p->opts_pending & OPTS_PENDING_TCP )
+        MaterializeTCPOptions(p);
+
+    return p->tcp_options;
+}
+
 static inline void SetLogFuncs(Packet *p, uint32_t id, uint8_t per_packet)
 {
     if(!id)
@@ -800,6 +800,55 @@ void print_option_tree(detection_option_tree_node_t *node, int level)
 }
 #endif
 
+static int detection_option_uses_http(detection_option_tree_node_t *node)
+{
+    switch (node->option_type)
+    {
+        case RULE_OPTION_TYPE_CONTENT:
+            return ((PatternMatchData *)node->option_data)->buffer_func ==
+                CHECK_URI_PATTERN_MATCH;
+
+        case RULE_OPTION_TYPE_PCRE:
+            return (((PcreData *)node->option_data)->options &
+                SNORT_PCRE_URI_BUFS) != 0;
+
+        /* base64_decode may be relative to an http buffer and the
+         * preprocessor and so rule options can read any of them */
+        case RULE_OPTION_TYPE_CONTENT_URI:
+        case RULE_OPTION_TYPE_URILEN:
+        case RULE_OPTION_TYPE_BASE64_DECODE:
+#ifdef DYNAMIC_PLUGIN
+        case RULE_OPTION_TYPE_PREPROCESSOR:
+        case RULE_OPTION_TYPE_DYNAMIC:
+#endif
+            return 1;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/* Sets last_check.http_bufs for a tree.  The result of a node that isn't
+ * marked is the same for every http buffer set of a packet, so it is only
+ * evaluated once when pipelined requests are detected together.  Returns
+ * whether the node or its children use http buffers. */
+int detection_option_tree_mark_http(detection_option_tree_node_t *node, int parent_http)
+{
+    int i, http = detection_option_uses_http(node);
+    int children_http = 0;
+
+    for (i = 0; i < node->num_children; i++)
+    {
+        if (detection_option_tree_mark_http(node->children[i], parent_http || http))
+            children_http = 1;
+    }
+
+    node->last_check.http_bufs = (parent_http || http || children_http);
+    return (http || children_http);
+}
+
 int add_detection_option_tree(detection_option_tree_node_t *option_tree, void **existing_data)
 {
     SnortConfig *sc = snort_conf_for_parsing;
@@ -863,7 +912,8 @@ int detection_option_node_evaluate(detection_option_tree_node_t *node, detection
         if ((node->last_check.ts.tv_usec == eval_data->p->pkth->ts.tv_usec) &&
             (node->last_check.ts.tv_sec == eval_data->p->pkth->ts.tv_sec) &&
             (node->last_check.packet_number == rule_eval_pkt_count) &&
-            (node->last_check.pipeline_number == eval_data->p->http_pipeline_count) &&
+            ((node->last_check.pipeline_number == eval_data->p->http_pipeline_count) ||
+             (HttpBufferSetCount && !node->last_check.http_bufs)) &&
             (node->last_check.rebuild_flag == (eval_data->p->packet_flags & REBUILD_FLAGS)) &&
             (!(eval_data->p->packet_flags & PKT_ALLOW_MULTIPLE_DETECT)))
         {
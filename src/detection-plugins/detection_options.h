@@ -69,7 +69,7 @@ typedef struct _detection_option_tree_node
         char result;
         char is_relative;
         char flowbit_failed;
-        char pad; /* Keep 4 byte alignment */
+        char http_bufs; /* the option, its parents or children use http buffers */
     } last_check;
 #ifdef PERF_PROFILING
     uint64_t ticks;
@@ -87,6 +87,7 @@ typedef struct _detection_option_tree_root
 {
     int num_children;
     detection_option_tree_node_t **children;
+    int http_buffers;   /* HTTP_SEARCH_* of the patterns, combined matcher only */
 
 #ifdef PPM_MGR
     uint64_t ppm_suspend_time; /* PPM */
@@ -107,6 +108,7 @@ typedef struct _detection_option_eval_data
 int add_detection_option(option_type_t type, void *option_data, void **existing_data);
 int add_detection_option_tree(detection_option_tree_node_t *option_tree, void **existing_data);
 int detection_option_node_evaluate(detection_option_tree_node_t *node, detection_option_eval_data_t *eval_data);
+int detection_option_tree_mark_http(detection_option_tree_node_t *node, int parent_http);
 void DetectionHashTableFree(SFXHASH *);
 void DetectionTreeHashTableFree(SFXHASH *);
 #ifdef DEBUG_OPTION_TREE
@@ -25,6 +25,7 @@
 #include "config.h"
 #endif
 
+#include "decode.h"
 #include "sp_hdr_opt_wrap.h"
 #include "sf_engine/sf_snort_plugin_api.h"
 
@@ -73,5 +74,11 @@ int HdrOptEval(void *option_data, Packet *p)
 {
    HdrOptCheck *hdrData = (HdrOptCheck *)option_data;
 
+   /* the engine reads the option arrays directly */
+   if (hdrData->hdrField == IP_HDR_OPTIONS)
+       GetIpOptions(p);
+   else if (hdrData->hdrField == TCP_HDR_OPTIONS)
+       GetTcpOptions(p);
+
    return checkHdrOpt(p, hdrData);
 }
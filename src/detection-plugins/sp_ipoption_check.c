@@ -264,6 +264,7 @@ int CheckIpOptions(void *option_data, Packet *p)
     IpOptionData *ipOptionData = (IpOptionData *)option_data;
     int rval = DETECTION_OPTION_NO_MATCH;
     int i;
+    const Options *ipo = NULL;
     PROFILE_VARS;
 
     DEBUG_WRAP(DebugMessage(DEBUG_PLUGIN, "CheckIpOptions:"););
@@ -281,13 +282,16 @@ int CheckIpOptions(void *option_data, Packet *p)
         return rval;
     }
 
+    if(p->ip_option_count > 0)
+        ipo = GetIpOptions(p);
+
     for(i=0; i< (int) p->ip_option_count; i++)
     {
     	DEBUG_WRAP(DebugMessage(DEBUG_PLUGIN, "testing pkt(%d):rule(%d)\n",
 				ipOptionData->ip_option,
-				p->ip_options[i].code); );
+				ipo[i].code); );
 
-        if(ipOptionData->ip_option == p->ip_options[i].code)
+        if(ipOptionData->ip_option == ipo[i].code)
         {
             rval = DETECTION_OPTION_MATCH;
             PREPROC_PROFILE_END(ipOptionPerfStats);
@@ -44,8 +44,11 @@
 #define HTTP_SEARCH_RAW_COOKIE 0x80
 #define HTTP_SEARCH_STAT_CODE 0x100
 #define HTTP_SEARCH_STAT_MSG 0x200
-/*Only these Http buffers are eligible for fast pattern match */
-#define FAST_PATTERN_HTTP_BUFS ( HTTP_SEARCH_URI | HTTP_SEARCH_HEADER | HTTP_SEARCH_CLIENT_BODY )
+/* Http buffers eligible for fast pattern match, each has its own matcher */
+#define FAST_PATTERN_HTTP_BUFS ( HTTP_SEARCH_URI | HTTP_SEARCH_RAW_URI \
+        | HTTP_SEARCH_HEADER | HTTP_SEARCH_RAW_HEADER | HTTP_SEARCH_CLIENT_BODY \
+        | HTTP_SEARCH_METHOD | HTTP_SEARCH_COOKIE | HTTP_SEARCH_RAW_COOKIE \
+        | HTTP_SEARCH_STAT_CODE | HTTP_SEARCH_STAT_MSG )
 
 /********************************************************************
  * Data structures
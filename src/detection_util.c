@@ -23,6 +23,7 @@
 #endif
 
 #include <time.h>
+#include <string.h>
 
 #include "detection_util.h"
 #include "sfutil/sf_textlog.h"
@@ -44,6 +45,14 @@ DataPointer DetectBuffer;
 DataPointer file_data_ptr;
 DataBuffer DecodeBuffer;
 
+HttpBufferSet HttpBufferSets[HTTP_BUFFER_SETS_MAX];
+int HttpBufferSetCount;
+
+/* Saved buffers that don't point into the packet are copied here since
+ * http_inspect reuses its normalization buffers for every request */
+static uint8_t http_set_data[HTTP_BUFFER_SETS_MAX * 4096];
+static uint32_t http_set_used;
+
 #ifdef DEBUG
 const char* uri_buffer_name[HTTP_BUFFER_MAX] =
 {
@@ -185,3 +194,88 @@ void EventTrace_Term (void)
     }
 }
 
+static inline int HttpBufferInPacket(const Packet *p, const HttpUri *buf)
+{
+    return (p->data != NULL) && (buf->uri >= p->data) &&
+        ((buf->uri + buf->length) <= (p->data + p->dsize));
+}
+
+/* Buffers like the raw uri and the cookies can be the same data as an
+ * earlier buffer; share the copy instead of making another one */
+static inline int HttpBufferAlias(int i)
+{
+    int j;
+
+    for (j = 0; j < i; j++)
+    {
+        if ((UriBufs[j].uri == UriBufs[i].uri) &&
+                (UriBufs[j].length >= UriBufs[i].length))
+            return j;
+    }
+
+    return -1;
+}
+
+/* Saves UriBufs as the next buffer set.  Returns 0 if there is no room
+ * left for it, in which case nothing is saved. */
+int HttpBufferSetSave(const Packet *p)
+{
+    HttpBufferSet *set;
+    uint32_t need = 0;
+    int count = (p->uri_count < HTTP_BUFFER_MAX) ? p->uri_count : HTTP_BUFFER_MAX;
+    int i, j;
+
+    if (HttpBufferSetCount == HTTP_BUFFER_SETS_MAX)
+        return 0;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((UriBufs[i].uri == NULL) || (UriBufs[i].length == 0) ||
+                HttpBufferInPacket(p, &UriBufs[i]) || (HttpBufferAlias(i) >= 0))
+            continue;
+
+        need += UriBufs[i].length;
+    }
+
+    if (need > (sizeof(http_set_data) - http_set_used))
+        return 0;
+
+    set = &HttpBufferSets[HttpBufferSetCount++];
+    memcpy(set->bufs, UriBufs, sizeof(set->bufs));
+    set->uri_count = p->uri_count;
+    set->pipeline_count = p->http_pipeline_count;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((UriBufs[i].uri == NULL) || (UriBufs[i].length == 0) ||
+                HttpBufferInPacket(p, &UriBufs[i]))
+            continue;
+
+        if ((j = HttpBufferAlias(i)) >= 0)
+        {
+            set->bufs[i].uri = set->bufs[j].uri;
+            continue;
+        }
+
+        memcpy(&http_set_data[http_set_used], UriBufs[i].uri, UriBufs[i].length);
+        set->bufs[i].uri = &http_set_data[http_set_used];
+        http_set_used += UriBufs[i].length;
+    }
+
+    return 1;
+}
+
+/* Makes a saved buffer set the current one */
+void HttpBufferSetLoad(Packet *p, int set)
+{
+    memcpy(UriBufs, HttpBufferSets[set].bufs, sizeof(UriBufs));
+    p->uri_count = HttpBufferSets[set].uri_count;
+    p->http_pipeline_count = HttpBufferSets[set].pipeline_count;
+}
+
+void HttpBufferSetReset(void)
+{
+    HttpBufferSetCount = 0;
+    http_set_used = 0;
+}
+
@@ -106,6 +106,21 @@ extern DataPointer DetectBuffer;
 extern DataPointer file_data_ptr;
 extern DataBuffer DecodeBuffer;
 
+/* Copies of UriBufs for the pipelined requests of a PDU, when http_inspect
+ * hands them to the detection engine together.  HttpBufferSetCount is only
+ * nonzero while those requests are being detected. */
+#define HTTP_BUFFER_SETS_MAX 64
+
+typedef struct _HttpBufferSet
+{
+    HttpUri bufs[HTTP_BUFFER_MAX];
+    uint8_t uri_count;
+    uint32_t pipeline_count;
+} HttpBufferSet;
+
+extern HttpBufferSet HttpBufferSets[HTTP_BUFFER_SETS_MAX];
+extern int HttpBufferSetCount;
+
 const char* uri_buffer_name[HTTP_BUFFER_MAX];
 
 #define SetDetectLimit(pktPtr, altLen) \
@@ -206,6 +221,10 @@ void EventTrace_Term(void);
 
 void EventTrace_Log(const Packet*, OptTreeNode*, int action);
 
+int HttpBufferSetSave(const Packet*);
+void HttpBufferSetLoad(Packet*, int set);
+void HttpBufferSetReset(void);
+
 static inline int EventTrace_IsEnabled (void)
 {
     return ( snort_conf->event_trace_max > 0 );
@@ -1659,6 +1659,12 @@ static int DynamicReenablePreprocBitFunc(unsigned int preproc_id)
     return ReenablePreprocBit(preproc_id);
 }
 
+static void DynamicFillOptions(void *p)
+{
+    GetIpOptions((Packet *)p);
+    GetTcpOptions((Packet *)p);
+}
+
 int InitDynamicPreprocessors(void)
 {
     int i;
@@ -1817,6 +1823,7 @@ int InitDynamicPreprocessors(void)
     preprocData.fileAPI = file_api;
     preprocData.disableAllPolicies = &DynamicDisableAllPolicies;
     preprocData.reenablePreprocBit = &DynamicReenablePreprocBitFunc;
+    preprocData.fillOptions = &DynamicFillOptions;
     return InitDynamicPreprocessorPlugins(&preprocData);
 }
 
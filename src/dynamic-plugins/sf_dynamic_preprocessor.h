@@ -54,7 +54,7 @@
 #endif
 #endif
 
-#define PREPROCESSOR_DATA_VERSION 6
+#define PREPROCESSOR_DATA_VERSION 7
 
 #include "sf_dynamic_common.h"
 #include "sf_dynamic_engine.h"
@@ -177,6 +177,7 @@ typedef int (*CanWhitelist)(void);
 
 typedef void (*DisableAllPoliciesFunc)(void);
 typedef int (*ReenablePreprocBitFunc)(unsigned int preproc_id);
+typedef void (*FillOptionsFunc)(void *p);
 
 #define ENC_DYN_FWD 0x80000000
 #define ENC_DYN_NET 0x10000000
@@ -330,6 +331,10 @@ typedef struct _DynamicPreprocessorData
     FileAPI *fileAPI;
     DisableAllPoliciesFunc disableAllPolicies;
     ReenablePreprocBitFunc reenablePreprocBit;
+
+    /* fills ip_options / tcp_options of an SFSnortPacket if they are
+     * still pending; call before reading either array */
+    FillOptionsFunc fillOptions;
 } DynamicPreprocessorData;
 
 /* Function prototypes for Dynamic Preprocessor Plugins */
@@ -501,88 +501,48 @@ typedef struct {
 
 typedef struct _SFSnortPacket
 {
+    /* hot */
     const SFDAQ_PktHdr_t *pkt_header; /* Is this GPF'd? */
     const uint8_t *pkt_data;
 
-    void *ether_arp_header;
     const EtherHeader *ether_header;
     const void *vlan_tag_header;
-    void *ether_header_llc;
-    void *ether_header_other;
-    const void *ppp_over_ether_header;
-    const void *gre_header;
-    uint32_t *mpls;
 
-    const IPV4Header *ip4_header, *orig_ip4_header;
-    const IPV4Header *inner_ip4_header;
-    const IPV4Header *outer_ip4_header;
-    const TCPHeader *tcp_header, *orig_tcp_header;
-    const UDPHeader *udp_header, *orig_udp_header;
-    const UDPHeader *inner_udph;   /* if Teredo + UDP, this will be the inner UDP header */
-    const UDPHeader *outer_udph;   /* if Teredo + UDP, this will be the outer UDP header */
-    const ICMPHeader *icmp_header, *orig_icmp_header;
+    const IPV4Header *ip4_header;
+    const TCPHeader *tcp_header;
+    const UDPHeader *udp_header;
+    const ICMPHeader *icmp_header;
 
     const uint8_t *payload;
     const uint8_t *ip_payload;
-    const uint8_t *outer_ip_payload;
-    const uint8_t *ip_frag_start;
-    const uint8_t *ip4_options_data;
-    const uint8_t *tcp_options_data;
 
     void *stream_session_ptr;
     void *fragmentation_tracking_ptr;
     void *flow_ptr;
 
-    IP4Hdr *ip4h, *orig_ip4h;
-    IP6Hdr *ip6h, *orig_ip6h;
-    ICMP6Hdr *icmp6h, *orig_icmp6h;
+    IP4Hdr *ip4h;
+    IP6Hdr *ip6h;
+    ICMP6Hdr *icmp6h;
 
     IPH_API* iph_api;
-    IPH_API* orig_iph_api;
-    IPH_API* outer_iph_api;
-    IPH_API* outer_orig_iph_api;
-
-    IP4Hdr inner_ip4h, inner_orig_ip4h;
-    IP6Hdr inner_ip6h, inner_orig_ip6h;
-    IP4Hdr outer_ip4h, outer_orig_ip4h;
-    IP6Hdr outer_ip6h, outer_orig_ip6h;
-
-    MplsHdr   mplsHdr;
 
     int family;
-    int orig_family;
-    int outer_family;
-    int number_bytes_to_check;
-
-    //int ip_payload_length;
-    //int ip_payload_offset;
 
     uint32_t preprocessor_bit_mask;
     uint32_t preproc_reassembly_pkt_bit_mask;
-
-    uint32_t http_pipeline_count;
     uint32_t flags;
 
-    uint32_t xtradata_mask;
-    uint32_t per_packet_xtradata;
-
     uint16_t proto_bits;
 
     uint16_t payload_size;
     uint16_t ip_payload_size;
     uint16_t normalized_payload_size;
-    uint16_t actual_ip_length;
-    uint16_t outer_ip_payload_size;
 
-    uint16_t ip_fragment_offset;
-    uint16_t ip_frag_length;
     uint16_t ip4_options_length;
     uint16_t tcp_options_length;
 
     uint16_t src_port;
     uint16_t dst_port;
-    uint16_t orig_src_port;
-    uint16_t orig_dst_port;
 
     int16_t application_protocol_ordinal;
 
@@ -598,14 +558,66 @@ typedef struct _SFSnortPacket
 
     uint8_t num_ip_options;
     uint8_t num_tcp_options;
+    uint8_t next_layer_index;
+    uint8_t options_pending;    /* ip_options / tcp_options not filled yet */
+
+    /* cold */
+    void *ether_arp_header;
+    void *ether_header_llc;
+    void *ether_header_other;
+    const void *ppp_over_ether_header;
+    const void *gre_header;
+    uint32_t *mpls;
+
+    const IPV4Header *orig_ip4_header;
+    const IPV4Header *inner_ip4_header;
+    const IPV4Header *outer_ip4_header;
+    const TCPHeader *orig_tcp_header;
+    const UDPHeader *orig_udp_header;
+    const UDPHeader *inner_udph;   /* if Teredo + UDP, this will be the inner UDP header */
+    const UDPHeader *outer_udph;   /* if Teredo + UDP, this will be the outer UDP header */
+    const ICMPHeader *orig_icmp_header;
+
+    const uint8_t *outer_ip_payload;
+    const uint8_t *ip_frag_start;
+    const uint8_t *ip4_options_data;
+    const uint8_t *tcp_options_data;
+
+    IP4Hdr *orig_ip4h;
+    IP6Hdr *orig_ip6h;
+    ICMP6Hdr *orig_icmp6h;
+
+    IPH_API* orig_iph_api;
+    IPH_API* outer_iph_api;
+    IPH_API* outer_orig_iph_api;
+
+    int orig_family;
+    int outer_family;
+    int number_bytes_to_check;
+
+    //int ip_payload_length;
+    //int ip_payload_offset;
+
+    uint32_t http_pipeline_count;
+
+    uint32_t xtradata_mask;
+    uint32_t per_packet_xtradata;
+
+    uint16_t actual_ip_length;
+    uint16_t outer_ip_payload_size;
+
+    uint16_t ip_fragment_offset;
+    uint16_t ip_frag_length;
+
+    uint16_t orig_src_port;
+    uint16_t orig_dst_port;
+
     uint8_t num_ip6_extensions;
     uint8_t ip6_frag_extension;
 
     u_char ip_last_option_invalid_flag;
     u_char tcp_last_option_invalid_flag;
 
-    uint8_t next_layer_index;
-
 #ifndef NO_NON_ETHER_DECODER
     const void *fddi_header;
     void *fddi_saps;
@@ -634,6 +646,16 @@ typedef struct _SFSnortPacket
     void *eapol_key;
 #endif
 
+    IP4Hdr inner_ip4h, inner_orig_ip4h;
+    IP6Hdr inner_ip6h, inner_orig_ip6h;
+    IP4Hdr outer_ip4h, outer_orig_ip4h;
+    IP6Hdr outer_ip6h, outer_orig_ip6h;
+
+    MplsHdr   mplsHdr;
+
+    /* Since PREPROCESSOR_DATA_VERSION 7 / ENGINE_DATA_VERSION 9 these are
+     * filled on demand.  .so rules get them filled before they are called;
+     * preprocessors must call _dpd.fillOptions(p) before reading them. */
     IPOptions ip_options[MAX_IP_OPTIONS];
     TCPOptions tcp_options[MAX_TCP_OPTIONS];
     IP6Extension ip6_extensions[MAX_IP6_EXTENSIONS];
@@ -659,7 +681,7 @@ typedef struct _SFSnortPacket
 #define IP_INNER_LAYER   1
 #define IP_OUTTER_LAYER  0
 
-#define PKT_ZERO_LEN offsetof(SFSnortPacket, ip_options)
+#define PKT_ZERO_LEN offsetof(SFSnortPacket, inner_ip4h)
 
 #define PROTO_BIT__IP       0x0001
 #define PROTO_BIT__ARP      0x0002
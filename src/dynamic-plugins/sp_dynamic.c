@@ -260,6 +260,14 @@ int DynamicCheck(void *option_data, Packet *p)
         return DETECTION_OPTION_NO_MATCH;
     }
 
+    /* .so rule code, including the engine's header option checks, may
+     * read the option arrays directly so fill them before calling out */
+    if (p->opts_pending)
+    {
+        GetIpOptions(p);
+        GetTcpOptions(p);
+    }
+
     result = dynData->checkFunction((void *)p, dynData->contextData);
     if (result)
     {
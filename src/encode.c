@@ -41,6 +41,7 @@
 #include "snort.h"
 #include "stream_api.h"
 #include "checksum.h"
+#include "preprocids.h"
 
 #define GET_IP_HDR_LEN(h) (((h)->ip_verhl & 0x0f) << 2)
 #define GET_TCP_HDR_LEN(h) (((h)->th_offx2 & 0xf0) >> 2)
@@ -117,6 +118,35 @@ static const uint8_t* Encode_Packet(
 
 static ENC_STATUS UN6_Encode(EncState*, Buffer*, Buffer*);
 
+// response templates; see Tmpl_Get()
+#define TMPL_SLOTS   4
+#define TMPL_L2_MAX  (ETHERNET_HEADER_LEN + 4*VLAN_HEADER_LEN)
+#define TMPL_KEY_MAX (TMPL_L2_MAX + 2*sizeof(struct in6_addr) + 4)
+#define TMPL_HDR_MAX (TMPL_L2_MAX + IP6_HDR_LEN + TCP_HDR_LEN)
+
+typedef struct {
+    EncodeFlags flags;
+    const uint8_t* mac;
+    uint8_t ip4;
+    uint8_t len;
+    uint8_t data[TMPL_KEY_MAX];
+} TmplKey;
+
+typedef struct {
+    TmplKey key;       // key.len == 0 if unused
+    uint8_t off;       // start of output (sparc twiddle)
+    uint8_t ip_off;    // ip header offset from off
+    uint8_t hdr_len;   // everything but tcp payload
+    uint8_t hdr[TMPL_HDR_MAX];
+} EncTemplate;
+
+static EncTemplate s_tmpl[TMPL_SLOTS];
+
+static EncTemplate* Tmpl_Get(EncState*, TmplKey*);
+static int Tmpl_Match(const EncTemplate*, const TmplKey*);
+static ENC_STATUS Tmpl_Apply(EncState*, const EncTemplate*, Buffer*);
+static void Tmpl_Save(EncTemplate*, const TmplKey*, const EncState*, const Buffer*);
+
 //-------------------------------------------------------------------------
 
 static inline PROTO_ID NextEncoder (EncState* enc)
@@ -160,10 +190,10 @@ void Encode_Term (void)
 // unwind the stack we finish up encoding in a more normal fashion (now
 // the outer layer knows the length of the inner layer, etc.).
 //
-// when multiple responses are sent, both forwards and backwards directions,
-// or multiple ICMP types (unreachable port, host, net), it may be possible
-// to reuse the 1st encoding and just tweak it.  optimization for later
-// consideration.
+// when multiple tcp responses are sent for a session, the last encoding
+// in each direction is saved and reused with just the per packet fields
+// patched (see Tmpl_Get()).  icmp unreachables quote the original packet
+// so they are always encoded from scratch.
 
 // pci is copied from in to out
 // * addresses / ports are swapped if !fwd
@@ -254,6 +284,10 @@ int Encode_Format (EncodeFlags f, const Packet* p, Packet* c, PseudoPacketType t
     pkth->egress_index = egress_index;
     pkth->egress_group = egress_group;
     pkth->flags = daq_flags;
+#ifdef DAQ_PKT_FLAG_HW_TCP_CS_GOOD
+    // the nic didn't see this payload
+    pkth->flags &= ~DAQ_PKT_FLAG_HW_TCP_CS_GOOD;
+#endif
     pkth->address_space_id = address_space_id;
 #endif
 
@@ -418,6 +452,8 @@ static const uint8_t* Encode_Packet(
     Buffer ibuf, obuf;
     ENC_STATUS status = ENC_BAD_PROTO;
     PROTO_ID next;
+    EncTemplate* tmpl;
+    TmplKey key;
 
     ibuf.base = (uint8_t*)p->pkt;
     ibuf.off = ibuf.end = 0;
@@ -430,12 +466,23 @@ static const uint8_t* Encode_Packet(
     enc->layer = 0;
     enc->p = p;
 
-    next = NextEncoder(enc);
+    tmpl = Tmpl_Get(enc, &key);
 
-    if ( next < PROTO_MAX )
+    if ( tmpl && Tmpl_Match(tmpl, &key) )
     {
-        Encoder e = encoders[next].fencode;
-        status = (*e)(enc, &ibuf, &obuf);
+        status = Tmpl_Apply(enc, tmpl, &obuf);
+    }
+    else
+    {
+        next = NextEncoder(enc);
+
+        if ( next < PROTO_MAX )
+        {
+            Encoder e = encoders[next].fencode;
+            status = (*e)(enc, &ibuf, &obuf);
+        }
+        if ( tmpl && status == ENC_OK && enc->layer == p->next_layer )
+            Tmpl_Save(tmpl, &key, enc, &obuf);
     }
     if ( status != ENC_OK || enc->layer != p->next_layer )
     {
@@ -982,24 +1029,14 @@ static void UDP_Format (EncodeFlags f, const Packet* p, Packet* c, Layer* lyr)
 // acknowledges the SYN.
 //-------------------------------------------------------------------------
 
-static ENC_STATUS TCP_Encode (EncState* enc, Buffer* in, Buffer* out)
+// sets everything but the ports; ho is the last thing in out
+static ENC_STATUS TCP_Fill (
+    EncState* enc, const TCPHdr* hi, TCPHdr* ho, Buffer* out)
 {
-    int len, ctl;
-
-    TCPHdr* hi = (TCPHdr*)enc->p->layers[enc->layer-1].start;
-    TCPHdr* ho = (TCPHdr*)(out->base + out->end);
-
-    UPDATE_BOUND(out, sizeof(*ho));
-
-    len = GET_TCP_HDR_LEN(hi) - sizeof(*hi);
-    UPDATE_BOUND(in, len);
-    ctl = (hi->th_flags & TH_SYN) ? 1 : 0;
+    int ctl = (hi->th_flags & TH_SYN) ? 1 : 0;
 
     if ( FORWARD(enc) )
     {
-        ho->th_sport = hi->th_sport;
-        ho->th_dport = hi->th_dport;
-
         // th_seq depends on whether the data passes or drops
         if ( DAQ_GetInterfaceMode(enc->p->pkth) != DAQ_MODE_INLINE )
             ho->th_seq = htonl(ntohl(hi->th_seq) + enc->p->dsize + ctl);
@@ -1010,9 +1047,6 @@ static ENC_STATUS TCP_Encode (EncState* enc, Buffer* in, Buffer* out)
     }
     else
     {
-        ho->th_sport = hi->th_dport;
-        ho->th_dport = hi->th_sport;
-
         ho->th_seq = hi->th_ack;
         ho->th_ack = htonl(ntohl(hi->th_seq) + enc->p->dsize + ctl);
     }
@@ -1072,6 +1106,31 @@ static ENC_STATUS TCP_Encode (EncState* enc, Buffer* in, Buffer* out)
     return ENC_OK;
 }
 
+static ENC_STATUS TCP_Encode (EncState* enc, Buffer* in, Buffer* out)
+{
+    int len;
+
+    TCPHdr* hi = (TCPHdr*)enc->p->layers[enc->layer-1].start;
+    TCPHdr* ho = (TCPHdr*)(out->base + out->end);
+
+    UPDATE_BOUND(out, sizeof(*ho));
+
+    len = GET_TCP_HDR_LEN(hi) - sizeof(*hi);
+    UPDATE_BOUND(in, len);
+
+    if ( FORWARD(enc) )
+    {
+        ho->th_sport = hi->th_sport;
+        ho->th_dport = hi->th_dport;
+    }
+    else
+    {
+        ho->th_sport = hi->th_dport;
+        ho->th_dport = hi->th_sport;
+    }
+    return TCP_Fill(enc, hi, ho, out);
+}
+
 static ENC_STATUS TCP_Update (Packet* p, Layer* lyr, uint32_t* len)
 {
     TCPHdr* h = (TCPHdr*)(lyr->start);
@@ -1470,6 +1529,163 @@ static void XXX_Format (EncodeFlags f, const Packet* p, Packet* c, Layer* lyr)
     // nop
 }
 
+//-------------------------------------------------------------------------
+// response templates:
+// a tcp reset or fin for a given session and direction differs from the
+// previous one only in ip id, ttl, tos, lengths, seq/ack and checksums.
+// so the headers of the last one sent in each direction are saved in a
+// few static slots (no per session memory) and later responses copy them
+// and patch just those fields instead of walking the layer encoders.  the
+// template is keyed on the input bytes that the copied fields are derived
+// from (everything below ip plus the addresses and ports) so it is never
+// stale; a response for another session just replaces it.  only plain eth / vlan / ip4|ip6 / tcp
+// packets are handled; everything else is encoded layer by layer.
+//-------------------------------------------------------------------------
+
+static inline int Tmpl_Key (const Packet* p, TmplKey* key)
+{
+    const Layer* tcp = p->layers + p->next_layer - 1;
+    const Layer* ip = tcp - 1;
+    unsigned l2, alen;
+    int i;
+
+    if ( p->next_layer < 2 || tcp->proto != PROTO_TCP )
+        return 0;
+
+    if ( ip->proto == PROTO_IP4 )
+        alen = 2*sizeof(struct in_addr);
+
+    else if ( ip->proto == PROTO_IP6 )
+        alen = 2*sizeof(struct in6_addr);
+
+    else
+        return 0;
+
+    for ( i = 0; i < p->next_layer - 2; i++ )
+    {
+        if ( p->layers[i].proto != PROTO_ETH && p->layers[i].proto != PROTO_VLAN )
+            return 0;
+    }
+    l2 = ip->start - p->pkt;
+
+    if ( l2 > TMPL_L2_MAX )
+        return 0;
+
+    key->ip4 = ( ip->proto == PROTO_IP4 );
+    key->len = l2 + alen + 4;
+
+    memcpy(key->data, p->pkt, l2);
+
+    if ( key->ip4 )
+        memcpy(key->data + l2, &((IPHdr*)ip->start)->ip_src, alen);
+    else
+        memcpy(key->data + l2, &((IP6RawHdr*)ip->start)->ip6_src, alen);
+
+    // ports
+    memcpy(key->data + l2 + alen, tcp->start, 4);
+    return 1;
+}
+
+static EncTemplate* Tmpl_Get (EncState* enc, TmplKey* key)
+{
+    const Packet* p = enc->p;
+    int slot;
+
+    if ( enc->type != ENC_TCP_RST && enc->type != ENC_TCP_FIN )
+        return NULL;
+
+    if ( !Tmpl_Key(p, key) )
+        return NULL;
+
+    key->flags = enc->flags & (ENC_FLAG_FWD|ENC_FLAG_RAW);
+    key->mac = dst_mac;
+
+    slot = (p->packet_flags & PKT_FROM_CLIENT) ? 2 : 0;
+    slot |= FORWARD(enc) ? 1 : 0;
+
+    return s_tmpl + slot;
+}
+
+static int Tmpl_Match (const EncTemplate* t, const TmplKey* key)
+{
+    return ( t->key.len == key->len && t->key.ip4 == key->ip4 &&
+        t->key.flags == key->flags && t->key.mac == key->mac &&
+        !memcmp(t->key.data, key->data, key->len) );
+}
+
+static void Tmpl_Save (
+    EncTemplate* t, const TmplKey* key, const EncState* enc, const Buffer* out)
+{
+    uint32_t len = out->end - out->off;
+    uint32_t ip_len = key->ip4 ? IP_HEADER_LEN : IP6_HDR_LEN;
+
+    if ( enc->type == ENC_TCP_FIN && enc->payLoad )
+        len -= enc->payLen;
+
+    if ( len > TMPL_HDR_MAX || len < ip_len + TCP_HDR_LEN )
+        return;
+
+    t->key = *key;
+    t->off = out->off;
+    t->hdr_len = len;
+    t->ip_off = len - ip_len - TCP_HDR_LEN;
+    memcpy(t->hdr, out->base + out->off, len);
+}
+
+static ENC_STATUS Tmpl_Apply (EncState* enc, const EncTemplate* t, Buffer* out)
+{
+    const Packet* p = enc->p;
+    const Layer* lyr = p->layers + p->next_layer - 2;
+    uint8_t* b = out->base + t->off;
+    TCPHdr* ho = (TCPHdr*)(b + t->hdr_len - TCP_HDR_LEN);
+    ENC_STATUS err;
+
+    out->off = t->off;
+    out->end = t->off + t->hdr_len;
+    memcpy(b, t->hdr, t->hdr_len);
+
+    if ( t->key.ip4 )
+    {
+        IPHdr* hi = (IPHdr*)lyr->start;
+        IPHdr* iho = (IPHdr*)(b + t->ip_off);
+
+        // same order as IP4_Encode(); ttl must be fetched before ip_hdr is set
+        iho->ip_id = IpId_Next();
+        iho->ip_tos = hi->ip_tos;
+        iho->ip_ttl = FORWARD(enc) ? FwdTTL(enc, hi->ip_ttl) : RevTTL(enc, hi->ip_ttl);
+
+        enc->ip_hdr = (uint8_t*)hi;
+        enc->ip_len = IP_HLEN(hi) << 2;
+
+        err = TCP_Fill(enc, (TCPHdr*)lyr[1].start, ho, out);
+        if ( ENC_OK != err ) return err;
+
+        iho->ip_len = htons((uint16_t)(out->end - out->off - t->ip_off));
+        iho->ip_csum = 0;
+        iho->ip_csum = in_chksum_ip((uint16_t *)iho, sizeof *iho);
+    }
+    else
+    {
+        IP6RawHdr* hi = (IP6RawHdr*)lyr->start;
+        IP6RawHdr* iho = (IP6RawHdr*)(b + t->ip_off);
+
+        iho->ip6flow = htonl(ntohl(hi->ip6flow) & 0xFFF00000);
+        iho->ip6hops = FORWARD(enc) ? FwdTTL(enc, hi->ip6hops) : RevTTL(enc, hi->ip6hops);
+
+        enc->ip_hdr = (uint8_t*)hi;
+        enc->ip_len = sizeof(*hi);
+
+        err = TCP_Fill(enc, (TCPHdr*)lyr[1].start, ho, out);
+        if ( ENC_OK != err ) return err;
+
+        iho->ip6plen = htons((uint16_t)(out->end - out->off - t->ip_off - sizeof(*iho)));
+    }
+    enc->proto = 0;
+    enc->layer = p->next_layer;
+
+    return ENC_OK;
+}
+
 //-------------------------------------------------------------------------
 // function table:
 // these must be in the same order PROTO_IDs are defined!
@@ -0,0 +1,286 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    flow_bypass.c
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "flow_bypass.h"
+#include "ipv6_port.h"
+#include "util.h"
+#include "spp_stream5.h"
+
+typedef struct
+{
+    uint32_t ip_lo[4];
+    uint32_t ip_hi[4];
+    uint16_t port_lo;
+    uint16_t port_hi;
+    uint16_t vlan;
+    uint8_t proto;
+    uint8_t used;
+} FlowBypassKey;
+
+typedef struct
+{
+    FlowBypassKey key;
+    uint32_t last;      /* packet time of last hit */
+} FlowBypassEntry;
+
+typedef struct
+{
+    FlowBypassEntry* entries;
+    uint32_t mask;
+    uint32_t timeout;
+} FlowBypassTable;
+
+void* flow_bypass_table = NULL;
+
+//--------------------------------------------------------------------
+// private
+//--------------------------------------------------------------------
+
+static inline void FlowBypass_CopyIp (uint32_t* dst, snort_ip_p ip)
+{
+    if ( ip->family == AF_INET )
+    {
+        dst[0] = ip->ip32[0];
+        dst[1] = dst[2] = dst[3] = 0;
+    }
+    else
+        memcpy(dst, ip->ip32, 4 * sizeof(*dst));
+}
+
+// build a direction independent key
+static inline void FlowBypass_MakeKey (
+    snort_ip_p sip, uint16_t sp, snort_ip_p dip, uint16_t dp,
+    uint8_t proto, uint16_t vlan, FlowBypassKey* key)
+{
+    int swap = ( sfip_compare(sip, dip) == SFIP_GREATER ) ||
+        ( sfip_compare(sip, dip) == SFIP_EQUAL && sp > dp );
+
+    if ( swap )
+    {
+        FlowBypass_CopyIp(key->ip_lo, dip);
+        FlowBypass_CopyIp(key->ip_hi, sip);
+        key->port_lo = dp;
+        key->port_hi = sp;
+    }
+    else
+    {
+        FlowBypass_CopyIp(key->ip_lo, sip);
+        FlowBypass_CopyIp(key->ip_hi, dip);
+        key->port_lo = sp;
+        key->port_hi = dp;
+    }
+    key->proto = proto;
+    key->vlan = vlan;
+    key->used = 1;
+}
+
+// returns false if the packet is not eligible for the fast path
+static inline int FlowBypass_GetKey (const Packet* p, FlowBypassKey* key)
+{
+    uint8_t proto;
+
+    if ( !IPH_IS_VALID(p) || p->frag_flag )
+        return 0;
+
+    if ( p->tcph )
+        proto = IPPROTO_TCP;
+
+    else if ( p->udph )
+        proto = IPPROTO_UDP;
+
+    else
+        return 0;
+
+    FlowBypass_MakeKey(
+        GET_SRC_IP(p), p->sp, GET_DST_IP(p), p->dp, proto,
+        ( p->vh && !ScVlanAgnostic() ) ? VTH_VLAN(p->vh) : 0, key);
+
+    return 1;
+}
+
+static inline uint32_t FlowBypass_Hash (const FlowBypassKey* key)
+{
+    uint32_t h = key->proto;
+    int i;
+
+    for ( i = 0; i < 4; i++ )
+    {
+        h = (h * 31) ^ key->ip_lo[i];
+        h = (h * 31) ^ key->ip_hi[i];
+    }
+    h = (h * 31) ^ ((uint32_t)key->port_lo << 16 | key->port_hi);
+    h = (h * 31) ^ key->vlan;
+
+    // final avalanche so the low bits used for the index are mixed
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+static inline int FlowBypass_KeyEqual (
+    const FlowBypassKey* a, const FlowBypassKey* b)
+{
+    return !memcmp(a, b, sizeof(*a));
+}
+
+//--------------------------------------------------------------------
+// public
+//--------------------------------------------------------------------
+
+int FlowBypass_Init (SnortConfig* sc)
+{
+    FlowBypassTable* t;
+    uint32_t n = 1;
+
+    if ( !sc->flow_bypass_entries )
+        return 0;
+
+    while ( n < sc->flow_bypass_entries )
+        n <<= 1;
+
+    t = (FlowBypassTable*)SnortAlloc(sizeof(*t));
+    t->entries = (FlowBypassEntry*)SnortAlloc(n * sizeof(*t->entries));
+    t->mask = n - 1;
+    t->timeout = sc->flow_bypass_timeout ?
+        sc->flow_bypass_timeout : FLOW_BYPASS_DEFAULT_TIMEOUT;
+
+    flow_bypass_table = t;
+
+    LogMessage("Flow bypass cache: %u entries, %u sec timeout\n",
+        n, t->timeout);
+
+    return 0;
+}
+
+int FlowBypass_Term (void)
+{
+    FlowBypassTable* t = (FlowBypassTable*)flow_bypass_table;
+
+    if ( !t )
+        return 0;
+
+    free(t->entries);
+    free(t);
+    flow_bypass_table = NULL;
+
+    return 0;
+}
+
+void FlowBypass_Add (const Packet* p)
+{
+    FlowBypassTable* t = (FlowBypassTable*)flow_bypass_table;
+    FlowBypassEntry* e;
+    FlowBypassKey key;
+
+    if ( !t || (p->packet_flags & PKT_PSEUDO) )
+        return;
+
+    memset(&key, 0, sizeof(key));
+
+    if ( !FlowBypass_GetKey(p, &key) )
+        return;
+
+    e = t->entries + (FlowBypass_Hash(&key) & t->mask);
+
+    if ( !e->key.used || !FlowBypass_KeyEqual(&e->key, &key) )
+    {
+        e->key = key;
+        pc.flow_bypass_adds++;
+    }
+    e->last = (uint32_t)p->pkth->ts.tv_sec;
+}
+
+int FlowBypass_Check (Packet* p)
+{
+    FlowBypassTable* t = (FlowBypassTable*)flow_bypass_table;
+    FlowBypassEntry* e;
+    FlowBypassKey key;
+    uint32_t now;
+
+    memset(&key, 0, sizeof(key));
+
+    if ( !FlowBypass_GetKey(p, &key) )
+        return 0;
+
+    e = t->entries + (FlowBypass_Hash(&key) & t->mask);
+
+    if ( !e->key.used || !FlowBypass_KeyEqual(&e->key, &key) )
+        return 0;
+
+    now = (uint32_t)p->pkth->ts.tv_sec;
+
+    // session setup and teardown must go through stream5
+    if ( p->tcph && (p->tcph->th_flags & (TH_SYN|TH_FIN|TH_RST)) )
+    {
+        e->key.used = 0;
+        return 0;
+    }
+
+    if ( (now - e->last) > t->timeout )
+    {
+        e->key.used = 0;
+        return 0;
+    }
+
+    // keep the session from aging out while its packets skip stream5
+    if ( now != e->last )
+        Stream5TouchSession(p);
+
+    e->last = now;
+    p->packet_flags |= PKT_FAST_PATH;
+    pc.flow_bypass_hits++;
+
+    return 1;
+}
+
+void FlowBypass_Remove (
+    snort_ip_p ip1, uint16_t port1, snort_ip_p ip2, uint16_t port2,
+    uint8_t proto, uint16_t vlan)
+{
+    FlowBypassTable* t = (FlowBypassTable*)flow_bypass_table;
+    FlowBypassEntry* e;
+    FlowBypassKey key;
+
+    if ( !t || ((proto != IPPROTO_TCP) && (proto != IPPROTO_UDP)) )
+        return;
+
+    memset(&key, 0, sizeof(key));
+    FlowBypass_MakeKey(ip1, port1, ip2, port2, proto, vlan, &key);
+
+    e = t->entries + (FlowBypass_Hash(&key) & t->mask);
+
+    if ( e->key.used && FlowBypass_KeyEqual(&e->key, &key) )
+        e->key.used = 0;
+}
+
@@ -0,0 +1,68 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    flow_bypass.h
+//
+// fast path for flows that need no further inspection.  once a flow is
+// ignored in both directions (eg whitelisted by a preprocessor or by
+// stream_api->stop_inspection()) its 5-tuple is cached here and later
+// packets are passed right after decode, skipping policy selection,
+// session lookup, stream state tracking and preprocessor dispatch.
+//
+// the cache is direct mapped; collisions simply replace the old entry
+// which then falls back to the normal path.  tcp packets with SYN, FIN
+// or RST always take the normal path (and drop the entry) so that session
+// setup and teardown are still tracked.  a hit refreshes the stream5
+// session about once a second so it isn't pruned or timed out as idle.
+
+#ifndef __FLOW_BYPASS_H__
+#define __FLOW_BYPASS_H__
+
+#include "decode.h"
+#include "snort.h"
+
+#define FLOW_BYPASS_DEFAULT_TIMEOUT  180  /* seconds idle before expiry */
+#define FLOW_BYPASS_MAX_ENTRIES      (1 << 24)
+
+int FlowBypass_Init(SnortConfig*);
+int FlowBypass_Term(void);
+
+// add the flow of this (wire) packet to the cache
+void FlowBypass_Add(const Packet*);
+
+// returns true if the packet belongs to a cached flow
+int FlowBypass_Check(Packet*);
+
+// drop the flow when its session goes away so a bypassed flow
+// can't outlive its stream state; ports are in host order
+void FlowBypass_Remove(
+    snort_ip_p, uint16_t, snort_ip_p, uint16_t, uint8_t proto, uint16_t vlan);
+
+extern void* flow_bypass_table;
+
+static inline int FlowBypass_IsEnabled (void)
+{
+    return ( flow_bypass_table != NULL );
+}
+
+#endif // __FLOW_BYPASS_H__
+
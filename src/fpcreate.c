@@ -103,6 +103,10 @@ static inline void FreeDynamicContentList(FPContentInfo *fplist);
 static PatternMatchData * GetLongestPmdContent(OptTreeNode *otn, int type);
 static int fpFinishPortGroupRule(PORT_GROUP *pg, PmType pm_type,
         OptTreeNode *otn, PatternMatchData *pmd, FastPatternConfig *fp);
+static void fpAddPortGroupPattern(PORT_GROUP *pg, PmType pm_type,
+        OptTreeNode *otn, PatternMatchData *pmd, char *pattern,
+        int pattern_length, FastPatternConfig *fp);
+static PmType fpGetHttpPmType(int uri_buffer);
 static int fpFinishPortGroup(PORT_GROUP *pg, FastPatternConfig *fp);
 static int fpAllocPms(PORT_GROUP *pg, FastPatternConfig *fp);
 static int fpAddPortGroupRule(PORT_GROUP *pg, OptTreeNode *otn, FastPatternConfig *fp);
@@ -119,9 +123,16 @@ static const char *pm_type_strings[PM_TYPE__MAX] =
 {
     "Normal Content",
     "HTTP Uri content",
+    "HTTP Raw uri content",
     "HTTP Header content",
+    "HTTP Raw header content",
     "HTTP Client body content",
     "HTTP Method content",
+    "HTTP Cookie content",
+    "HTTP Raw cookie content",
+    "HTTP Stat code content",
+    "HTTP Stat msg content",
+    "HTTP Combined content",
 };
 
 /*
@@ -523,6 +534,7 @@ int finalize_detection_option_tree(detection_option_tree_root_t *root)
         {
             //num_trees++;
         }
+        detection_option_tree_mark_http(root->children[i], 0);
 #ifdef DEBUG_OPTION_TREE
         print_option_tree(root->children[i], 0);
 #endif
@@ -786,6 +798,24 @@ int pmx_create_tree(void *id, void **existing_tree)
     return otn_create_tree(otn, existing_tree);
 }
 
+/* Same as pmx_create_tree for the combined http matcher, but also keeps
+ * track of the buffers the patterns of a match state are meant for so
+ * matches in other buffers can be skipped */
+static int pmx_create_http_tree(void *id, void **existing_tree)
+{
+    int ret = pmx_create_tree(id, existing_tree);
+
+    if ((id != NULL) && (*existing_tree != NULL))
+    {
+        PMX *pmx = (PMX *)id;
+        PatternMatchData *pmd = (PatternMatchData *)pmx->PatternMatchData;
+
+        ((detection_option_tree_root_t *)*existing_tree)->http_buffers |= pmd->uri_buffer;
+    }
+
+    return ret;
+}
+
 /*
 **  The following functions deal with the intialization of the
 **  detection engine.  These are set through parser.c with the
@@ -865,6 +895,10 @@ int fpDetectSplitAnyAny(FastPatternConfig *fp)
 {
     return fp->split_any_any;
 }
+int fpDetectCombineHttpBuffers(FastPatternConfig *fp)
+{
+    return fp->combine_http_buffers;
+}
 void fpDetectSetSingleRuleGroup(FastPatternConfig *fp)
 {
     fp->portlists_flags |= PL_SINGLE_RULE_GROUP;
@@ -1006,6 +1040,19 @@ void fpDetectSetSplitAnyAny(FastPatternConfig *fp, int enable)
     }
 }
 
+void fpDetectSetCombineHttpBuffers(FastPatternConfig *fp, int enable)
+{
+    if (enable)
+    {
+        fp->combine_http_buffers = 1;
+        LogMessage("    Combine Http Buffers = enabled\n");
+    }
+    else
+    {
+        fp->combine_http_buffers = 0;
+    }
+}
+
 /*
 **  Set the debug mode for the detection engine.
 */
@@ -1237,7 +1284,7 @@ static inline int IsPmdFpEligible(PatternMatchData *content)
 
     if ((content->pattern_buf != NULL) && (content->pattern_size != 0))
     {
-        /* We don't add cookie and some other contents to fast pattern matcher */
+        /* Every http buffer has its own matcher, see PM_TYPE__HTTP_BUFFER */
         if(content->uri_buffer && !IsHttpBufFpEligible(content->uri_buffer))
             return 0;
 
@@ -1464,8 +1511,6 @@ static int UsePreprocOptFastPatterns(PatternMatchData *pmd, PatternMatchData *pr
 static int fpFinishPortGroupRule(PORT_GROUP *pg, PmType pm_type,
         OptTreeNode *otn, PatternMatchData *pmd_list, FastPatternConfig *fp)
 {
-    PMX * pmx;
-    RULE_NODE * rn;
     char *pattern;
     int pattern_length;
     PatternMatchData *pmd;
@@ -1482,8 +1527,16 @@ static int fpFinishPortGroupRule(PORT_GROUP *pg, PmType pm_type,
             pg_type = PGCT_CONTENT;
             break;
         case PM_TYPE__HTTP_URI_CONTENT:
+        case PM_TYPE__HTTP_RAW_URI_CONTENT:
         case PM_TYPE__HTTP_HEADER_CONTENT:
+        case PM_TYPE__HTTP_RAW_HEADER_CONTENT:
         case PM_TYPE__HTTP_CLIENT_BODY_CONTENT:
+        case PM_TYPE__HTTP_METHOD_CONTENT:
+        case PM_TYPE__HTTP_COOKIE_CONTENT:
+        case PM_TYPE__HTTP_RAW_COOKIE_CONTENT:
+        case PM_TYPE__HTTP_STAT_CODE_CONTENT:
+        case PM_TYPE__HTTP_STAT_MSG_CONTENT:
+        case PM_TYPE__HTTP_COMBINED_CONTENT:
             if (pmd_list == NULL)
                 return -1;
             pg_type = PGCT_URICONTENT;
@@ -1506,34 +1559,88 @@ static int fpFinishPortGroupRule(PORT_GROUP *pg, PmType pm_type,
         if (fpGetFinalPattern(fp, pmd, &pattern, &pattern_length) == -1)
             return -1;
 
-        /* create a rule_node */
-        rn = (RULE_NODE *)SnortAlloc(sizeof(RULE_NODE));
-        rn->rnRuleData = otn;
-
-        /* create pmx */
-        pmx = (PMX *)SnortAlloc(sizeof(PMX));
-        pmx->RuleNode = rn;
-        pmx->PatternMatchData = pmd;
+        if (pg_type == PGCT_URICONTENT)
+        {
+            int i;
 
-        if (fpDetectGetDebugPrintFastPatterns(fp))
-            PrintFastPatternInfo(otn, pmd, pattern, pattern_length, pm_type);
+            /* Negated and fast pattern only contents depend on the match
+             * coming from their own buffer so they stay in the per buffer
+             * matchers */
+            if (fpDetectCombineHttpBuffers(fp)
+                    && !pmd->exception_flag && !pmd->fp_only)
+            {
+                fpAddPortGroupPattern(pg, PM_TYPE__HTTP_COMBINED_CONTENT, otn,
+                        pmd, pattern, pattern_length, fp);
+                continue;
+            }
 
-        mpseAddPattern(
-                pg->pgPms[pm_type],
-                pattern,
-                pattern_length,
-                pmd->nocase,
-                pmd->offset,
-                pmd->depth,
-                (unsigned)pmd->exception_flag,
-                pmx,
-                rn->iRuleNodeID
-                );
+            /* A content can name more than one http buffer - it has to
+             * be found by the matcher of each of them */
+            for (i = HTTP_BUFFER_URI; i < HTTP_BUFFER_MAX; i++)
+            {
+                if (pmd->uri_buffer & (1 << i))
+                {
+                    fpAddPortGroupPattern(pg, PM_TYPE__HTTP_BUFFER(i), otn,
+                            pmd, pattern, pattern_length, fp);
+                }
+            }
+        }
+        else
+        {
+            fpAddPortGroupPattern(pg, pm_type, otn, pmd,
+                    pattern, pattern_length, fp);
+        }
     }
 
     return 0;
 }
 
+static void fpAddPortGroupPattern(PORT_GROUP *pg, PmType pm_type,
+        OptTreeNode *otn, PatternMatchData *pmd, char *pattern,
+        int pattern_length, FastPatternConfig *fp)
+{
+    PMX * pmx;
+    RULE_NODE * rn;
+
+    /* create a rule_node */
+    rn = (RULE_NODE *)SnortAlloc(sizeof(RULE_NODE));
+    rn->rnRuleData = otn;
+
+    /* create pmx */
+    pmx = (PMX *)SnortAlloc(sizeof(PMX));
+    pmx->RuleNode = rn;
+    pmx->PatternMatchData = pmd;
+
+    if (fpDetectGetDebugPrintFastPatterns(fp))
+        PrintFastPatternInfo(otn, pmd, pattern, pattern_length, pm_type);
+
+    mpseAddPattern(
+            pg->pgPms[pm_type],
+            pattern,
+            pattern_length,
+            pmd->nocase,
+            pmd->offset,
+            pmd->depth,
+            (unsigned)pmd->exception_flag,
+            pmx,
+            rn->iRuleNodeID
+            );
+}
+
+/* The matcher for the first http buffer a content applies to */
+static PmType fpGetHttpPmType(int uri_buffer)
+{
+    int i;
+
+    for (i = HTTP_BUFFER_URI; i < HTTP_BUFFER_MAX; i++)
+    {
+        if (uri_buffer & (1 << i))
+            return PM_TYPE__HTTP_BUFFER(i);
+    }
+
+    return PM_TYPE__CONTENT;
+}
+
 static int fpFinishPortGroup(PORT_GROUP *pg, FastPatternConfig *fp)
 {
     PmType i;
@@ -1548,7 +1655,12 @@ static int fpFinishPortGroup(PORT_GROUP *pg, FastPatternConfig *fp)
         {
             if (mpseGetPatternCount(pg->pgPms[i]) != 0)
             {
-                if (mpsePrepPatterns(pg->pgPms[i], pmx_create_tree,
+                int (*build_tree)(void *, void **) = pmx_create_tree;
+
+                if (i == PM_TYPE__HTTP_COMBINED_CONTENT)
+                    build_tree = pmx_create_http_tree;
+
+                if (mpsePrepPatterns(pg->pgPms[i], build_tree,
                             add_patrn_to_neg_list) != 0)
                 {
                     FatalError("%s(%d) Failed to compile port group "
@@ -1672,16 +1784,7 @@ static int fpAddPortGroupRule(PORT_GROUP *pg, OptTreeNode *otn, FastPatternConfi
         pmd_uri = GetDynamicFastPatternPmd(dd, CONTENT_HTTP);
         if (pmd_uri != NULL)
         {
-            PmType pm_type;
-
-            if (pmd_uri->uri_buffer & HTTP_SEARCH_URI)
-                pm_type = PM_TYPE__HTTP_URI_CONTENT;
-            else if (pmd_uri->uri_buffer & HTTP_SEARCH_HEADER)
-                pm_type = PM_TYPE__HTTP_HEADER_CONTENT;
-            else if (pmd_uri->uri_buffer & HTTP_SEARCH_CLIENT_BODY)
-                pm_type = PM_TYPE__HTTP_CLIENT_BODY_CONTENT;
-            else
-                pm_type = PM_TYPE__CONTENT;
+            PmType pm_type = fpGetHttpPmType(pmd_uri->uri_buffer);
 
             if (fpFinishPortGroupRule(pg, pm_type, otn, pmd_uri, fp) == 0)
             {
@@ -1767,16 +1870,7 @@ static int fpAddPortGroupRule(PORT_GROUP *pg, OptTreeNode *otn, FastPatternConfi
     (void)RemovePmdFromList(pmd_uri);
     if (pmd_uri != NULL)
     {
-        PmType pm_type;
-
-        if (pmd_uri->uri_buffer & HTTP_SEARCH_URI)
-            pm_type = PM_TYPE__HTTP_URI_CONTENT;
-        else if (pmd_uri->uri_buffer & HTTP_SEARCH_HEADER)
-            pm_type = PM_TYPE__HTTP_HEADER_CONTENT;
-        else if (pmd_uri->uri_buffer & HTTP_SEARCH_CLIENT_BODY)
-            pm_type = PM_TYPE__HTTP_CLIENT_BODY_CONTENT;
-        else
-            pm_type = PM_TYPE__CONTENT;
+        PmType pm_type = fpGetHttpPmType(pmd_uri->uri_buffer);
 
         if (fpFinishPortGroupRule(pg, pm_type, otn, pmd_uri, fp) == 0)
         {
@@ -2236,12 +2330,36 @@ static void fpPortGroupPrintRuleCount(PORT_GROUP *pg)
             case PM_TYPE__HTTP_URI_CONTENT:
                 LogMessage("\tHttp Uri Content: %d\n", count);
                 break;
+            case PM_TYPE__HTTP_RAW_URI_CONTENT:
+                LogMessage("\tHttp Raw Uri Content: %d\n", count);
+                break;
             case PM_TYPE__HTTP_HEADER_CONTENT:
                 LogMessage("\tHttp Header Content: %d\n", count);
                 break;
+            case PM_TYPE__HTTP_RAW_HEADER_CONTENT:
+                LogMessage("\tHttp Raw Header Content: %d\n", count);
+                break;
             case PM_TYPE__HTTP_CLIENT_BODY_CONTENT:
                 LogMessage("\tHttp Client Body Content: %d\n", count);
                 break;
+            case PM_TYPE__HTTP_METHOD_CONTENT:
+                LogMessage("\tHttp Method Content: %d\n", count);
+                break;
+            case PM_TYPE__HTTP_COOKIE_CONTENT:
+                LogMessage("\tHttp Cookie Content: %d\n", count);
+                break;
+            case PM_TYPE__HTTP_RAW_COOKIE_CONTENT:
+                LogMessage("\tHttp Raw Cookie Content: %d\n", count);
+                break;
+            case PM_TYPE__HTTP_STAT_CODE_CONTENT:
+                LogMessage("\tHttp Stat Code Content: %d\n", count);
+                break;
+            case PM_TYPE__HTTP_STAT_MSG_CONTENT:
+                LogMessage("\tHttp Stat Msg Content: %d\n", count);
+                break;
+            case PM_TYPE__HTTP_COMBINED_CONTENT:
+                LogMessage("\tHttp Combined Content: %d\n", count);
+                break;
             default:
                 break;
         }
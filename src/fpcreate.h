@@ -97,6 +97,7 @@ typedef struct _FastPatternConfig
     int configured;
     int portlists_flags;
     int split_any_any;
+    int combine_http_buffers;
     int max_pattern_len;
     int num_patterns_truncated;  /* due to max_pattern_len */
     int num_patterns_trimmed;    /* due to zero byte prefix */
@@ -176,6 +177,7 @@ void fpSetDebugMode(FastPatternConfig *);
 void fpSetStreamInsert(FastPatternConfig *);
 void fpSetMaxQueueEvents(FastPatternConfig *, unsigned int);
 void fpDetectSetSplitAnyAny(FastPatternConfig *, int);
+void fpDetectSetCombineHttpBuffers(FastPatternConfig *, int);
 void fpSetMaxPatternLen(FastPatternConfig *, unsigned int);
 
 void fpDetectSetSingleRuleGroup(FastPatternConfig *);
@@ -195,6 +197,7 @@ int  fpDetectGetDebugPrintRuleGroupBuildDetails(FastPatternConfig *);
 int  fpDetectGetDebugPrintRuleGroupsCompiled(FastPatternConfig *);
 int  fpDetectGetDebugPrintRuleGroupsUnCompiled(FastPatternConfig *);
 int  fpDetectSplitAnyAny(FastPatternConfig *);
+int  fpDetectCombineHttpBuffers(FastPatternConfig *);
 int  fpDetectGetDebugPrintFastPatterns(FastPatternConfig *);
 
 void fpDeleteFastPacketDetection(struct _SnortConfig *);
@@ -106,6 +106,7 @@ static inline int fpEvalHeaderUdp(Packet *p, OTNX_MATCH_DATA *);
 static inline int fpEvalHeaderSW(PORT_GROUP *port_group, Packet *p,
                                  int check_ports, char ip_rule, OTNX_MATCH_DATA *);
 static int rule_tree_match (void* id, void * tree, int index, void * data, void *neg_list );
+static int rule_tree_match_http (void* id, void * tree, int index, void * data, void *neg_list );
 static inline int fpAddSessionAlert(Packet *p, OptTreeNode *otn, int alerted);
 static inline int fpSessionAlerted(Packet *p, OptTreeNode *otn);
 
@@ -600,6 +601,29 @@ static int detection_option_tree_evaluate(detection_option_tree_root_t *root, de
     return rval;
 }
 
+/*
+**  When the pipelined requests of a PDU are detected together, a tree is
+**  evaluated against each of their http buffer sets.  Options that don't
+**  depend on the set keep their cached result after the first one.
+*/
+static inline int detection_option_tree_evaluate_sets(detection_option_tree_root_t *root,
+        detection_option_eval_data_t *eval_data)
+{
+    OTNX_MATCH_DATA *pomd = (OTNX_MATCH_DATA *)eval_data->pomd;
+    int set, rval = 0;
+
+    if (!HttpBufferSetCount || pomd->http_set_fixed)
+        return detection_option_tree_evaluate(root, eval_data);
+
+    for (set = 0; set < HttpBufferSetCount; set++)
+    {
+        HttpBufferSetLoad(eval_data->p, set);
+        rval += detection_option_tree_evaluate(root, eval_data);
+    }
+
+    return rval;
+}
+
 static int rule_tree_match( void * id, void *tree, int index, void * data, void * neg_list)
 {
     OTNX_MATCH_DATA  *pomd   = (OTNX_MATCH_DATA *)data;
@@ -635,7 +659,7 @@ static int rule_tree_match( void * id, void *tree, int index, void * data, void
         neg_pmd->last_check.rebuild_flag = (eval_data.p->packet_flags & REBUILD_FLAGS);
     }
 
-    rval = detection_option_tree_evaluate(root, &eval_data);
+    rval = detection_option_tree_evaluate_sets(root, &eval_data);
     if (rval)
     {
         /*
@@ -699,6 +723,22 @@ static int rule_tree_match( void * id, void *tree, int index, void * data, void
     return 0;
 }
 
+/*
+**  Match callback for the combined http matcher.  A match state can hold
+**  patterns meant for several http buffers; skip it when none of them are
+**  for the buffer being searched.
+*/
+static int rule_tree_match_http( void * id, void *tree, int index, void * data, void * neg_list)
+{
+    OTNX_MATCH_DATA *pomd = (OTNX_MATCH_DATA *)data;
+    detection_option_tree_root_t *root = (detection_option_tree_root_t *)tree;
+
+    if (!(root->http_buffers & (1 << pomd->http_buffer)))
+        return 0;
+
+    return rule_tree_match(id, tree, index, data, neg_list);
+}
+
 static int sortOrderByPriority(const void *e1, const void *e2)
 {
     OptTreeNode *otn1;
@@ -1146,16 +1186,27 @@ static inline int fpEvalHeaderSW(PORT_GROUP *port_group, Packet *p,
             SnortPolicy *policy = snort_conf->targeted_policies[policy_id];
             /* safe to assume policy is non NULL here because of check in
              * Preprocess() */
-            DetectionEvalFuncNode *idx = policy->detect_eval_funcs;
+            DetectionEvalFuncNode *idx;
+            int set = 0;
 
-            for (; (idx != NULL) && !(p->packet_flags & PKT_PASS_RULE); idx = idx->next)
+            /* These may look at the http buffers, so run them for each
+             * set of pipelined requests being detected together */
+            do
             {
-                if ((p->proto_bits & idx->proto_mask) || (idx->proto_mask == PROTO_BIT__ALL))
-                    //IsDetectBitSet(p, idx->preproc_bit))
+                if (HttpBufferSetCount)
+                    HttpBufferSetLoad(p, set);
+
+                idx = policy->detect_eval_funcs;
+
+                for (; (idx != NULL) && !(p->packet_flags & PKT_PASS_RULE); idx = idx->next)
                 {
-                    idx->func(p, idx->context);
+                    if ((p->proto_bits & idx->proto_mask) || (idx->proto_mask == PROTO_BIT__ALL))
+                        //IsDetectBitSet(p, idx->preproc_bit))
+                    {
+                        idx->func(p, idx->context);
+                    }
                 }
-            }
+            } while (++set < HttpBufferSetCount);
         }
 
         if (fp->inspect_stream_insert || !(p->packet_flags & PKT_STREAM_INSERT))
@@ -1169,43 +1220,59 @@ static inline int fpEvalHeaderSW(PORT_GROUP *port_group, Packet *p,
              **   This check indicates that http_decode found
              **   at least one uri
              */
-            if (p->uri_count > 0)
+            if ((p->uri_count > 0) || HttpBufferSetCount)
             {
-                int i;
+                int i, set = 0;
 
-                for (i = HTTP_BUFFER_URI; (i < p->uri_count) && (i <= HTTP_BUFFER_CLIENT_BODY); i++)
+                /* Matches in a set's buffers are only evaluated against
+                 * that set */
+                do
                 {
-                    if ((UriBufs[i].uri == NULL) || (UriBufs[i].length == 0))
-                        continue;
-
-                    switch (i)
+                    if (HttpBufferSetCount)
                     {
-                        case HTTP_BUFFER_URI:
-                            so = (void *)port_group->pgPms[PM_TYPE__HTTP_URI_CONTENT];
-                            break;
-                        case HTTP_BUFFER_HEADER:
-                            so = (void *)port_group->pgPms[PM_TYPE__HTTP_HEADER_CONTENT];
-                            break;
-                        case HTTP_BUFFER_CLIENT_BODY:
-                            so = (void *)port_group->pgPms[PM_TYPE__HTTP_CLIENT_BODY_CONTENT];
-                            break;
-                        default:
-                            so = NULL;
-                            break;
+                        HttpBufferSetLoad(p, set);
+                        omd->http_set_fixed = 1;
                     }
 
-                    if ((so != NULL) && (mpseGetPatternCount(so) > 0))
+                    for (i = HTTP_BUFFER_URI; (i < p->uri_count) && (i < HTTP_BUFFER_MAX); i++)
                     {
-                        start_state = 0;
-                        mpseSearch(so, UriBufs[i].uri, UriBufs[i].length,
-                                rule_tree_match, omd, &start_state);
+                        if ((UriBufs[i].uri == NULL) || (UriBufs[i].length == 0))
+                            continue;
+
+                        /* One automaton for every buffer when the http matchers
+                         * are combined; it stays in cache across the buffers */
+                        so = (void *)port_group->pgPms[PM_TYPE__HTTP_COMBINED_CONTENT];
+
+                        if ((so != NULL) && (mpseGetPatternCount(so) > 0))
+                        {
+                            omd->http_buffer = i;
+                            start_state = 0;
+                            mpseSearch(so, UriBufs[i].uri, UriBufs[i].length,
+                                    rule_tree_match_http, omd, &start_state);
+#ifdef PPM_MGR
+                            /* Bail if we spent too much time already */
+                            if (PPM_PACKET_ABORT_FLAG())
+                                goto fp_eval_header_sw_reset_ip;
+#endif
+                        }
+
+                        so = (void *)port_group->pgPms[PM_TYPE__HTTP_BUFFER(i)];
+
+                        if ((so != NULL) && (mpseGetPatternCount(so) > 0))
+                        {
+                            start_state = 0;
+                            mpseSearch(so, UriBufs[i].uri, UriBufs[i].length,
+                                    rule_tree_match, omd, &start_state);
 #ifdef PPM_MGR
-                        /* Bail if we spent too much time already */
-                        if (PPM_PACKET_ABORT_FLAG())
-                            goto fp_eval_header_sw_reset_ip;
+                            /* Bail if we spent too much time already */
+                            if (PPM_PACKET_ABORT_FLAG())
+                                goto fp_eval_header_sw_reset_ip;
 #endif
+                        }
                     }
-                }
+                } while (++set < HttpBufferSetCount);
+
+                omd->http_set_fixed = 0;
             }
 
             /*
@@ -1315,7 +1382,7 @@ static inline int fpEvalHeaderSW(PORT_GROUP *port_group, Packet *p,
             eval_data.flowbit_noalert = 0;
 
             PREPROC_PROFILE_START(ncrulePerfStats);
-            rval = detection_option_tree_evaluate(port_group->pgNonContentTree, &eval_data);
+            rval = detection_option_tree_evaluate_sets(port_group->pgNonContentTree, &eval_data);
             PREPROC_PROFILE_END(ncrulePerfStats);
 
             if (rval)
@@ -1353,6 +1420,8 @@ static inline int fpEvalHeaderSW(PORT_GROUP *port_group, Packet *p,
 #ifdef PPM_MGR  /* Tag only used with PPM right now */
 fp_eval_header_sw_reset_ip:
 #endif
+    omd->http_set_fixed = 0;
+
     if (ip_rule)
     {
         /* Set the data & dsize back to original values. */
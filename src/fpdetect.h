@@ -87,6 +87,8 @@ typedef struct
     PORT_GROUP * pg;
     Packet * p;
     int check_ports;
+    int http_buffer;    /* HTTP_BUFFER_* being searched by the combined matcher */
+    int http_set_fixed; /* matches are for the http buffer set being searched */
 
     MATCH_INFO *matchInfo;
     int iMatchInfoArraySize;
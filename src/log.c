@@ -1603,6 +1603,7 @@ void PrintEmbeddedICMPHeader(FILE *fp, const ICMPHdr *icmph)
 void PrintIpOptions(FILE * fp, Packet * p)
 {
     int i;
+    const Options *opts;
     int j;
     u_long init_offset;
     u_long print_offset;
@@ -1612,6 +1613,8 @@ void PrintIpOptions(FILE * fp, Packet * p)
     if(!p->ip_option_count || p->ip_option_count > 40)
         return;
 
+    opts = GetIpOptions(p);
+
     fprintf(fp, "IP Options (%d) => ", p->ip_option_count);
 
     for(i = 0; i < (int) p->ip_option_count; i++)
@@ -1624,7 +1627,7 @@ void PrintIpOptions(FILE * fp, Packet * p)
             init_offset = ftell(fp);
         }
 
-        switch(p->ip_options[i].code)
+        switch(opts[i].code)
         {
             case IPOPT_RR:
                 fwrite("RR ", 3, 1, fp);
@@ -1668,14 +1671,14 @@ void PrintIpOptions(FILE * fp, Packet * p)
                 break;
 
             default:
-                fprintf(fp, "Opt %d: ", p->ip_options[i].code);
+                fprintf(fp, "Opt %d: ", opts[i].code);
 
-                if(p->ip_options[i].len)
+                if(opts[i].len)
                 {
-                    for(j = 0; j < p->ip_options[i].len; j++)
+                    for(j = 0; j < opts[i].len; j++)
                     {
-                        if (p->ip_options[i].data)
-                            fprintf(fp, "%02X", p->ip_options[i].data[j]);
+                        if (opts[i].data)
+                            fprintf(fp, "%02X", opts[i].data[j]);
                         else
                             fprintf(fp, "%02X", 0);
 
@@ -1694,6 +1697,7 @@ void PrintIpOptions(FILE * fp, Packet * p)
 void PrintTcpOptions(FILE * fp, Packet * p)
 {
     int i;
+    const Options *opts;
     int j;
     u_char tmp[5];
     u_long init_offset;
@@ -1706,6 +1710,8 @@ void PrintTcpOptions(FILE * fp, Packet * p)
     if(p->tcp_option_count > 40 || !p->tcp_option_count)
         return;
 
+    opts = GetTcpOptions(p);
+
     for(i = 0; i < (int) p->tcp_option_count; i++)
     {
         print_offset = ftell(fp);
@@ -1716,13 +1722,13 @@ void PrintTcpOptions(FILE * fp, Packet * p)
             init_offset = ftell(fp);
         }
 
-        switch(p->tcp_options[i].code)
+        switch(opts[i].code)
         {
             case TCPOPT_MAXSEG:
                 bzero((char *) tmp, 5);
                 fwrite("MSS: ", 5, 1, fp);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 2);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 2);
                 fprintf(fp, "%u ", EXTRACT_16BITS(tmp));
                 break;
 
@@ -1735,20 +1741,20 @@ void PrintTcpOptions(FILE * fp, Packet * p)
                 break;
 
             case TCPOPT_WSCALE:
-                if (p->tcp_options[i].data)
-                    fprintf(fp, "WS: %u ", p->tcp_options[i].data[0]);
+                if (opts[i].data)
+                    fprintf(fp, "WS: %u ", opts[i].data[0]);
                 else
                     fprintf(fp, "WS: %u ", 0);
                 break;
 
             case TCPOPT_SACK:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data && (p->tcp_options[i].len >= 2))
-                    memcpy(tmp, p->tcp_options[i].data, 2);
+                if (opts[i].data && (opts[i].len >= 2))
+                    memcpy(tmp, opts[i].data, 2);
                 fprintf(fp, "Sack: %u@", EXTRACT_16BITS(tmp));
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data && (p->tcp_options[i].len >= 4))
-                    memcpy(tmp, (p->tcp_options[i].data) + 2, 2);
+                if (opts[i].data && (opts[i].len >= 4))
+                    memcpy(tmp, (opts[i].data) + 2, 2);
                 fprintf(fp, "%u ", EXTRACT_16BITS(tmp));
                 break;
 
@@ -1758,60 +1764,60 @@ void PrintTcpOptions(FILE * fp, Packet * p)
 
             case TCPOPT_ECHO:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "Echo: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_ECHOREPLY:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "Echo Rep: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_TIMESTAMP:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "TS: %u ", EXTRACT_32BITS(tmp));
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, (p->tcp_options[i].data) + 4, 4);
+                if (opts[i].data)
+                    memcpy(tmp, (opts[i].data) + 4, 4);
                 fprintf(fp, "%u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CC:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "CC %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CCNEW:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "CCNEW: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CCECHO:
                 bzero((char *) tmp, 5);
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 fprintf(fp, "CCECHO: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             default:
-                if(p->tcp_options[i].len)
+                if(opts[i].len)
                 {
-                    fprintf(fp, "Opt %d (%d): ", p->tcp_options[i].code,
-                            (int) p->tcp_options[i].len);
+                    fprintf(fp, "Opt %d (%d): ", opts[i].code,
+                            (int) opts[i].len);
 
-                    for(j = 0; j < p->tcp_options[i].len; j++)
+                    for(j = 0; j < opts[i].len; j++)
                     {
-                        if (p->tcp_options[i].data)
-                            fprintf(fp, "%02X", p->tcp_options[i].data[j]);
+                        if (opts[i].data)
+                            fprintf(fp, "%02X", opts[i].data[j]);
                         else
                             fprintf(fp, "%02X", 0);
 
@@ -1823,7 +1829,7 @@ void PrintTcpOptions(FILE * fp, Packet * p)
                 }
                 else
                 {
-                    fprintf(fp, "Opt %d ", p->tcp_options[i].code);
+                    fprintf(fp, "Opt %d ", opts[i].code);
                 }
                 break;
         }
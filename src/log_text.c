@@ -431,6 +431,7 @@ void Log2ndHeader(TextLog* log, Packet* p)
 static void LogIpOptions(TextLog*  log, Packet * p)
 {
     int i;
+    const Options *opts;
     int j;
     u_long init_offset;
     u_long print_offset;
@@ -440,6 +441,8 @@ static void LogIpOptions(TextLog*  log, Packet * p)
     if(!p->ip_option_count || p->ip_option_count > 40)
         return;
 
+    opts = GetIpOptions(p);
+
     TextLog_Print(log, "IP Options (%d) => ", p->ip_option_count);
 
     for(i = 0; i < (int) p->ip_option_count; i++)
@@ -452,7 +455,7 @@ static void LogIpOptions(TextLog*  log, Packet * p)
             init_offset = TextLog_Tell(log);
         }
 
-        switch(p->ip_options[i].code)
+        switch(opts[i].code)
         {
             case IPOPT_RR:
                 TextLog_Puts(log, "RR ");
@@ -496,14 +499,14 @@ static void LogIpOptions(TextLog*  log, Packet * p)
                 break;
 
             default:
-                TextLog_Print(log, "Opt %d: ", p->ip_options[i].code);
+                TextLog_Print(log, "Opt %d: ", opts[i].code);
 
-                if(p->ip_options[i].len)
+                if(opts[i].len)
                 {
-                    for(j = 0; j < p->ip_options[i].len; j++)
+                    for(j = 0; j < opts[i].len; j++)
                     {
-                        if (p->ip_options[i].data)
-                            TextLog_Print(log, "%02X", p->ip_options[i].data[j]);
+                        if (opts[i].data)
+                            TextLog_Print(log, "%02X", opts[i].data[j]);
                         else
                             TextLog_Print(log, "%02X", 0);
 
@@ -699,6 +702,7 @@ static void LogOuterIPHeader(TextLog *log, Packet *p)
 static void LogTcpOptions(TextLog*  log, Packet * p)
 {
     int i;
+    const Options *opts;
     int j;
     u_char tmp[5];
     u_long init_offset;
@@ -711,6 +715,8 @@ static void LogTcpOptions(TextLog*  log, Packet * p)
     if(p->tcp_option_count > 40 || !p->tcp_option_count)
         return;
 
+    opts = GetTcpOptions(p);
+
     for(i = 0; i < (int) p->tcp_option_count; i++)
     {
         print_offset = TextLog_Tell(log);
@@ -721,13 +727,13 @@ static void LogTcpOptions(TextLog*  log, Packet * p)
             init_offset = TextLog_Tell(log);
         }
         **/
-        switch(p->tcp_options[i].code)
+        switch(opts[i].code)
         {
             case TCPOPT_MAXSEG:
                 memset((char*)tmp, 0, sizeof(tmp));
                 TextLog_Puts(log, "MSS: ");
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 2);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 2);
                 TextLog_Print(log, "%u ", EXTRACT_16BITS(tmp));
                 break;
 
@@ -740,19 +746,19 @@ static void LogTcpOptions(TextLog*  log, Packet * p)
                 break;
 
             case TCPOPT_WSCALE:
-                if (p->tcp_options[i].data)
-                    TextLog_Print(log, "WS: %u ", p->tcp_options[i].data[0]);
+                if (opts[i].data)
+                    TextLog_Print(log, "WS: %u ", opts[i].data[0]);
                 else
                     TextLog_Print(log, "WS: %u ", 0);
                 break;
             case TCPOPT_SACK:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data && (p->tcp_options[i].len >= 2))
-                    memcpy(tmp, p->tcp_options[i].data, 2);
+                if (opts[i].data && (opts[i].len >= 2))
+                    memcpy(tmp, opts[i].data, 2);
                 TextLog_Print(log, "Sack: %u@", EXTRACT_16BITS(tmp));
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data && (p->tcp_options[i].len >= 4))
-                    memcpy(tmp, (p->tcp_options[i].data) + 2, 2);
+                if (opts[i].data && (opts[i].len >= 4))
+                    memcpy(tmp, (opts[i].data) + 2, 2);
                 TextLog_Print(log, "%u ", EXTRACT_16BITS(tmp));
                 break;
 
@@ -762,60 +768,60 @@ static void LogTcpOptions(TextLog*  log, Packet * p)
 
             case TCPOPT_ECHO:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "Echo: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_ECHOREPLY:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "Echo Rep: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_TIMESTAMP:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "TS: %u ", EXTRACT_32BITS(tmp));
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, (p->tcp_options[i].data) + 4, 4);
+                if (opts[i].data)
+                    memcpy(tmp, (opts[i].data) + 4, 4);
                 TextLog_Print(log, "%u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CC:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "CC %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CCNEW:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "CCNEW: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             case TCPOPT_CCECHO:
                 memset((char*)tmp, 0, sizeof(tmp));
-                if (p->tcp_options[i].data)
-                    memcpy(tmp, p->tcp_options[i].data, 4);
+                if (opts[i].data)
+                    memcpy(tmp, opts[i].data, 4);
                 TextLog_Print(log, "CCECHO: %u ", EXTRACT_32BITS(tmp));
                 break;
 
             default:
-                if(p->tcp_options[i].len)
+                if(opts[i].len)
                 {
-                    TextLog_Print(log, "Opt %d (%d): ", p->tcp_options[i].code,
-                            (int) p->tcp_options[i].len);
+                    TextLog_Print(log, "Opt %d (%d): ", opts[i].code,
+                            (int) opts[i].len);
 
-                    for(j = 0; j < p->tcp_options[i].len; j++)
+                    for(j = 0; j < opts[i].len; j++)
                     {
-                        if (p->tcp_options[i].data)
-                            TextLog_Print(log, "%02X", p->tcp_options[i].data[j]);
+                        if (opts[i].data)
+                            TextLog_Print(log, "%02X", opts[i].data[j]);
                         else
                             TextLog_Print(log, "%02X", 0);
 
@@ -827,7 +833,7 @@ static void LogTcpOptions(TextLog*  log, Packet * p)
                 }
                 else
                 {
-                    TextLog_Print(log, "Opt %d ", p->tcp_options[i].code);
+                    TextLog_Print(log, "Opt %d ", opts[i].code);
                 }
                 break;
         }
@@ -95,6 +95,7 @@
 #include "sfutil/sfportobject.h"
 #include "sfutil/strvec.h"
 #include "active.h"
+#include "flow_bypass.h"
 #include "file_config.h"
 #include "file_service_config.h"
 
@@ -232,6 +233,7 @@
 #define DETECTION_OPT__SEARCH_METHOD                         "search-method"
 #define DETECTION_OPT__SEARCH_OPTIMIZE                       "search-optimize"
 #define DETECTION_OPT__SPLIT_ANY_ANY                         "split-any-any"
+#define DETECTION_OPT__COMBINE_HTTP_BUFFERS                  "combine-http-buffers"
 #define DETECTION_OPT__MAX_PATTERN_LEN                       "max-pattern-len"
 #define DETECTION_OPT__DEBUG_PRINT_FAST_PATTERN              "debug-print-fast-pattern"
 
@@ -301,6 +303,8 @@
 #define RESPONSE_OPT__ATTEMPTS  "attempts"
 #define RESPONSE_OPT__DEVICE    "device"
 #define RESPONSE_OPT__DST_MAC   "dst_mac"
+#define RESPONSE_OPT__QUEUE     "queue"
+#define RESPONSE_OPT__RATE      "rate"
 #endif
 
 #define ERR_PAIR_COUNT \
@@ -676,6 +680,7 @@ static const ConfigFunc config_opts[] =
     { CONFIG_OPT__RESPONSE, 1, 1, 1, ConfigResponse },
 #endif
     { CONFIG_OPT__FLOWBITS_SIZE, 1, 1, 1, ConfigFlowbitsSize },
+    { CONFIG_OPT__FLOW_BYPASS, 1, 1, 1, ConfigFlowBypass },
     { CONFIG_OPT__IGNORE_PORTS, 1, 0, 1, ConfigIgnorePorts },
     { CONFIG_OPT__ALERT_VLAN, 0, 1, 1, ConfigIncludeVlanInAlert },
     { CONFIG_OPT__INTERFACE, 1, 1, 1, ConfigInterface },
@@ -686,6 +691,7 @@ static const ConfigFunc config_opts[] =
     { CONFIG_OPT__DAQ_MODE, 1, 1, 1, ConfigDaqMode },
     { CONFIG_OPT__DAQ_VAR, 1, 0, 1, ConfigDaqVar },
     { CONFIG_OPT__DAQ_DIR, 1, 0, 1, ConfigDaqDir },
+    { CONFIG_OPT__DAQ_BURST, 1, 1, 1, ConfigDaqBurst },
     { CONFIG_OPT__DIRTY_PIG, 0, 1, 1, ConfigDirtyPig },
 #ifdef TARGET_BASED
     { CONFIG_OPT__MAX_ATTRIBUTE_HOSTS, 1, 1, 1, ConfigMaxAttributeHosts },
@@ -6655,6 +6661,10 @@ void ConfigDetection(SnortConfig *sc, char *args)
         {
             fpDetectSetSplitAnyAny(fp, 1);
         }
+        else if (strcasecmp(toks[i], DETECTION_OPT__COMBINE_HTTP_BUFFERS) == 0)
+        {
+            fpDetectSetCombineHttpBuffers(fp, 1);
+        }
         else if (strcasecmp(toks[i], DETECTION_OPT__MAX_PATTERN_LEN) == 0)
         {
             i++;
@@ -7345,6 +7355,32 @@ void ConfigResponse (SnortConfig *sc, char *args)
                 ParseError("No argument to 'dst_mac'.  Use format 12:34:56:78:90:1a");
             }
         }
+        else if ( !strcasecmp(toks[i], RESPONSE_OPT__QUEUE) ||
+            !strcasecmp(toks[i], RESPONSE_OPT__RATE) )
+        {
+            int queue = !strcasecmp(toks[i], RESPONSE_OPT__QUEUE);
+            uint32_t max = queue ? MAX_RESPOND_QUEUE : UINT32_MAX;
+
+            if ( ++i < num_toks )
+            {
+                char *endptr;
+                unsigned long value = SnortStrtoulRange(toks[i], &endptr, 0, 0, max);
+
+                if ((errno == ERANGE) || (*endptr != '\0'))
+                {
+                    ParseError("Invalid argument for %s: %s.  Argument must "
+                        "be between 0 and %u inclusive.", toks[i-1], toks[i], max);
+                }
+                if ( queue )
+                    sc->respond_queue = (uint32_t)value;
+                else
+                    sc->respond_rate = (uint32_t)value;
+            }
+            else
+            {
+                ParseError("No argument to '%s'.", toks[i-1]);
+            }
+        }
         else
         {
             ParseError("Invalid config response option '%s'", toks[i]);
@@ -7362,6 +7398,46 @@ void ConfigFlowbitsSize(SnortConfig *sc, char *args)
     sc->flowbit_size = (uint16_t)getFlowbitSizeInBytes();
 }
 
+void ConfigFlowBypass(SnortConfig *sc, char *args)
+{
+    char **toks;
+    int num_toks;
+    unsigned long value;
+    char *endptr;
+
+    if ((sc == NULL) || (args == NULL))
+        return;
+
+    toks = mSplit(args, " \t", 2, &num_toks, 0);
+
+    value = SnortStrtoulRange(toks[0], &endptr, 0, 0, FLOW_BYPASS_MAX_ENTRIES);
+
+    if ( (errno == ERANGE) || (*endptr != '\0') )
+    {
+        ParseError(
+            "Invalid entries for '%s' configuration: %s.  "
+            "Must be between 0 (off) and %u (max).",
+            CONFIG_OPT__FLOW_BYPASS, toks[0], FLOW_BYPASS_MAX_ENTRIES);
+    }
+    sc->flow_bypass_entries = (uint32_t)value;
+
+    if ( num_toks > 1 )
+    {
+        value = SnortStrtoulRange(toks[1], &endptr, 0, 1, UINT32_MAX);
+
+        if ( (errno == ERANGE) || (*endptr != '\0') )
+        {
+            ParseError(
+                "Invalid timeout for '%s' configuration: %s.  "
+                "Must be a positive number of seconds.",
+                CONFIG_OPT__FLOW_BYPASS, toks[1]);
+        }
+        sc->flow_bypass_timeout = (uint32_t)value;
+    }
+
+    mSplitFree(&toks, num_toks);
+}
+
 /****************************************************************************
  *
  * Purpose: Parses a protocol plus a list of ports.
@@ -7631,6 +7707,26 @@ void ConfigDaqMode(SnortConfig *sc, char *args)
     sc->daq_mode = SnortStrdup(args);
 }
 
+void ConfigDaqBurst(SnortConfig *sc, char *args)
+{
+    unsigned long value;
+    char *endptr;
+
+    if ( !args || !sc )
+        return;
+
+    value = SnortStrtoulRange(args, &endptr, 0, 1, DAQ_BURST_MAX);
+
+    if ( (errno == ERANGE) || (*endptr != '\0') )
+    {
+        ParseError(
+            "Invalid value for '%s' configuration: %s.  "
+            "Must be between 1 and %u frames.",
+            CONFIG_OPT__DAQ_BURST, args, DAQ_BURST_MAX);
+    }
+    sc->daq_burst = (uint32_t)value;
+}
+
 void ConfigDaqVar(SnortConfig *sc, char *args)
 {
     if ( !args || !sc )
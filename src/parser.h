@@ -141,6 +141,7 @@
 # define CONFIG_OPT__RESPONSE                       "response"
 #endif
 #define CONFIG_OPT__FLOWBITS_SIZE                   "flowbits_size"
+#define CONFIG_OPT__FLOW_BYPASS                     "flow_bypass"
 #define CONFIG_OPT__IGNORE_PORTS                    "ignore_ports"
 #define CONFIG_OPT__ALERT_VLAN                      "include_vlan_in_alerts"
 #define CONFIG_OPT__INTERFACE                       "interface"
@@ -151,6 +152,7 @@
 #define CONFIG_OPT__DAQ_MODE                        "daq_mode"
 #define CONFIG_OPT__DAQ_VAR                         "daq_var"
 #define CONFIG_OPT__DAQ_DIR                         "daq_dir"
+#define CONFIG_OPT__DAQ_BURST                       "daq_burst"
 #define CONFIG_OPT__DIRTY_PIG                       "dirty_pig"
 #ifdef TARGET_BASED
 # define CONFIG_OPT__MAX_ATTRIBUTE_HOSTS            "max_attribute_hosts"
@@ -318,6 +320,7 @@ void ConfigLayer2Resets(SnortConfig *, char *);
 void ConfigLogDir(SnortConfig *, char *);
 void ConfigDaqType(SnortConfig *, char *);
 void ConfigDaqMode(SnortConfig *, char *);
+void ConfigDaqBurst(SnortConfig *, char *);
 void ConfigDaqVar(SnortConfig *, char *);
 void ConfigDaqDir(SnortConfig *, char *);
 void ConfigDirtyPig(SnortConfig *, char *);
@@ -342,6 +345,7 @@ void ConfigNoPromiscuous(SnortConfig *, char *);
 void ConfigObfuscate(SnortConfig *, char *);
 void ConfigObfuscationMask(SnortConfig *, char *);
 void ConfigPafMax(SnortConfig *, char *);
+void ConfigFlowBypass(SnortConfig *, char *);
 void ConfigRateFilter(SnortConfig *, char *);
 void ConfigRuleListOrder(SnortConfig *, char *);
 void ConfigPacketCount(SnortConfig *, char *);
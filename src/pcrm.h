@@ -51,17 +51,28 @@ typedef void * RULE_PTR;
 #define PRM_GET_FIRST_GROUP_NODE_NC(pg) (pg->pgHeadNC)
 #define PRM_GET_NEXT_GROUP_NODE_NC(rn)  (rn->rnNext)
 
+/* The http types follow the HTTP_BUFFER_* order in detection_util.h so
+ * the matcher for a buffer is PM_TYPE__HTTP_BUFFER(buffer id) */
 typedef enum _PmType
 {
     PM_TYPE__CONTENT = 0,
     PM_TYPE__HTTP_URI_CONTENT,
+    PM_TYPE__HTTP_RAW_URI_CONTENT,
     PM_TYPE__HTTP_HEADER_CONTENT,
+    PM_TYPE__HTTP_RAW_HEADER_CONTENT,
     PM_TYPE__HTTP_CLIENT_BODY_CONTENT,
     PM_TYPE__HTTP_METHOD_CONTENT,
+    PM_TYPE__HTTP_COOKIE_CONTENT,
+    PM_TYPE__HTTP_RAW_COOKIE_CONTENT,
+    PM_TYPE__HTTP_STAT_CODE_CONTENT,
+    PM_TYPE__HTTP_STAT_MSG_CONTENT,
+    PM_TYPE__HTTP_COMBINED_CONTENT,   /* all buffers, combine-http-buffers */
     PM_TYPE__MAX
 
 } PmType;
 
+#define PM_TYPE__HTTP_BUFFER(b)  ((PmType)(PM_TYPE__HTTP_URI_CONTENT + (b)))
+
 typedef struct _not_rule_node_ {
 
   struct _not_rule_node_ * next;
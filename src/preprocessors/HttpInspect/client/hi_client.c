@@ -81,9 +81,38 @@
 #define HEADER_NAME__TRANSFER_ENCODING "Transfer-encoding"
 #define HEADER_LENGTH__TRANSFER_ENCODING 17
 
+/* response only; see hi_server.c */
+#define HEADER_NAME__SET_COOKIE "Set-Cookie"
+#define HEADER_LENGTH__SET_COOKIE 10
+#define HEADER_NAME__CONTENT_TYPE "Content-Type"
+#define HEADER_LENGTH__CONTENT_TYPE 12
+#define HEADER_NAME__CONTENT_ENCODING "Content-Encoding"
+#define HEADER_LENGTH__CONTENT_ENCODING 16
+
 const u_char *proxy_start = NULL;
 const u_char *proxy_end = NULL;
 
+HI_PHASH *hi_header_names = NULL;
+
+static const struct
+{
+    const char *name;
+    size_t len;
+    HI_HDR_ID id;
+
+} hi_header_list[] =
+{
+    { HEADER_NAME__COOKIE, HEADER_LENGTH__COOKIE, HI_HDR_COOKIE },
+    { HEADER_NAME__CONTENT_LENGTH, HEADER_LENGTH__CONTENT_LENGTH, HI_HDR_CONTENT_LENGTH },
+    { HEADER_NAME__XFF, HEADER_LENGTH__XFF, HI_HDR_XFF },
+    { HEADER_NAME__TRUE_IP, HEADER_LENGTH__TRUE_IP, HI_HDR_TRUE_IP },
+    { HEADER_NAME__HOSTNAME, HEADER_LENGTH__HOSTNAME, HI_HDR_HOSTNAME },
+    { HEADER_NAME__TRANSFER_ENCODING, HEADER_LENGTH__TRANSFER_ENCODING, HI_HDR_TRANSFER_ENCODING },
+    { HEADER_NAME__SET_COOKIE, HEADER_LENGTH__SET_COOKIE, HI_HDR_SET_COOKIE },
+    { HEADER_NAME__CONTENT_TYPE, HEADER_LENGTH__CONTENT_TYPE, HI_HDR_CONTENT_TYPE },
+    { HEADER_NAME__CONTENT_ENCODING, HEADER_LENGTH__CONTENT_ENCODING, HI_HDR_CONTENT_ENCODING },
+};
+
 /**  This makes passing function arguments much more readable and easier
 **  to follow.
 */
@@ -95,6 +124,12 @@ typedef int (*LOOKUP_FCN)(HI_SESSION *, const u_char *, const u_char *, const u_
 **  (like whitespace and the HTTP delimiter \r and \n).
 */
 LOOKUP_FCN lookup_table[256];
+
+/*
+**  Line ends of the PDU being inspected; reset when a packet's first
+**  request is parsed and reused for the pipelined ones after it.
+*/
+static HI_PDU_LINES pdu_lines;
 int NextNonWhiteSpace(HI_SESSION *Session, const u_char *start,
         const u_char *end, const u_char **ptr, URI_PTR *uri_ptr);
 extern const u_char *extract_http_transfer_encoding(HI_SESSION *, HttpSessionData *,
@@ -443,14 +478,17 @@ static inline const u_char *FindPipelineReq(HI_SESSION *Session,
             const u_char *start, const u_char *end)
 {
     const u_char *p;
-    u_char *offset;
+    const u_char *offset;
+    const u_char *lim;
+    const u_char *nl;
+    int long_hdr;
 
     if(!start || !end)
         return NULL;
 
     p = start;
 
-    offset = (u_char*)p;
+    offset = p;
 
     /*
     **  We say end - 6 because we need at least six bytes to verify that
@@ -461,44 +499,60 @@ static inline const u_char *FindPipelineReq(HI_SESSION *Session,
     **  a.k.a there needs to be data after the initial request to inspect
     **  to make it worth our while.
     */
-    while(p < (end - 6))
+    lim = end - 6;
+
+    /*
+    **  The line ends come from the PDU index.  Unless we are checking
+    **  header lengths only the ones that end a header block matter, so
+    **  we go straight to those.
+    */
+    long_hdr = hi_eo_generate_event(Session, Session->server_conf->max_hdr_len);
+
+    while(p < lim)
     {
-        if(*p == '\n')
+        if(long_hdr)
+            nl = hi_util_pdu_lines_next(&pdu_lines, p, lim);
+        else
+            nl = hi_util_pdu_lines_blank(&pdu_lines, p, lim, end);
+
+        if(!nl)
         {
-            if(hi_eo_generate_event(Session, Session->server_conf->max_hdr_len)
-               && ((p - offset) >= Session->server_conf->max_hdr_len))
-            {
-                hi_eo_client_event_log(Session, HI_EO_CLIENT_LONG_HDR, NULL, NULL);
-            }
+            p = lim;
+            break;
+        }
+        p = nl;
 
-            p++;
+        if(long_hdr && ((p - offset) >= Session->server_conf->max_hdr_len))
+        {
+            hi_eo_client_event_log(Session, HI_EO_CLIENT_LONG_HDR, NULL, NULL);
+        }
 
-            offset = (u_char*)p;
+        p++;
+
+        offset = p;
 
-            if(*p < 0x0E)
+        if(*p < 0x0E)
+        {
+            if(*p == '\r')
             {
-                if(*p == '\r')
-                {
-                    p++;
+                p++;
 
-                    if(*p == '\n')
-                    {
-                        return ++p;
-                    }
-                }
-                else if(*p == '\n')
+                if(*p == '\n')
                 {
                     return ++p;
                 }
             }
+            else if(*p == '\n')
+            {
+                return ++p;
+            }
         }
 
         p++;
     }
 
     /* Never observed an end-of-field.  Maybe it's not there, but the header is long anyway: */
-    if(hi_eo_generate_event(Session, Session->server_conf->max_hdr_len)
-       && ((p - start) >= Session->server_conf->max_hdr_len))
+    if(long_hdr && ((p - start) >= Session->server_conf->max_hdr_len))
     {
         hi_eo_client_event_log(Session, HI_EO_CLIENT_LONG_HDR, NULL, NULL);
     }
@@ -1763,10 +1817,10 @@ const u_char *extract_http_cookie(const u_char *p, const u_char *end, HEADER_PTR
     header_field_ptr->cookie->cookie = p;
 
     {
-        crlf = (u_char *)SnortStrnStr((const char *)p, end - p, "\n");
+        crlf = hi_util_lines_find(header_ptr->lines, p, end);
 
         /* find a \n  */
-        if (crlf) /* && hi_util_in_bounds(start, end, crlf+1)) bounds is checked in SnortStrnStr */
+        if (crlf) /* && hi_util_in_bounds(start, end, crlf+1)) bounds is checked in hi_util_lines_find */
         {
             if(*(crlf -1) == '\r')
                 header_field_ptr->cookie->cookie_end = crlf - 1;
@@ -1790,7 +1844,7 @@ const u_char *extract_http_xff(HI_SESSION *Session, const u_char *p, const u_cha
 {
     int num_spaces = 0;
     SFIP_RET status;
-    sfip_t *tmp;
+    sfip_t tmp;
     char *ipAddr = NULL;
     uint8_t unfold_buf[DECODE_BLEN];
     uint32_t unfold_size =0;
@@ -1856,7 +1910,9 @@ const u_char *extract_http_xff(HI_SESSION *Session, const u_char *p, const u_cha
             ipAddr = SnortStrndup((const char *)start_ptr, cur_ptr - start_ptr );
         if(ipAddr)
         {
-            if( (tmp = sfip_alloc(ipAddr, &status)) == NULL )
+            /* parse on the stack; the session only pays for the address
+             * once it has one */
+            if( (status = sfip_pton(ipAddr, &tmp)) != SFIP_SUCCESS )
             {
                 if((status != SFIP_ARG_ERR) && (status !=SFIP_ALLOC_ERR))
                 {
@@ -1870,10 +1926,9 @@ const u_char *extract_http_xff(HI_SESSION *Session, const u_char *p, const u_cha
             }
             if(*true_ip)
             {
-                if(!IP_EQUALITY(*true_ip, tmp))
+                if(!IP_EQUALITY(*true_ip, &tmp))
                 {
-                    sfip_free(*true_ip);
-                    *true_ip = tmp;
+                    **true_ip = tmp;
 
                     //alert
                     if(hi_eo_generate_event(Session, HI_EO_CLIENT_MULTIPLE_TRUEIP_IN_SESSION))
@@ -1881,12 +1936,9 @@ const u_char *extract_http_xff(HI_SESSION *Session, const u_char *p, const u_cha
                         hi_eo_client_event_log(Session, HI_EO_CLIENT_MULTIPLE_TRUEIP_IN_SESSION, NULL, NULL);
                     }
                 }
-                else
-                    sfip_free(tmp);
-
             }
-            else
-                *true_ip = tmp;
+            else if( (*true_ip = (sfip_t *)HttpSessionMemAlloc(&hi_true_ip_pool)) != NULL )
+                **true_ip = tmp;
             free(ipAddr);
         }
 
@@ -2085,7 +2137,7 @@ const u_char *extract_http_content_length(HI_SESSION *Session,
                                 header_field_ptr->content_len->cont_len_end = NULL;
                             header_field_ptr->content_len->len = 0;
 
-                            crlf = (u_char *)SnortStrnStr((const char *)p, end - p, "\n");
+                            crlf = hi_util_lines_find(header_ptr->lines, p, end);
                             if (crlf)
                             {
                                 return p;
@@ -2116,7 +2168,7 @@ const u_char *extract_http_content_length(HI_SESSION *Session,
                                 header_field_ptr->content_len->cont_len_start =
                                     header_field_ptr->content_len->cont_len_end = NULL;
                                 header_field_ptr->content_len->len = 0;
-                                crlf = (u_char *)SnortStrnStr((const char *)p, end - p, "\n");
+                                crlf = hi_util_lines_find(header_ptr->lines, p, end);
                                 if (crlf)
                                 {
                                     p = crlf;
@@ -2146,7 +2198,7 @@ const u_char *extract_http_content_length(HI_SESSION *Session,
     {
         if(hi_util_in_bounds(start, end, p))
         {
-            crlf = (u_char *)SnortStrnStr((const char *)p, end - p, "\n");
+            crlf = hi_util_lines_find(header_ptr->lines, p, end);
             if(crlf)
             {
                 p = crlf;
@@ -2187,70 +2239,77 @@ static inline const u_char *extractHeaderFieldValues(HI_SESSION *Session,
     HttpSessionData *hsd;
 
     hsd = hdrs_args->sd;
-    if (((p - offset) == 0) && ((*p == 'C') || (*p == 'c')))
+
+    if ((p - offset) != 0)
+        return p;
+
+    switch (hi_header_id(p, end))
     {
-        /* Search for 'Cookie' at beginning, starting from current *p */
-        if ( ServerConf->enable_cookie &&
-                IsHeaderFieldName(p, end, HEADER_NAME__COOKIE, HEADER_LENGTH__COOKIE))
+    case HI_HDR_COOKIE:
+        if ( ServerConf->enable_cookie )
         {
             p = extract_http_cookie((p+ HEADER_LENGTH__COOKIE), end, hdrs_args->hdr_ptr, hdrs_args->hdr_field_ptr);
         }
-        else if ( IsHeaderFieldName(p, end, HEADER_NAME__CONTENT_LENGTH, HEADER_LENGTH__CONTENT_LENGTH) )
+        break;
+
+    case HI_HDR_CONTENT_LENGTH:
+        p = extract_http_content_length(Session, ServerConf, p, start,
+                                        end, hdrs_args->hdr_ptr, hdrs_args->hdr_field_ptr );
+        break;
+
+    case HI_HDR_XFF:
+        if ( (ServerConf->enable_xff) && hsd )
         {
-            p = extract_http_content_length(Session, ServerConf, p, start,
-                                            end, hdrs_args->hdr_ptr, hdrs_args->hdr_field_ptr );
+            hdrs_args->true_clnt_xff |= XFF_HDR;
+            p = p + HEADER_LENGTH__XFF;
+            p = extract_http_xff(Session, p, start, end, hdrs_args);
         }
-    }
-    else if (((p - offset) == 0) && ((*p == 'x') || (*p == 'X') || (*p == 't') || (*p == 'T')))
-    {
+        break;
+
+    case HI_HDR_TRUE_IP:
         if ( (ServerConf->enable_xff) && hsd )
         {
-            if(IsHeaderFieldName(p, end, HEADER_NAME__XFF, HEADER_LENGTH__XFF))
-            {
-                hdrs_args->true_clnt_xff |= XFF_HDR;
-                p = p + HEADER_LENGTH__XFF;
-                p = extract_http_xff(Session, p, start, end, hdrs_args);
-            }
-            else if(IsHeaderFieldName(p, end, HEADER_NAME__TRUE_IP, HEADER_LENGTH__TRUE_IP))
-            {
-                hdrs_args->true_clnt_xff |= TRUE_CLIENT_IP_HDR;
-                p = p + HEADER_LENGTH__TRUE_IP;
-                p = extract_http_xff(Session, p, start, end, hdrs_args);
-            }
+            hdrs_args->true_clnt_xff |= TRUE_CLIENT_IP_HDR;
+            p = p + HEADER_LENGTH__TRUE_IP;
+            p = extract_http_xff(Session, p, start, end, hdrs_args);
         }
-        else if ( IsHeaderFieldName(p, end, HEADER_NAME__TRANSFER_ENCODING,
-                                    HEADER_LENGTH__TRANSFER_ENCODING) && hsd)
+        break;
+
+    case HI_HDR_TRANSFER_ENCODING:
+        /* as before, transfer-encoding isn't looked at when xff is enabled */
+        if ( !ServerConf->enable_xff && hsd )
         {
             p = p + HEADER_LENGTH__TRANSFER_ENCODING;
             p = extract_http_transfer_encoding(Session, hsd, p, start, end, hdrs_args->hdr_ptr, HI_SI_CLIENT_MODE);
         }
-    }
-    else if(((p - offset) == 0) && ((*p == 'H') || (*p == 'h')))
-    {
-        if(IsHeaderFieldName(p, end, HEADER_NAME__HOSTNAME, HEADER_LENGTH__HOSTNAME))
+        break;
+
+    case HI_HDR_HOSTNAME:
+        /* Alert when there are multiple host headers in one request */
+        if(hdrs_args->hst_name_hdr)
         {
-            /* Alert when there are multiple host headers in one request */
-            if(hdrs_args->hst_name_hdr)
+            if(hi_eo_generate_event(Session, HI_EO_CLIENT_MULTIPLE_HOST_HDRS))
             {
-                if(hi_eo_generate_event(Session, HI_EO_CLIENT_MULTIPLE_HOST_HDRS))
-                {
-                    hi_eo_client_event_log(Session, HI_EO_CLIENT_MULTIPLE_HOST_HDRS, NULL, NULL);
-                }
-                return p;
+                hi_eo_client_event_log(Session, HI_EO_CLIENT_MULTIPLE_HOST_HDRS, NULL, NULL);
             }
-            else
+            return p;
+        }
+        else
+        {
+            hdrs_args->hst_name_hdr = 1;
+            if ( hsd && !(hdrs_args->strm_ins) && (ServerConf->log_hostname))
             {
-                hdrs_args->hst_name_hdr = 1;
-                if ( hsd && !(hdrs_args->strm_ins) && (ServerConf->log_hostname))
+                if(!SetLogBuffers(hsd))
                 {
-                    if(!SetLogBuffers(hsd))
-                    {
-                        p = p + HEADER_LENGTH__HOSTNAME;
-                        p = extract_http_hostname(Session, p, start, end, hdrs_args->hdr_ptr, hsd);
-                    }
+                    p = p + HEADER_LENGTH__HOSTNAME;
+                    p = extract_http_hostname(Session, p, start, end, hdrs_args->hdr_ptr, hsd);
                 }
             }
         }
+        break;
+
+    default:
+        break;
     }
     return p;
 }
@@ -2320,6 +2379,9 @@ static inline const u_char *hi_client_extract_header(
     header_ptr->content_len.len = 0;
     header_ptr->is_chunked = false;
 
+    if ( header_ptr->lines )
+        hi_util_lines_init(header_ptr->lines, start, end);
+
     header_ptr->header.uri = start;
     header_ptr->header.uri_end = end;
     hdrs_args.hdr_ptr = header_ptr;
@@ -2477,7 +2539,10 @@ static inline const u_char *hi_client_extract_header(
             return end;
         }
         if ( *p == '\n') continue;
-        p++;
+
+        /* nothing else in this line matters here */
+        if ( !(p = hi_util_lines_next(header_ptr->lines, p + 1, end)) )
+            p = end;
     }
 
     /* Never observed an end-of-field.  Maybe it's not there, but the header is long anyway: */
@@ -2574,6 +2639,7 @@ int StatelessInspection(HI_SESSION *Session, const unsigned char *data,
     URI_PTR uri_ptr;
     URI_PTR post_ptr;
     HEADER_PTR header_ptr;
+    HI_LINES lines;
     HTTP_CMD_CONF *CmdConf = NULL;
     const u_char *start;
     const u_char *end;
@@ -2607,6 +2673,7 @@ int StatelessInspection(HI_SESSION *Session, const unsigned char *data,
     memset(&uri_ptr, 0x00, sizeof(URI_PTR));
     memset(&post_ptr, 0x00, sizeof(URI_PTR));
     memset(&header_ptr, 0x00, sizeof(HEADER_PTR));
+    header_ptr.lines = &lines;
     memset(&method_ptr, 0x00, sizeof(URI_PTR));
 
     /*
@@ -2614,6 +2681,8 @@ int StatelessInspection(HI_SESSION *Session, const unsigned char *data,
     **  a normal request or a pipeline request.  The end boundary is always
     **  the same whether it is a pipeline request or other.
     */
+    end = data + dsize;
+
     if(Client->request.pipeline_req)
     {
         start = Client->request.pipeline_req;
@@ -2621,12 +2690,11 @@ int StatelessInspection(HI_SESSION *Session, const unsigned char *data,
     else
     {
         start = data;
+        hi_util_pdu_lines_init(&pdu_lines, data, end);
     }
 
     Client->request.pipeline_req = NULL;
 
-    end = data + dsize;
-
     ptr = start;
 #ifdef ENABLE_PAF
     if ( ScPafEnabled() )
@@ -3018,6 +3086,26 @@ int hi_client_init(HTTPINSPECT_GLOBAL_CONF *GlobalConf)
 {
     int iCtr;
 
+    /* header names don't depend on the configuration so one table does */
+    if(!hi_header_names)
+    {
+        size_t i;
+
+        if(!(hi_header_names = hi_phash_new()))
+            return HI_MEM_ALLOC_FAIL;
+
+        for(i = 0; i < sizeof(hi_header_list)/sizeof(hi_header_list[0]); i++)
+        {
+            if(hi_phash_add(hi_header_names, hi_header_list[i].name,
+                    hi_header_list[i].len, (void *)(uintptr_t)hi_header_list[i].id))
+            {
+                hi_phash_free(hi_header_names);
+                hi_header_names = NULL;
+                return HI_MEM_ALLOC_FAIL;
+            }
+        }
+    }
+
     if(GlobalConf->inspection_type == HI_UI_CONFIG_STATEFUL)
     {
         /*
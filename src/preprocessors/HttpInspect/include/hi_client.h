@@ -34,6 +34,8 @@
 #include "hi_include.h"
 #include "hi_eo.h"
 #include "hi_eo_events.h"
+#include "hi_util_lines.h"
+#include "hi_util_phash.h"
 #define URI_END  99
 #define POST_END 100
 #define NO_URI   101
@@ -114,6 +116,7 @@ typedef struct s_HEADER_PTR
     CONTLEN_PTR content_len;
     CONT_ENCODING_PTR content_encoding;
     bool is_chunked;
+    HI_LINES *lines;    /* line ends of the header block, may be NULL */
 } HEADER_PTR;
 
 
@@ -188,6 +191,34 @@ typedef struct s_HI_CLIENT_HDR_ARGS
     int true_clnt_xff;
 } HI_CLIENT_HDR_ARGS;
 
+/*
+**  Header fields that the client and server parsers extract.  The names
+**  are kept in one perfect hash built by hi_client_init(); a field is
+**  identified by the name being a (case insensitive) prefix of the line,
+**  the same as IsHeaderFieldName().
+*/
+typedef enum e_HI_HDR_ID
+{
+    HI_HDR_NONE = 0,
+    HI_HDR_COOKIE,
+    HI_HDR_SET_COOKIE,
+    HI_HDR_CONTENT_LENGTH,
+    HI_HDR_CONTENT_TYPE,
+    HI_HDR_CONTENT_ENCODING,
+    HI_HDR_TRANSFER_ENCODING,
+    HI_HDR_HOSTNAME,
+    HI_HDR_XFF,
+    HI_HDR_TRUE_IP
+
+} HI_HDR_ID;
+
+extern HI_PHASH *hi_header_names;
+
+static inline HI_HDR_ID hi_header_id(const u_char *p, const u_char *end)
+{
+    return (HI_HDR_ID)(uintptr_t)hi_phash_find_prefix(hi_header_names, p, end);
+}
+
 int hi_client_inspection(void *Session, const unsigned char *data, int dsize, HttpSessionData *hsd, int stream_ins);
 int hi_client_init(HTTPINSPECT_GLOBAL_CONF *GlobalConf);
 
@@ -53,10 +53,15 @@ typedef struct _hi_stats {
     uint64_t resp_cookie_len;
 #endif
     uint64_t total;
+    uint64_t sessions_freed;       /* sessions whose memory was reported */
+    uint64_t session_mem_freed;    /* bytes those sessions held at the end */
+    uint64_t session_mem_max;      /* most any one session held */
+    uint64_t session_memcap_drops; /* allocations refused by session_memcap */
 #ifdef ZLIB
     uint64_t gzip_pkts;
     uint64_t compr_bytes_read;
     uint64_t decompr_bytes_read;
+    uint64_t inflate_reused;       /* inflate contexts taken from the pool */
 #endif
 } HIStats;
 
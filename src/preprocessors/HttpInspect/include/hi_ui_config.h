@@ -42,6 +42,7 @@
 #include "sf_ip.h"
 #include "sfPolicy.h"
 #include "hi_util_kmap.h"
+#include "hi_util_phash.h"
 
 /*
 **  Defines
@@ -95,7 +96,14 @@ typedef enum e_PROFILES
     HI_IIS5
 } PROFILES;
 
-typedef KMAP CMD_LOOKUP;
+/* the kmap owns the method confs and is used to walk them; the perfect
+ * hash over the same keys is what the per request lookup uses. */
+typedef struct s_CMD_LOOKUP
+{
+    KMAP *km;
+    HI_PHASH *ph;
+
+} CMD_LOOKUP;
 
 typedef struct s_HTTP_CMD_CONF
 {
@@ -161,6 +169,11 @@ typedef struct s_HTTPINSPECT_CONF
     */
     char no_pipeline;
 
+    /*
+    **  detect the pipelined requests of a pdu in one pass
+    */
+    char batch_pipeline;
+
     /*
     **  Enable non-strict (apache) URI handling.  This allows us to catch the
     **  non-standard URI parsing that apache does.
@@ -214,6 +227,7 @@ typedef struct s_HTTPINSPECT_CONF
     HTTPINSPECT_CONF_OPT utf_8;
     HTTPINSPECT_CONF_OPT iis_unicode;
     char                 non_rfc_chars[256];
+    uint8_t              non_rfc_printable;  /* a non_rfc_char in 0x20-0x7f */
 
     /*
     **  These are the URI normalization configurations
@@ -274,6 +288,7 @@ typedef struct s_HTTPINSPECT_GLOBAL_CONF
     int decompr_depth;
 #endif
     int memcap;
+    int session_memcap;
     uint32_t xtra_trueip_id;
     uint32_t xtra_uri_id;
     uint32_t xtra_hname_id;
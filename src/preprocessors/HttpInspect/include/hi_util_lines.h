@@ -0,0 +1,145 @@
+/****************************************************************************
+ *
+ * Copyright (C) 2003-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+/**
+**  @file       hi_util_lines.h
+**
+**  @brief      Line end index for request and response headers.
+**
+**  The header extraction loops and the extract_http_* helpers all need
+**  to find the next '\n' from wherever they stopped.  Rather than each
+**  of them scanning byte by byte, the header block is scanned 32 bytes
+**  at a time and the line ends are kept in a small window that is
+**  refilled as the parsers move through the headers.
+*/
+
+#ifndef __HI_UTIL_LINES_H__
+#define __HI_UTIL_LINES_H__
+
+#include <string.h>
+#include "hi_include.h"
+
+#define HI_LINES_MAX 32
+
+typedef struct s_HI_LINES
+{
+    const u_char *base;     /* all line ends in [base, next) are in nl */
+    const u_char *next;
+    const u_char *end;
+    unsigned head;
+    unsigned tail;
+    const u_char *nl[HI_LINES_MAX];
+} HI_LINES;
+
+static inline void hi_util_lines_init(HI_LINES *lines, const u_char *start,
+        const u_char *end)
+{
+    lines->base = lines->next = start;
+    lines->end = end;
+    lines->head = lines->tail = 0;
+}
+
+void hi_util_lines_fill(HI_LINES *lines, const u_char *p);
+
+/*
+**  Return the first '\n' at or after p and before end or NULL if there is
+**  none.  Without an index (lines is NULL), or if p has moved back before
+**  line ends already dropped from the index, this is just memchr.
+*/
+static inline const u_char *hi_util_lines_next(HI_LINES *lines,
+        const u_char *p, const u_char *end)
+{
+    if ( p >= end )
+        return NULL;
+
+    if ( !lines || end != lines->end || p < lines->base )
+        return (const u_char *)memchr(p, '\n', end - p);
+
+    for ( ;; )
+    {
+        while ( lines->head < lines->tail && lines->nl[lines->head] < p )
+            lines->base = lines->nl[lines->head++] + 1;
+
+        if ( lines->head < lines->tail )
+            return lines->nl[lines->head];
+
+        if ( lines->next >= end )
+            return NULL;
+
+        hi_util_lines_fill(lines, p);
+    }
+}
+
+/*
+**  Same result as SnortStrnStr(p, end - p, "\n"), which the extract_http_*
+**  helpers used before: the search stops at a NUL and a '\n' in the last
+**  byte is not found.
+*/
+static inline const u_char *hi_util_lines_find(HI_LINES *lines,
+        const u_char *p, const u_char *end)
+{
+    const u_char *nl = hi_util_lines_next(lines, p, end);
+
+    if ( !nl || nl == end - 1 || memchr(p, '\0', nl - p) )
+        return NULL;
+
+    return nl;
+}
+
+/*
+**  Line end index for a whole client PDU, used to find pipelined
+**  requests.  The PDU is scanned once, front to back, as far as the
+**  lookups need, and the line ends that end a header block (followed by
+**  "\n" or "\r\n") are kept apart so the next request can be found
+**  without visiting every line.  Past the array limits the lookups fall
+**  back to memchr.
+*/
+#define HI_PDU_LINES_MAX  1024
+#define HI_PDU_BLANKS_MAX 256
+
+typedef struct s_HI_PDU_LINES
+{
+    const u_char *data;
+    const u_char *end;
+    const u_char *next;     /* all line ends in [data, next) are indexed */
+    unsigned num_nl;
+    unsigned num_blank;
+    uint32_t nl[HI_PDU_LINES_MAX];
+    uint32_t blank[HI_PDU_BLANKS_MAX];
+} HI_PDU_LINES;
+
+static inline void hi_util_pdu_lines_init(HI_PDU_LINES *pdu,
+        const u_char *data, const u_char *end)
+{
+    pdu->data = pdu->next = data;
+    pdu->end = end;
+    pdu->num_nl = pdu->num_blank = 0;
+}
+
+/* first '\n' in [p, lim) or NULL */
+const u_char *hi_util_pdu_lines_next(HI_PDU_LINES *, const u_char *p,
+        const u_char *lim);
+
+/* first '\n' in [p, lim) that is followed by "\n" or "\r\n" before end */
+const u_char *hi_util_pdu_lines_blank(HI_PDU_LINES *, const u_char *p,
+        const u_char *lim, const u_char *end);
+
+#endif  /* __HI_UTIL_LINES_H__ */
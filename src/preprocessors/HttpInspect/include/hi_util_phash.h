@@ -0,0 +1,77 @@
+/****************************************************************************
+ *
+ * Copyright (C) 2003-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+/**
+**  @file       hi_util_phash.h
+**
+**  @brief      Case insensitive perfect hash for small, fixed key sets.
+**
+**  Used for the configured request methods and the header names that
+**  HttpInspect tracks.  The table is rebuilt each time a key is added
+**  (ie at configuration time) so that every key lands in its own slot
+**  and a lookup is one hash, one probe, and one compare.
+*/
+
+#ifndef __HI_UTIL_PHASH_H__
+#define __HI_UTIL_PHASH_H__
+
+#include "hi_include.h"
+
+typedef struct s_HI_PHASH_NODE
+{
+    uint8_t *key;       /* upper case, zero padded to a multiple of 16 */
+    unsigned len;       /* 0 if the slot is empty */
+    void *data;
+} HI_PHASH_NODE;
+
+typedef struct s_HI_PHASH
+{
+    HI_PHASH_NODE *keys;    /* in the order added */
+    unsigned num_keys;
+    unsigned max_keys;
+
+    HI_PHASH_NODE *table;   /* slot_mask + 1 slots */
+    uint16_t *disp;         /* bucket_mask + 1 displacements */
+    unsigned slot_mask;
+    unsigned bucket_mask;
+    uint32_t seed;
+
+    uint32_t lens;          /* bit n is set if there is a key of length n < 32 */
+    unsigned max_len;
+} HI_PHASH;
+
+HI_PHASH *hi_phash_new(void);
+void hi_phash_free(HI_PHASH *);
+
+/* returns 0 if added, 1 if the key is already there, -1 on error */
+int hi_phash_add(HI_PHASH *, const char *key, unsigned len, void *data);
+
+/* exact match; returns the data for the key or NULL */
+void *hi_phash_find(const HI_PHASH *, const u_char *key, unsigned len);
+
+/*
+**  Returns the data for the key that is a prefix of [p, end) or NULL.
+**  Only keys shorter than 32 bytes are considered.  If more than one
+**  key could match, the shortest wins.
+*/
+void *hi_phash_find_prefix(const HI_PHASH *, const u_char *p, const u_char *end);
+
+#endif  /* __HI_UTIL_PHASH_H__ */
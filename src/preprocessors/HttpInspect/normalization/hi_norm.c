@@ -57,6 +57,11 @@
 #include "sfPolicy.h"
 #include "detection_util.h"
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define HI_NORM_SSE2
+#endif
+
 #define MAX_DIRS        2048
 
 
@@ -1389,6 +1394,132 @@ static inline int InspectUriChar(HI_SESSION *Session, int iChar,
     return HI_NONFATAL_ERR;
 }
 
+/*
+**  NAME
+**    UriSpecialChar::
+*/
+/**
+**  Returns nonzero for a byte that hi_norm_uri() can't just copy: one
+**  that may be decoded or rewritten (%, \, +, non-ASCII), one that does
+**  directory, parameter or proxy tracking (/, ?, :), or one that may
+**  raise an event (control chars and the configured non-RFC chars).
+**  Everything else goes through GetDecodedByte() and InspectUriChar()
+**  unchanged and without side effects.
+*/
+static inline int UriSpecialChar(HTTPINSPECT_CONF *ServerConf, u_char c)
+{
+    if(c < 0x20 || c > 0x7f)
+        return 1;
+
+    switch(c)
+    {
+        case '%':
+        case '\\':
+        case '+':
+        case '/':
+        case '?':
+        case ':':
+            return 1;
+    }
+
+    return ServerConf->non_rfc_chars[c];
+}
+
+/*
+**  NAME
+**    UriPlainRun::
+*/
+/**
+**  Returns the number of bytes from ptr up to the next special char.
+**  The sse2 scan covers all special chars unless a non-RFC char is
+**  printable, which isn't the usual configuration.
+*/
+static inline int UriPlainRun(HTTPINSPECT_CONF *ServerConf,
+                              const u_char *ptr, const u_char *end)
+{
+    const u_char *p = ptr;
+
+#ifdef HI_NORM_SSE2
+    if(!ServerConf->non_rfc_printable)
+    {
+        const __m128i pct    = _mm_set1_epi8('%');
+        const __m128i bslash = _mm_set1_epi8('\\');
+        const __m128i plus   = _mm_set1_epi8('+');
+        const __m128i slash  = _mm_set1_epi8('/');
+        const __m128i quest  = _mm_set1_epi8('?');
+        const __m128i colon  = _mm_set1_epi8(':');
+        const __m128i space  = _mm_set1_epi8(0x20);
+
+        while(end - p >= 16)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i *)p);
+
+            /* signed compare, so this catches >= 0x80 too */
+            __m128i m = _mm_cmplt_epi8(c, space);
+
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, pct));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, bslash));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, plus));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, slash));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, quest));
+            m = _mm_or_si128(m, _mm_cmpeq_epi8(c, colon));
+
+            if(_mm_movemask_epi8(m))
+                return (p - ptr) + __builtin_ctz(_mm_movemask_epi8(m));
+
+            p += 16;
+        }
+    }
+#endif
+
+    while(p < end && !UriSpecialChar(ServerConf, *p))
+        p++;
+
+    return p - ptr;
+}
+
+/*
+**  NAME
+**    UriPercentPlain::
+*/
+/**
+**  Decodes a %HH that stands for a plain char, with the same effects
+**  as the PercentDecode() path would have for it.  Anything else
+**  (invalid hex, %u, double encoding, or a decoded special char) is
+**  left to the full decoder.
+**
+**  @retval -1    not handled here
+**  @retval char  the decoded char; ptr is not advanced
+*/
+static inline int UriPercentPlain(HI_SESSION *Session, const u_char *ptr,
+                                  const u_char *end, URI_NORM_STATE *norm_state,
+                                  uint16_t *encodeType)
+{
+    HTTPINSPECT_CONF *ServerConf = Session->server_conf;
+    int iNorm;
+
+    if(!ServerConf->ascii.on || (end - ptr) < 3 ||
+       valid_lookup[ptr[1]] < 0 || valid_lookup[ptr[2]] < 0)
+        return -1;
+
+    iNorm = ((hex_lookup[ptr[1]] << 4) | hex_lookup[ptr[2]]) & 0xff;
+
+    if(UriSpecialChar(ServerConf, (u_char)iNorm))
+        return -1;
+
+    *encodeType |= HTTP_ENCODE_TYPE__ASCII;
+    byte_decoded = true;
+
+    if(hi_eo_generate_event(Session,ServerConf->ascii.alert) &&
+       !norm_state->param)
+    {
+        hi_eo_client_event_log(Session, HI_EO_CLIENT_ASCII,
+                               NULL, NULL);
+    }
+
+    return iNorm;
+}
+
 /*
 **  NAME
 **    hi_norm_uri::
@@ -1426,6 +1557,7 @@ int hi_norm_uri(HI_SESSION *Session, u_char *uribuf, int *uribuf_size,
     HTTPINSPECT_CONF *ServerConf;
     int iChar;
     int iRet;
+    int iRun;
     int iMaxUriBufSize;
     URI_NORM_STATE norm_state;
     u_char *ub_ptr;
@@ -1455,8 +1587,34 @@ int hi_norm_uri(HI_SESSION *Session, u_char *uribuf, int *uribuf_size,
 
     while(hi_util_in_bounds(ub_start, ub_end, ub_ptr))
     {
+        /*
+        **  Most of a URI needs no decoding, so copy the runs between
+        **  special chars straight through.
+        */
+        iRun = UriPlainRun(ServerConf, ptr, end);
+
+        if(iRun)
+        {
+            if(iRun > (ub_end - ub_ptr))
+                iRun = ub_end - ub_ptr;
+
+            memcpy(ub_ptr, ptr, iRun);
+            ub_ptr += iRun;
+            ptr += iRun;
+            continue;
+        }
+
         byte_decoded = false;
 
+        if(hi_util_in_bounds(start, end, ptr) && *ptr == '%' &&
+           (iChar = UriPercentPlain(Session, ptr, end, &norm_state, encodeType)) >= 0)
+        {
+            ptr += 3;
+            *ub_ptr = (u_char)iChar;
+            ub_ptr++;
+            continue;
+        }
+
         iChar = GetDecodedByte(Session, start, end, &ptr, &norm_state, encodeType);
         if(iChar == END_OF_BUFFER)
             break;
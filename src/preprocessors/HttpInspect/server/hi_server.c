@@ -64,9 +64,7 @@ static bool simple_response = false;
 #include "sfutil/util_unfold.h"
 
 #define STAT_END 100
-#define HTTPRESP_HEADER_NAME__COOKIE "Set-Cookie"
 #define HTTPRESP_HEADER_LENGTH__COOKIE 10
-#define HTTPRESP_HEADER_NAME__CONTENT_ENCODING "Content-Encoding"
 #define HTTPRESP_HEADER_LENGTH__CONTENT_ENCODING 16
 #define HTTPRESP_HEADER_NAME__GZIP "gzip"
 #define HTTPRESP_HEADER_NAME__XGZIP "x-gzip"
@@ -74,13 +72,12 @@ static bool simple_response = false;
 #define HTTPRESP_HEADER_LENGTH__XGZIP 6
 #define HTTPRESP_HEADER_NAME__DEFLATE "deflate"
 #define HTTPRESP_HEADER_LENGTH__DEFLATE 7
-#define HTTPRESP_HEADER_NAME__CONTENT_LENGTH "Content-length"
-#define HTTPRESP_HEADER_LENGTH__CONTENT_LENGTH 14
-#define HTTPRESP_HEADER_NAME__CONTENT_TYPE "Content-Type"
-#define HTTPRESP_HEADER_LENGTH__CONTENT_TYPE 12
-#define HTTPRESP_HEADER_NAME__TRANSFER_ENCODING "Transfer-Encoding"
 #define HTTPRESP_HEADER_LENGTH__TRANSFER_ENCODING 17
 
+/* bytes passed to stop_inspection to skip the rest of a response; stream
+ * clips it at the end of the PDU or chunk */
+#define HTTPRESP_SKIP_REMAINDER 0x7FFFFFFF
+
 typedef int (*LOOKUP_FCN)(HI_SESSION *, const u_char *, const u_char *, const u_char **,
             URI_PTR *);
 extern LOOKUP_FCN lookup_table[256];
@@ -538,7 +535,7 @@ static inline const u_char *extract_http_content_encoding(HTTPINSPECT_CONF *Serv
     {
         if(hi_util_in_bounds(start, end, p))
         {
-            crlf = (u_char *)SnortStrnStr((const char *)p, end - p, "\n");
+            crlf = hi_util_lines_find(header_ptr->lines, p, end);
             if(crlf)
             {
                 p = crlf;
@@ -619,47 +616,46 @@ static inline const u_char *extractHttpRespHeaderFieldValues(HTTPINSPECT_CONF *S
         HEADER_FIELD_PTR *header_field_ptr, int parse_cont_encoding, HttpSessionData *hsd,
         HI_SESSION *Session)
 {
-    if (((p - offset) == 0) && ((*p == 'S') || (*p == 's')))
+    if ((p - offset) != 0)
+        return p;
+
+    switch (hi_header_id(p, end))
     {
-        /* Search for 'Cookie' at beginning, starting from current *p */
-        if ( ServerConf->enable_cookie &&
-                IsHeaderFieldName(p, end, HTTPRESP_HEADER_NAME__COOKIE,
-                    HTTPRESP_HEADER_LENGTH__COOKIE))
+    case HI_HDR_SET_COOKIE:
+        if ( ServerConf->enable_cookie )
         {
             p = extract_http_cookie((p + HTTPRESP_HEADER_LENGTH__COOKIE), end, header_ptr, header_field_ptr);
         }
-    }
-    else if (((p - offset) == 0) && ((*p == 'C') || (*p == 'c')))
-    {
-        if ( IsHeaderFieldName(p, end, HTTPRESP_HEADER_NAME__CONTENT_TYPE,
-                               HTTPRESP_HEADER_LENGTH__CONTENT_TYPE) && ServerConf->normalize_utf)
+        break;
+
+    case HI_HDR_CONTENT_TYPE:
+        if ( ServerConf->normalize_utf )
         {
             p = extract_http_content_type_charset(Session, hsd, p, start, end);
         }
+        break;
 
 #ifdef ZLIB
-        else if ( IsHeaderFieldName(p, end, HTTPRESP_HEADER_NAME__CONTENT_ENCODING,
-                    HTTPRESP_HEADER_LENGTH__CONTENT_ENCODING) && ServerConf->extract_gzip &&
-                    parse_cont_encoding)
+    case HI_HDR_CONTENT_ENCODING:
+        if ( ServerConf->extract_gzip && parse_cont_encoding )
         {
             p = extract_http_content_encoding(ServerConf, p, start, end, header_ptr, header_field_ptr );
         }
+        break;
 #endif
-        else if ( IsHeaderFieldName(p, end, HTTPRESP_HEADER_NAME__CONTENT_LENGTH,
-                HTTPRESP_HEADER_LENGTH__CONTENT_LENGTH) )
-        {
-            if(!hsd->resp_state.last_pkt_chunked)
-                p = extract_http_content_length(Session, ServerConf, p, start, end, header_ptr, header_field_ptr );
-        }
-    }
-    else if (((p - offset) == 0) && ((*p == 'T') || (*p == 't')))
-    {
-        if ( IsHeaderFieldName(p, end, HTTPRESP_HEADER_NAME__TRANSFER_ENCODING,
-                               HTTPRESP_HEADER_LENGTH__TRANSFER_ENCODING))
-        {
-            p = p + HTTPRESP_HEADER_LENGTH__TRANSFER_ENCODING;
-            p = extract_http_transfer_encoding(Session, hsd, p, start, end, header_ptr, HI_SI_SERVER_MODE);
-        }
+
+    case HI_HDR_CONTENT_LENGTH:
+        if(!hsd->resp_state.last_pkt_chunked)
+            p = extract_http_content_length(Session, ServerConf, p, start, end, header_ptr, header_field_ptr );
+        break;
+
+    case HI_HDR_TRANSFER_ENCODING:
+        p = p + HTTPRESP_HEADER_LENGTH__TRANSFER_ENCODING;
+        p = extract_http_transfer_encoding(Session, hsd, p, start, end, header_ptr, HI_SI_SERVER_MODE);
+        break;
+
+    default:
+        break;
     }
     return p;
 }
@@ -688,6 +684,9 @@ static inline const u_char *hi_server_extract_header(
     header_ptr->content_len.len = 0;
     header_ptr->is_chunked = false;
 
+    if ( header_ptr->lines )
+        hi_util_lines_init(header_ptr->lines, start, end);
+
     while (hi_util_in_bounds(start, end, p))
     {
         if(*p == '\n')
@@ -738,7 +737,10 @@ static inline const u_char *hi_server_extract_header(
             return end;
         }
         if ( *p == '\n') continue;
-        p++;
+
+        /* nothing else in this line matters here */
+        if ( !(p = hi_util_lines_next(header_ptr->lines, p + 1, end)) )
+            p = end;
     }
 
     header_ptr->header.uri_end = p;
@@ -857,7 +859,6 @@ static void SetGzipBuffers(HttpSessionData *hsd, HI_SESSION *session)
                 hsd->decomp_state->compr_depth = session->global_conf->compr_depth;
                 hsd->decomp_state->decompr_depth = session->global_conf->decompr_depth;
             }
-            hsd->decomp_state->inflate_init = 0;
         }
         else
         {
@@ -866,95 +867,70 @@ static void SetGzipBuffers(HttpSessionData *hsd, HI_SESSION *session)
     }
 }
 
+/*
+**  Inflates the next piece of the body into dest.  The z_stream stays
+**  with the session across packets, chunks and PAF flushes until
+**  ResetGzipState() returns it to the pool.
+*/
 int uncompress_gzip ( u_char *dest, int destLen, const u_char *source,
         int sourceLen, HttpSessionData *sd, int *total_bytes_read, int compr_fmt)
 {
-    z_stream stream;
+    DECOMPRESS_STATE *ds = sd->decomp_state;
+    z_stream *stream = ds->d_stream;
     int err;
-    int iRet = HI_SUCCESS;
 
-   stream = sd->decomp_state->d_stream;
-
-   stream.next_in = (Bytef*)source;
-   stream.avail_in = (uInt)sourceLen;
-   if ((uLong)stream.avail_in != (uLong)sourceLen)
-   {
-       sd->decomp_state->d_stream = stream;
-       return HI_FATAL_ERR;
-   }
-
-   stream.next_out = dest;
-   stream.avail_out = (uInt)destLen;
-   if ((uLong)stream.avail_out != (uLong)destLen)
-   {
-       sd->decomp_state->d_stream = stream;
-       return HI_FATAL_ERR;
-   }
-
-
-   if(!sd->decomp_state->inflate_init)
-   {
-       sd->decomp_state->inflate_init = 1;
-       stream.zalloc = (alloc_func)0;
-       stream.zfree = (free_func)0;
-       if(compr_fmt & HTTP_RESP_COMPRESS_TYPE__DEFLATE)
-           err = inflateInit(&stream);
-       else
-           err = inflateInit2(&stream, GZIP_WBITS);
-       if (err != Z_OK)
-       {
-           sd->decomp_state->d_stream = stream;
-           return HI_FATAL_ERR;
-       }
-   }
-   else
-   {
-       stream.total_in = 0;
-       stream.total_out =0;
-   }
-
-   err = inflate(&stream, Z_SYNC_FLUSH);
-   if ((!sd->decomp_state->deflate_initialized)
-           && (err == Z_DATA_ERROR)
-           && (compr_fmt & HTTP_RESP_COMPRESS_TYPE__DEFLATE))
-   {
-       /* Might not have zlib header - add one */
-       static char zlib_header[2] = { 0x78, 0x01 };
-
-       inflateReset(&stream);
-       stream.next_in = (Bytef *)zlib_header;
-       stream.avail_in = sizeof(zlib_header);
-
-       sd->decomp_state->deflate_initialized = true;
-
-       err = inflate(&stream, Z_SYNC_FLUSH);
-       if (err == Z_OK)
-       {
-           stream.next_in = (Bytef*)source;
-           stream.avail_in = (uInt)sourceLen;
-
-           err = inflate(&stream, Z_SYNC_FLUSH);
-       }
-   }
-
-   if ((err != Z_STREAM_END) && (err !=Z_OK))
-   {
-
-       /* If some of the compressed data is decompressed we need to provide that for detection */
-       if( stream.total_out > 0)
-       {
-           *total_bytes_read = stream.total_out;
-           iRet = HI_NONFATAL_ERR;
-       }
-       else
-           iRet = HI_FATAL_ERR;
-       inflateEnd(&stream);
-       sd->decomp_state->d_stream = stream;
-       return iRet;
-   }
-   *total_bytes_read = stream.total_out;
-   sd->decomp_state->d_stream = stream;
-   return HI_SUCCESS;
+    if ((sourceLen < 0) || (destLen < 0))
+        return HI_FATAL_ERR;
+
+    if (stream == NULL)
+    {
+        /* start of the body; the header tells gzip from zlib */
+        stream = HttpInspectInflateGet(AUTO_WBITS);
+
+        if (stream == NULL)
+            return HI_FATAL_ERR;
+
+        ds->d_stream = stream;
+    }
+
+    stream->next_in = (Bytef*)source;
+    stream->avail_in = (uInt)sourceLen;
+    stream->next_out = dest;
+    stream->avail_out = (uInt)destLen;
+
+    err = inflate(stream, Z_SYNC_FLUSH);
+
+    /* Some servers send deflate without the zlib header.  Retry the start
+     * of the body, once, as raw deflate. */
+    if ((err == Z_DATA_ERROR) && !ds->raw_deflate && !ds->compr_bytes_read
+            && (compr_fmt & HTTP_RESP_COMPRESS_TYPE__DEFLATE))
+    {
+        ds->raw_deflate = 1;
+
+        if (HttpInspectInflateReset(stream, DEFLATE_RAW_WBITS) == Z_OK)
+        {
+            stream->next_in = (Bytef*)source;
+            stream->avail_in = (uInt)sourceLen;
+            stream->next_out = dest;
+            stream->avail_out = (uInt)destLen;
+
+            err = inflate(stream, Z_SYNC_FLUSH);
+        }
+    }
+
+    *total_bytes_read = destLen - stream->avail_out;
+
+    if ((err != Z_STREAM_END) && (err != Z_OK))
+    {
+        /* If some of the compressed data is decompressed we need to provide
+         * that for detection.  Data errors are sticky so the next packet
+         * fails and the state is reset then. */
+        if (*total_bytes_read > 0)
+            return HI_NONFATAL_ERR;
+
+        return HI_FATAL_ERR;
+    }
+    return HI_SUCCESS;
 }
 
 static inline int hi_server_decompress(HI_SESSION *Session, HttpSessionData *sd, const u_char *ptr,
@@ -1217,6 +1193,27 @@ static inline void ResetState (HttpSessionData* sd)
     ResetRespState(&(sd->resp_state));
 }
 
+#ifdef ENABLE_PAF
+/* True once nothing more is wanted from the current response body, ie
+ * only headers are inspected or the extract limit (which covers both
+ * server_flow_depth and the file depth) has been reached. */
+static inline bool ResponseBodyDone (HTTPINSPECT_CONF *ServerConf, HttpSessionData *sd)
+{
+    if ( !sd->resp_state.inspect_body
+#ifdef ZLIB
+        && !(sd->decomp_state && sd->decomp_state->decompress_data)
+#endif
+    )
+        return false;
+
+    if ( ServerConf->server_extract_size == -1 )
+        return true;
+
+    return ( (ServerConf->server_extract_size > 0) &&
+        (sd->resp_state.data_extracted >= ServerConf->server_extract_size) );
+}
+#endif
+
 int HttpResponseInspection(HI_SESSION *Session, Packet *p, const unsigned char *data,
         int dsize, HttpSessionData *sd)
 {
@@ -1224,6 +1221,7 @@ int HttpResponseInspection(HI_SESSION *Session, Packet *p, const unsigned char *
     URI_PTR stat_code_ptr;
     URI_PTR stat_msg_ptr;
     HEADER_PTR header_ptr;
+    HI_LINES lines;
     URI_PTR body_ptr;
     HI_SERVER *Server;
 
@@ -1388,6 +1386,7 @@ int HttpResponseInspection(HI_SESSION *Session, Packet *p, const unsigned char *
     memset(&stat_code_ptr, 0x00, sizeof(URI_PTR));
     memset(&stat_msg_ptr, 0x00, sizeof(URI_PTR));
     memset(&header_ptr, 0x00, sizeof(HEADER_PTR));
+    header_ptr.lines = &lines;
     memset(&body_ptr, 0x00, sizeof(URI_PTR));
 
     start = data;
@@ -1710,6 +1709,18 @@ int HttpResponseInspection(HI_SESSION *Session, Packet *p, const unsigned char *
         ApplyFlowDepth(ServerConf, p, sd, resp_header_size, 1, seq_num);
     }
 
+#ifdef ENABLE_PAF
+    /* Don't have stream rebuild the rest of a body we won't look at */
+    if ( ScPafEnabled() && (sd != NULL) &&
+        (p->packet_flags & PKT_REBUILT_STREAM) &&
+        !(p->packet_flags & PKT_PDU_TAIL) &&
+        ResponseBodyDone(ServerConf, sd) )
+    {
+        stream_api->stop_inspection(p->ssnptr, p, SSN_DIR_CLIENT,
+            HTTPRESP_SKIP_REMAINDER, 0);
+    }
+#endif
+
     return HI_SUCCESS;
 }
 
@@ -267,16 +267,33 @@ int hi_server_norm(HI_SESSION *Session, HttpSessionData *hsd)
     {
         int js_present, status, index;
         char *ptr, *start, *end;
+        int *unicode_map = NULL;
         JSState js;
 
         js.allowed_spaces = Session->server_conf->max_js_ws;
         js.allowed_levels = MAX_ALLOWED_OBFUSCATION;
         js.alerts = 0;
+        js.resume = hsd ? &hsd->resp_state.js_resume : NULL;
+
+        if(Session->server_conf->iis_unicode.on)
+            unicode_map = Session->server_conf->iis_unicode_map;
 
         js_present = status = index = 0;
         start = (char *)ServerResp->body;
         ptr = start;
         end = start + ServerResp->body_size;
+
+        /* the previous segment ended inside a script, so this one starts
+         * with javascript rather than html.  pick up where it stopped. */
+        if(js.resume && js.resume->in_script)
+        {
+            int bytes_copied = 0;
+
+            js_present = 1;
+            JSNormalizeDecode(start, (uint16_t)(end-start), (char *)HttpDecodeBuf.data, (uint16_t)sizeof(HttpDecodeBuf.data),
+                    &ptr, &bytes_copied, &js, unicode_map);
+            index += bytes_copied;
+        }
         
         while(ptr < end)
         {
@@ -334,16 +351,8 @@ int hi_server_norm(HI_SESSION *Session, HttpSessionData *hsd)
                 if(!type_js)
                     continue;
 
-                if(Session->server_conf->iis_unicode.on)
-                {
-                    JSNormalizeDecode(js_start, (uint16_t)(end-js_start), (char *)HttpDecodeBuf.data+index, (uint16_t)(sizeof(HttpDecodeBuf.data) - index), 
-                            &ptr, &bytes_copied, &js, Session->server_conf->iis_unicode_map);
-                }
-                else
-                {
-                    JSNormalizeDecode(js_start, (uint16_t)(end-js_start), (char *)HttpDecodeBuf.data+index, (uint16_t)(sizeof(HttpDecodeBuf.data) - index), 
-                                                    &ptr, &bytes_copied, &js, NULL);
-                }
+                JSNormalizeDecode(js_start, (uint16_t)(end-js_start), (char *)HttpDecodeBuf.data+index, (uint16_t)(sizeof(HttpDecodeBuf.data) - index), 
+                        &ptr, &bytes_copied, &js, unicode_map);
                 index += bytes_copied;
             }
             else
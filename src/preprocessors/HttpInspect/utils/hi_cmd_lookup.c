@@ -46,14 +46,24 @@
  */
 int http_cmd_lookup_init(CMD_LOOKUP **CmdLookup)
 {
-    KMAP *km = KMapNew((KMapUserFreeFunc)HttpInspectCleanupHttpMethodsConf);
-    *CmdLookup = km;
+    CMD_LOOKUP *cl = (CMD_LOOKUP *)calloc(1, sizeof(CMD_LOOKUP));
+
+    *CmdLookup = cl;
     if(*CmdLookup == NULL)
     {
         return -1;
     }
 
-    km->nocase = 1;
+    cl->km = KMapNew((KMapUserFreeFunc)HttpInspectCleanupHttpMethodsConf);
+    cl->ph = hi_phash_new();
+
+    if(!cl->km || !cl->ph)
+    {
+        http_cmd_lookup_cleanup(CmdLookup);
+        return -1;
+    }
+
+    cl->km->nocase = 1;
 
     return 0;
 }
@@ -72,16 +82,20 @@ int http_cmd_lookup_init(CMD_LOOKUP **CmdLookup)
  */
 int http_cmd_lookup_cleanup(CMD_LOOKUP **CmdLookup)
 {
-    KMAP *km;
+    CMD_LOOKUP *cl;
 
     if (CmdLookup == NULL)
         return -1;
 
-    km = *CmdLookup;
+    cl = *CmdLookup;
 
-    if (km)
+    if (cl)
     {
-        KMapDelete(km);
+        if (cl->km)
+            KMapDelete(cl->km);
+
+        hi_phash_free(cl->ph);
+        free(cl);
         *CmdLookup = NULL;
     }
 
@@ -118,7 +132,7 @@ int http_cmd_lookup_add(CMD_LOOKUP *CmdLookup, char *cmd, int len,
         return -1;
     }
 
-    iRet = KMapAdd(CmdLookup, (void *)cmd, len, (void *)HTTPCmd);
+    iRet = KMapAdd(CmdLookup->km, (void *)cmd, len, (void *)HTTPCmd);
     if (iRet)
     {
         /*
@@ -134,6 +148,12 @@ int http_cmd_lookup_add(CMD_LOOKUP *CmdLookup, char *cmd, int len,
         }
     }
 
+    /* the kmap now owns HTTPCmd so there is nothing to undo here */
+    if (hi_phash_add(CmdLookup->ph, cmd, len, (void *)HTTPCmd))
+    {
+        return -1;
+    }
+
     return 0;
 }
 
@@ -175,7 +195,8 @@ HTTP_CMD_CONF  *http_cmd_lookup_find(CMD_LOOKUP *CmdLookup,
 
     *iError = 0;
 
-    HTTPCmd = (HTTP_CMD_CONF *)KMapFind(CmdLookup,(void *)cmd,len);
+    HTTPCmd = (HTTP_CMD_CONF *)hi_phash_find(
+        CmdLookup->ph, (const u_char *)cmd, len);
     if (!HTTPCmd)
     {
         *iError = -1;
@@ -215,7 +236,7 @@ HTTP_CMD_CONF *http_cmd_lookup_first(CMD_LOOKUP *CmdLookup,
 
     *iError = 0;
 
-    HTTPCmd = (HTTP_CMD_CONF *)KMapFindFirst(CmdLookup);
+    HTTPCmd = (HTTP_CMD_CONF *)KMapFindFirst(CmdLookup->km);
     if (!HTTPCmd)
     {
         *iError = -1;
@@ -258,7 +279,7 @@ HTTP_CMD_CONF *http_cmd_lookup_next(CMD_LOOKUP *CmdLookup,
 
     *iError = 0;
 
-    HTTPCmd = (HTTP_CMD_CONF *)KMapFindNext(CmdLookup);
+    HTTPCmd = (HTTP_CMD_CONF *)KMapFindNext(CmdLookup->km);
     if (!HTTPCmd)
     {
         *iError = -1;
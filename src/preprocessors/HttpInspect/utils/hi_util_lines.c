@@ -0,0 +1,303 @@
+/****************************************************************************
+ *
+ * Copyright (C) 2003-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+/**
+**  @file       hi_util_lines.c
+**
+**  @brief      Fills the line end index declared in hi_util_lines.h.
+**
+**  On x86_64 each 32 byte block is compared against '\n' with sse2 and
+**  the result is reduced to a bit mask so a block without a line end
+**  costs a couple of instructions.  Other platforms use memchr.  The
+**  PDU index is filled the same way but keeps every line end it finds.
+*/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hi_util_lines.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define HI_LINES_SSE2
+#endif
+
+/*
+**  Index up to HI_LINES_MAX line ends starting at p (or where the last
+**  fill stopped if that is later).  lines->next is left just past the
+**  last line end stored, or at end if the rest of the block has none.
+*/
+void hi_util_lines_fill(HI_LINES *lines, const u_char *p)
+{
+    const u_char *end = lines->end;
+    unsigned n = 0;
+
+    if ( p < lines->next )
+        p = lines->next;
+
+    lines->base = p;
+
+#ifdef HI_LINES_SSE2
+    {
+        const __m128i lf = _mm_set1_epi8('\n');
+
+        while ( end - p >= 32 )
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)p);
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, lf)) |
+                ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b, lf)) << 16);
+
+            while ( mask )
+            {
+                const u_char *nl = p + __builtin_ctz(mask);
+                lines->nl[n++] = nl;
+
+                if ( n == HI_LINES_MAX )
+                {
+                    lines->next = nl + 1;
+                    lines->head = 0;
+                    lines->tail = n;
+                    return;
+                }
+                mask &= mask - 1;
+            }
+            p += 32;
+        }
+    }
+#endif
+
+    while ( p < end )
+    {
+        const u_char *nl = (const u_char *)memchr(p, '\n', end - p);
+
+        if ( !nl )
+            break;
+
+        lines->nl[n++] = nl;
+        p = nl + 1;
+
+        if ( n == HI_LINES_MAX )
+            break;
+    }
+    lines->next = ( n == HI_LINES_MAX ) ? p : end;
+    lines->head = 0;
+    lines->tail = n;
+}
+
+static inline int hi_util_is_blank(const u_char *nl, const u_char *end)
+{
+    if ( nl + 1 >= end )
+        return 0;
+
+    if ( nl[1] == '\n' )
+        return 1;
+
+    return ( nl[1] == '\r' && nl + 2 < end && nl[2] == '\n' );
+}
+
+static inline int hi_util_pdu_full(const HI_PDU_LINES *pdu)
+{
+    return ( pdu->num_nl == HI_PDU_LINES_MAX ||
+             pdu->num_blank == HI_PDU_BLANKS_MAX );
+}
+
+/* index of the first entry >= off */
+static inline unsigned hi_util_lower_bound(const uint32_t *a, unsigned n,
+        uint32_t off)
+{
+    unsigned lo = 0, hi = n;
+
+    while ( lo < hi )
+    {
+        unsigned mid = (lo + hi) / 2;
+
+        if ( a[mid] < off )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*
+**  Record one line end.  Returns 0 if it didn't fit, in which case
+**  pdu->next is left at nl so everything before it stays consistent.
+*/
+static inline int hi_util_pdu_add(HI_PDU_LINES *pdu, const u_char *nl)
+{
+    int blank = hi_util_is_blank(nl, pdu->end);
+
+    if ( pdu->num_nl == HI_PDU_LINES_MAX ||
+         (blank && pdu->num_blank == HI_PDU_BLANKS_MAX) )
+    {
+        pdu->next = nl;
+        return 0;
+    }
+    pdu->nl[pdu->num_nl++] = nl - pdu->data;
+
+    if ( blank )
+        pdu->blank[pdu->num_blank++] = nl - pdu->data;
+
+    return 1;
+}
+
+/*
+**  Scan forward from pdu->next until at least one more line end is
+**  indexed, the arrays are full, or the end of the PDU.
+*/
+static void hi_util_pdu_fill(HI_PDU_LINES *pdu)
+{
+    const u_char *p = pdu->next;
+    const u_char *end = pdu->end;
+    unsigned n = pdu->num_nl;
+
+#ifdef HI_LINES_SSE2
+    {
+        const __m128i lf = _mm_set1_epi8('\n');
+
+        while ( end - p >= 32 )
+        {
+            __m128i a = _mm_loadu_si128((const __m128i *)p);
+            __m128i b = _mm_loadu_si128((const __m128i *)(p + 16));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, lf)) |
+                ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(b, lf)) << 16);
+
+            while ( mask )
+            {
+                if ( !hi_util_pdu_add(pdu, p + __builtin_ctz(mask)) )
+                    return;
+
+                mask &= mask - 1;
+            }
+            p += 32;
+
+            if ( pdu->num_nl > n )
+            {
+                pdu->next = p;
+                return;
+            }
+        }
+    }
+#endif
+
+    while ( p < end )
+    {
+        const u_char *nl = (const u_char *)memchr(p, '\n', end - p);
+
+        if ( !nl )
+            break;
+
+        if ( !hi_util_pdu_add(pdu, nl) )
+            return;
+
+        pdu->next = nl + 1;
+        return;
+    }
+    pdu->next = end;
+}
+
+static inline int hi_util_pdu_valid(const HI_PDU_LINES *pdu,
+        const u_char *p, const u_char *lim)
+{
+    return ( pdu && pdu->data && p >= pdu->data && lim <= pdu->end );
+}
+
+const u_char *hi_util_pdu_lines_next(HI_PDU_LINES *pdu, const u_char *p,
+        const u_char *lim)
+{
+    if ( p >= lim )
+        return NULL;
+
+    if ( hi_util_pdu_valid(pdu, p, lim) )
+    {
+        uint32_t off = p - pdu->data;
+
+        for ( ;; )
+        {
+            unsigned i = hi_util_lower_bound(pdu->nl, pdu->num_nl, off);
+
+            if ( i < pdu->num_nl )
+            {
+                const u_char *nl = pdu->data + pdu->nl[i];
+                return ( nl < lim ) ? nl : NULL;
+            }
+            if ( pdu->next >= lim )
+                return NULL;
+
+            if ( hi_util_pdu_full(pdu) )
+            {
+                if ( p < pdu->next )
+                    p = pdu->next;
+                break;
+            }
+            hi_util_pdu_fill(pdu);
+        }
+    }
+    return (const u_char *)memchr(p, '\n', lim - p);
+}
+
+const u_char *hi_util_pdu_lines_blank(HI_PDU_LINES *pdu, const u_char *p,
+        const u_char *lim, const u_char *end)
+{
+    const u_char *nl;
+
+    if ( p >= lim )
+        return NULL;
+
+    if ( hi_util_pdu_valid(pdu, p, lim) && end == pdu->end )
+    {
+        uint32_t off = p - pdu->data;
+
+        for ( ;; )
+        {
+            unsigned i = hi_util_lower_bound(pdu->blank, pdu->num_blank, off);
+
+            if ( i < pdu->num_blank )
+            {
+                nl = pdu->data + pdu->blank[i];
+                return ( nl < lim ) ? nl : NULL;
+            }
+            if ( pdu->next >= lim )
+                return NULL;
+
+            if ( hi_util_pdu_full(pdu) )
+            {
+                if ( p < pdu->next )
+                    p = pdu->next;
+                break;
+            }
+            hi_util_pdu_fill(pdu);
+        }
+    }
+
+    while ( p < lim && (nl = (const u_char *)memchr(p, '\n', lim - p)) )
+    {
+        if ( hi_util_is_blank(nl, end) )
+            return nl;
+
+        p = nl + 1;
+    }
+    return NULL;
+}
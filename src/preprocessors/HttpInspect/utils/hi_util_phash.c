@@ -0,0 +1,381 @@
+/****************************************************************************
+ *
+ * Copyright (C) 2003-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+/**
+**  @file       hi_util_phash.c
+**
+**  @brief      Hash and displace perfect hash; see hi_util_phash.h.
+**
+**  Keys are hashed with a seeded, case folded FNV-1a so the hash of a
+**  prefix falls out of the hash of the whole string.  A key goes to
+**  bucket b = mix(h) and then to slot (h + disp[b]) & slot_mask.  The
+**  build places the biggest buckets first, searching for a displacement
+**  that puts all of the bucket's keys in empty slots; if that fails the
+**  seed is changed and eventually the table is doubled.  Compares fold
+**  16 bytes at a time with sse2 where available.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "hi_util_phash.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <emmintrin.h>
+#define HI_PHASH_SSE2
+#endif
+
+#define HI_PHASH_CHUNK  16
+#define HI_PHASH_SEEDS  64
+#define HI_PHASH_GROW    4   /* times the table may double per build */
+
+static inline uint8_t hi_phash_fold(uint8_t c)
+{
+    return ( c >= 'a' && c <= 'z' ) ? c - 0x20 : c;
+}
+
+static inline uint32_t hi_phash_step(uint32_t h, uint8_t c)
+{
+    return (h ^ hi_phash_fold(c)) * 16777619;
+}
+
+static inline unsigned hi_phash_bucket(const HI_PHASH *ph, uint32_t h)
+{
+    return ((h * 0x9E3779B1) >> 16) & ph->bucket_mask;
+}
+
+static inline int hi_phash_equal(const uint8_t *key, const u_char *p, unsigned len)
+{
+#ifdef HI_PHASH_SSE2
+    const __m128i lo = _mm_set1_epi8('a' - 1);
+    const __m128i hi = _mm_set1_epi8('z' + 1);
+    const __m128i up = _mm_set1_epi8(0x20);
+
+    while ( len >= HI_PHASH_CHUNK )
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)p);
+        __m128i k = _mm_loadu_si128((const __m128i *)key);
+
+        /* bytes >= 0x80 are negative here so they are never folded */
+        __m128i az = _mm_and_si128(_mm_cmpgt_epi8(c, lo), _mm_cmplt_epi8(c, hi));
+        c = _mm_sub_epi8(c, _mm_and_si128(az, up));
+
+        if ( _mm_movemask_epi8(_mm_cmpeq_epi8(c, k)) != 0xFFFF )
+            return 0;
+
+        p += HI_PHASH_CHUNK;
+        key += HI_PHASH_CHUNK;
+        len -= HI_PHASH_CHUNK;
+    }
+#endif
+    while ( len-- )
+    {
+        if ( hi_phash_fold(*p++) != *key++ )
+            return 0;
+    }
+    return 1;
+}
+
+static inline void *hi_phash_probe(const HI_PHASH *ph, uint32_t h,
+        const u_char *p, unsigned len)
+{
+    const HI_PHASH_NODE *node =
+        ph->table + ((h + ph->disp[hi_phash_bucket(ph, h)]) & ph->slot_mask);
+
+    if ( node->len == len && hi_phash_equal(node->key, p, len) )
+        return node->data;
+
+    return NULL;
+}
+
+static uint32_t hi_phash_hash(uint32_t seed, const uint8_t *p, unsigned len)
+{
+    uint32_t h = seed;
+
+    while ( len-- )
+        h = hi_phash_step(h, *p++);
+
+    return h;
+}
+
+/*
+**  Try to place all keys with the given seed and table sizes.  Returns
+**  0 and fills in ph->table and ph->disp on success.
+*/
+static int hi_phash_place(HI_PHASH *ph, uint32_t seed, unsigned slots,
+        unsigned buckets, uint32_t *hash, unsigned *count, unsigned *order,
+        unsigned *slot_of)
+{
+    uint8_t *used;
+    unsigned i, j, b;
+
+    ph->seed = seed;
+    ph->slot_mask = slots - 1;
+    ph->bucket_mask = buckets - 1;
+
+    memset(count, 0, buckets * sizeof(*count));
+
+    for ( i = 0; i < ph->num_keys; i++ )
+    {
+        hash[i] = hi_phash_hash(seed, ph->keys[i].key, ph->keys[i].len);
+        count[hi_phash_bucket(ph, hash[i])]++;
+    }
+
+    /* biggest buckets first; there are only a few so insertion sort */
+    for ( i = 0; i < buckets; i++ )
+    {
+        for ( j = i; j > 0 && count[order[j-1]] < count[i]; j-- )
+            order[j] = order[j-1];
+        order[j] = i;
+    }
+
+    if ( !(used = calloc(slots, 1)) )
+        return -1;
+
+    memset(ph->disp, 0, buckets * sizeof(*ph->disp));
+
+    for ( b = 0; b < buckets && count[order[b]]; b++ )
+    {
+        unsigned bkt = order[b];
+        unsigned d;
+
+        for ( d = 0; d < slots && d <= 0xFFFF; d++ )
+        {
+            unsigned placed = 0;
+
+            for ( i = 0; i < ph->num_keys; i++ )
+            {
+                unsigned s;
+
+                if ( hi_phash_bucket(ph, hash[i]) != bkt )
+                    continue;
+
+                s = (hash[i] + d) & ph->slot_mask;
+
+                if ( used[s] )
+                    break;
+
+                used[s] = 1;
+                slot_of[i] = s;
+                placed++;
+            }
+            if ( placed == count[bkt] )
+                break;
+
+            /* undo the partial placement */
+            for ( j = 0; j < i; j++ )
+            {
+                if ( hi_phash_bucket(ph, hash[j]) == bkt )
+                    used[slot_of[j]] = 0;
+            }
+        }
+        if ( d == slots || d > 0xFFFF )
+        {
+            free(used);
+            return -1;
+        }
+        ph->disp[bkt] = (uint16_t)d;
+    }
+    free(used);
+
+    memset(ph->table, 0, slots * sizeof(*ph->table));
+
+    for ( i = 0; i < ph->num_keys; i++ )
+        ph->table[slot_of[i]] = ph->keys[i];
+
+    return 0;
+}
+
+static int hi_phash_build(HI_PHASH *ph)
+{
+    unsigned n = ph->num_keys;
+    unsigned slots = 1, buckets = 1;
+    uint32_t *hash = NULL;
+    unsigned *count = NULL, *order = NULL, *slot_of = NULL;
+    int grow, ret = -1;
+
+    if ( !n )
+    {
+        free(ph->table);
+        free(ph->disp);
+        ph->table = NULL;
+        ph->disp = NULL;
+        return 0;
+    }
+
+    while ( slots < n )
+        slots <<= 1;
+
+    while ( buckets < (n + 1) / 2 )
+        buckets <<= 1;
+
+    hash = calloc(n, sizeof(*hash));
+    slot_of = calloc(n, sizeof(*slot_of));
+    count = calloc(buckets, sizeof(*count));
+    order = calloc(buckets, sizeof(*order));
+
+    if ( !hash || !slot_of || !count || !order )
+        goto done;
+
+    for ( grow = 0; grow <= HI_PHASH_GROW && ret; grow++, slots <<= 1 )
+    {
+        uint32_t seed;
+
+        free(ph->table);
+        free(ph->disp);
+
+        ph->table = calloc(slots, sizeof(*ph->table));
+        ph->disp = calloc(buckets, sizeof(*ph->disp));
+
+        if ( !ph->table || !ph->disp )
+            goto done;
+
+        for ( seed = 0; seed < HI_PHASH_SEEDS && ret; seed++ )
+        {
+            ret = hi_phash_place(ph, 2166136261u + seed * 0x01000193u, slots,
+                buckets, hash, count, order, slot_of);
+        }
+    }
+
+done:
+    free(hash);
+    free(slot_of);
+    free(count);
+    free(order);
+    return ret;
+}
+
+HI_PHASH *hi_phash_new(void)
+{
+    return (HI_PHASH *)calloc(1, sizeof(HI_PHASH));
+}
+
+void hi_phash_free(HI_PHASH *ph)
+{
+    unsigned i;
+
+    if ( !ph )
+        return;
+
+    for ( i = 0; i < ph->num_keys; i++ )
+        free(ph->keys[i].key);
+
+    free(ph->keys);
+    free(ph->table);
+    free(ph->disp);
+    free(ph);
+}
+
+int hi_phash_add(HI_PHASH *ph, const char *key, unsigned len, void *data)
+{
+    HI_PHASH_NODE *node;
+    unsigned i;
+
+    if ( !ph || !key || !len )
+        return -1;
+
+    if ( ph->num_keys && hi_phash_find(ph, (const u_char *)key, len) )
+        return 1;
+
+    if ( ph->num_keys == ph->max_keys )
+    {
+        unsigned max = ph->max_keys ? 2 * ph->max_keys : 8;
+        HI_PHASH_NODE *keys = realloc(ph->keys, max * sizeof(*keys));
+
+        if ( !keys )
+            return -1;
+
+        ph->keys = keys;
+        ph->max_keys = max;
+    }
+    node = ph->keys + ph->num_keys;
+    node->key = calloc((len + HI_PHASH_CHUNK - 1) / HI_PHASH_CHUNK, HI_PHASH_CHUNK);
+
+    if ( !node->key )
+        return -1;
+
+    for ( i = 0; i < len; i++ )
+        node->key[i] = hi_phash_fold((uint8_t)key[i]);
+
+    node->len = len;
+    node->data = data;
+    ph->num_keys++;
+
+    if ( hi_phash_build(ph) )
+    {
+        free(node->key);
+        ph->num_keys--;
+        hi_phash_build(ph);
+        return -1;
+    }
+    if ( len < 32 )
+        ph->lens |= (1u << len);
+
+    if ( len > ph->max_len )
+        ph->max_len = len;
+
+    return 0;
+}
+
+void *hi_phash_find(const HI_PHASH *ph, const u_char *key, unsigned len)
+{
+    if ( !ph || !ph->num_keys || len > ph->max_len || !len )
+        return NULL;
+
+    return hi_phash_probe(ph, hi_phash_hash(ph->seed, key, len), key, len);
+}
+
+void *hi_phash_find_prefix(const HI_PHASH *ph, const u_char *p, const u_char *end)
+{
+    uint32_t h;
+    unsigned i, n;
+
+    if ( !ph || !ph->num_keys || p >= end )
+        return NULL;
+
+    n = end - p;
+
+    if ( n > ph->max_len )
+        n = ph->max_len;
+
+    if ( n > 31 )
+        n = 31;
+
+    h = ph->seed;
+
+    for ( i = 0; i < n; i++ )
+    {
+        h = hi_phash_step(h, p[i]);
+
+        if ( ph->lens & (1u << (i + 1)) )
+        {
+            void *data = hi_phash_probe(ph, h, p, i + 1);
+
+            if ( data )
+                return data;
+        }
+    }
+    return NULL;
+}
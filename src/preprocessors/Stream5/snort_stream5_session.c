@@ -57,6 +57,7 @@
 #endif
 
 #include "snort.h"
+#include "flow_bypass.h"
 
 #if 0
 // if you want to use this, print ip_l,h for proper ip4,6 support
@@ -530,6 +531,14 @@ int DeleteLWSession(Stream5SessionCache *sessionCache,
     sfip_set_ip(&client_ip, &ssn->client_ip);
     sfip_set_ip(&server_ip, &ssn->server_ip);
 
+    /* don't let the fast path keep passing a flow we no longer track */
+    if (FlowBypass_IsEnabled())
+    {
+        FlowBypass_Remove(&ssn->client_ip, client_port,
+            &ssn->server_ip, server_port, ssn->protocol,
+            ssn->key ? ssn->key->vlan_tag : 0);
+    }
+
     /*
      * Call callback to cleanup the protocol (TCP/UDP/ICMP)
      * specific session details
@@ -796,12 +805,36 @@ int PruneLWSessionCache(Stream5SessionCache *sessionCache,
     return pruned;
 }
 
+static void InitLWSession(Stream5LWSession *ssn, SFXHASH_NODE *hnode,
+                          SessionKey *key, void *policy,
+                          tSfPolicyId policy_id, long last_data_seen)
+{
+    StreamFlowData *flowdata;
+
+    /* Zero everything out */
+    memset(ssn, 0, sizeof(Stream5LWSession));
+
+    /* Save the session key for future use */
+    ssn->key = hnode->key;
+
+    ssn->protocol = key->protocol;
+    ssn->last_data_seen = last_data_seen;
+    ssn->flowdata = mempool_alloc(&s5FlowMempool);
+    flowdata = ssn->flowdata->data;
+    boInitStaticBITOP(&(flowdata->boFlowbits), getFlowbitSizeInBytes(),
+                      flowdata->flowb);
+
+    ssn->policy = policy;
+    ssn->config = s5_config;
+    ssn->policy_id = policy_id;
+    ((Stream5Config *)sfPolicyUserDataGet(ssn->config, ssn->policy_id))->ref_count++;
+}
+
 Stream5LWSession *NewLWSession(Stream5SessionCache *sessionCache, Packet *p,
                                SessionKey *key, void *policy)
 {
     Stream5LWSession *retSsn = NULL;
     SFXHASH_NODE *hnode;
-    StreamFlowData *flowdata;
 
     hnode = sfxhash_get_node(sessionCache->hashTable, key);
     if (!hnode)
@@ -826,24 +859,32 @@ Stream5LWSession *NewLWSession(Stream5SessionCache *sessionCache, Packet *p,
     if (hnode && hnode->data)
     {
         retSsn = hnode->data;
+        InitLWSession(retSsn, hnode, key, policy, getRuntimePolicy(),
+            p->pkth->ts.tv_sec);
+    }
+
+    return retSsn;
+}
 
-        /* Zero everything out */
-        memset(retSsn, 0, sizeof(Stream5LWSession));
+/* Recreate a session from a saved key (warm restart).  Unlike
+ * NewLWSession this never prunes; NULL is returned if the cache
+ * is full or the session already exists. */
+Stream5LWSession *RestoreLWSession(Stream5SessionCache *sessionCache,
+                                   SessionKey *key, void *policy,
+                                   tSfPolicyId policy_id, long last_data_seen)
+{
+    Stream5LWSession *retSsn = NULL;
+    SFXHASH_NODE *hnode;
 
-        /* Save the session key for future use */
-        retSsn->key = hnode->key;
+    if (sfxhash_find(sessionCache->hashTable, key))
+        return NULL;
 
-        retSsn->protocol = key->protocol;
-        retSsn->last_data_seen = p->pkth->ts.tv_sec;
-        retSsn->flowdata = mempool_alloc(&s5FlowMempool);
-        flowdata = retSsn->flowdata->data;
-        boInitStaticBITOP(&(flowdata->boFlowbits), getFlowbitSizeInBytes(),
-                          flowdata->flowb);
+    hnode = sfxhash_get_node(sessionCache->hashTable, key);
 
-        retSsn->policy = policy;
-        retSsn->config = s5_config;
-        retSsn->policy_id = getRuntimePolicy();
-        ((Stream5Config *)sfPolicyUserDataGet(retSsn->config, retSsn->policy_id))->ref_count++;
+    if (hnode && hnode->data)
+    {
+        retSsn = hnode->data;
+        InitLWSession(retSsn, hnode, key, policy, policy_id, last_data_seen);
     }
 
     return retSsn;
@@ -59,6 +59,7 @@ Stream5SessionCache *InitLWSessionCache(int max_sessions,
                                         uint32_t cleanup_percent,
                                         Stream5SessionCleanup clean_fcn);
 Stream5LWSession *GetLWSession(Stream5SessionCache *, Packet *, SessionKey *);
+int GetLWSessionKey(Packet *, SessionKey *);
 int GetLWSessionKeyFromIpPort(
                     snort_ip_p srcIP,
                     uint16_t srcPort,
@@ -71,6 +72,8 @@ int GetLWSessionKeyFromIpPort(
                     SessionKey *key);
 Stream5LWSession *GetLWSessionFromKey(Stream5SessionCache *, SessionKey *);
 Stream5LWSession *NewLWSession(Stream5SessionCache *, Packet *, SessionKey *, void *);
+Stream5LWSession *RestoreLWSession(Stream5SessionCache *, SessionKey *, void *,
+                                   tSfPolicyId, long last_data_seen);
 int DeleteLWSession(Stream5SessionCache *, Stream5LWSession *, char *reason);
 void PrintLWSessionCache(Stream5SessionCache *);
 int DeleteLWSessionCache(Stream5SessionCache *sessionCache);
@@ -78,6 +78,10 @@
 #include "stream5_paf.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef TARGET_BASED
 #include "sftarget_protocol_reference.h"
@@ -93,6 +97,7 @@
 #include "sfPolicy.h"
 #include "sfActionQueue.h"
 #include "detection_util.h"
+#include "idle_processing_funcs.h"
 
 #ifdef PERF_PROFILING
 PreprocStats s5TcpPerfStats;
@@ -374,6 +379,7 @@ typedef struct _StreamTracker
     uint32_t overlap_count;      /* overlaps encountered */
     uint32_t small_seg_count;
     uint32_t flush_count;        /* number of flushed queued segments */
+    uint32_t skip_seq;           /* purge without flushing up to here */
 
     uint16_t os_policy;
     uint16_t reassembly_policy;
@@ -385,6 +391,7 @@ typedef struct _StreamTracker
     uint8_t  flags;        /* bitmap flags (TF_xxx) */
 
     uint8_t  alert_count;  /* number alerts stored (up to MAX_SESSION_ALERTS) */
+    uint8_t  skip;         /* skip_seq is pending */
 
 } StreamTracker;
 
@@ -501,6 +508,7 @@ static inline int CheckFlushPolicyOnAck(
 static void Stream5SeglistAddNode(StreamTracker *, StreamSegment *,
                 StreamSegment *);
 static int Stream5SeglistDeleteNode(StreamTracker *, StreamSegment *, uint32_t flush_seq);
+static void Stream5PressureIdle(void);
 static int AddStreamNode(StreamTracker *st, Packet *p,
                   TcpDataBlock*,
                   TcpSession *tcpssn,
@@ -862,6 +870,7 @@ bool Stream5ActivatePafTcp (Stream5LWSession* lwssn, bool to_server)
         return false;
     }
     s5_paf_setup(s5_tcp_eval_config->paf_config, &trk->paf_state, lwssn->server_port, (bool)!to_server);
+    trk->skip = 0;
     return true;
 }
 
@@ -958,6 +967,9 @@ void Stream5InitTcp(Stream5GlobalConfig *gconfig)
                     __FILE__, __LINE__);
         }
 
+        /* no-op unless memcap_policy graded is configured */
+        IdleProcessingRegisterHandler(Stream5PressureIdle);
+
         Stream5TcpRegisterPreprocProfiles();
     }
 }
@@ -2687,6 +2699,9 @@ static inline void NormalStripTimeStamp (Packet* p, int i)
 {
     uint8_t* opt;
 
+    // the decoded option is modified below so it must exist
+    GetTcpOptions(p);
+
     if ( i < 0 )
     {
         for ( i = 0; i < p->tcp_option_count; i++ )
@@ -3641,7 +3656,7 @@ static inline int _flush_to_seq_4(
 
         /* Reset alert tracking after flushing rebuilt packet */
 
-    } while (!(st->flags & TF_MISSING_PKT) && DataToFlush(st));
+    } while (!(st->flags & TF_MISSING_PKT) && !st->skip && DataToFlush(st));
 
     if ( st->tcp_policy )
         UpdateFlushMgr(&st->flush_mgr, &st->tcp_policy->flush_point_list);
@@ -3844,7 +3859,7 @@ static inline int _flush_to_seq_6(
 
         /* Reset alert tracking after flushing rebuilt packet */
 
-    } while (!(st->flags & TF_MISSING_PKT) && DataToFlush(st));
+    } while (!(st->flags & TF_MISSING_PKT) && !st->skip && DataToFlush(st));
 
     if ( st->tcp_policy )
         UpdateFlushMgr(&st->flush_mgr, &st->tcp_policy->flush_point_list);
@@ -3964,6 +3979,31 @@ static inline int flush_ackd(
     return flush_to_seq(tcpssn, st, bytes, p, sip, dip, sp, dp, dir);
 }
 
+// purge a pending skip without rebuilding; only acked data is
+// released so the rest is taken on subsequent acks.  returns
+// true when the skip is complete and flushing can resume.
+static inline bool skip_pdu_ackd (TcpSession* ssn, StreamTracker* trk)
+{
+    uint32_t to = trk->skip_seq;
+    bool done = true;
+
+    if ( SEQ_LT(trk->r_win_base, to) )
+    {
+        to = trk->r_win_base;
+        done = false;
+    }
+    if ( SEQ_GT(to, trk->seglist_base_seq) )
+    {
+        s5stats.tcp_skip_bytes += to - trk->seglist_base_seq;
+        purge_to_seq(ssn, trk, to);
+        s5_paf_jump(&trk->paf_state, to);
+    }
+    if ( done )
+        trk->skip = 0;
+
+    return done;
+}
+
 // FIXTHIS flush_stream() calls should be replaced with calls to
 // CheckFlushPolicyOn*() with the exception that for the *OnAck() case,
 // any available ackd data must be flushed in both directions.
@@ -3978,6 +4018,9 @@ static inline int flush_stream(
         return flush_to_seq(tcpssn, st, bytes, p, sip, dip, sp, dp, dir);
     }
 #endif
+    if ( st->skip )
+        skip_pdu_ackd(tcpssn, st);
+
     return flush_ackd(tcpssn, st, p, sip, dip, sp, dp, dir);
 }
 
@@ -5082,30 +5125,28 @@ midstream_pickup_allowed:
 
 static uint32_t Stream5GetTcpTimestamp(Packet *p, uint32_t *ts, int strip)
 {
-    unsigned int i = 0;
+    const uint8_t *data;
 
     STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
                     "Getting timestamp...\n"););
-    while(i < p->tcp_option_count && i < TCP_OPTLENMAX)
+    data = GetTcpOptionData(p, TCPOPT_TIMESTAMP);
+
+    if(data)
     {
-        if(p->tcp_options[i].code == TCPOPT_TIMESTAMP)
-        {
 #ifdef NORMALIZER
-            if ( strip && Normalize_IsEnabled(snort_conf, NORM_TCP_OPT) )
-            {
-                NormalStripTimeStamp(p, i);
-            }
-            else
+        if ( strip && Normalize_IsEnabled(snort_conf, NORM_TCP_OPT) )
+        {
+            NormalStripTimeStamp(p, -1);
+        }
+        else
 #endif
-            {
-                *ts = EXTRACT_32BITS(p->tcp_options[i].data);
-                STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
-                                "Found timestamp %lu\n", *ts););
+        {
+            *ts = EXTRACT_32BITS(data);
+            STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
+                            "Found timestamp %lu\n", *ts););
 
-                return TF_TSTAMP;
-            }
+            return TF_TSTAMP;
         }
-        i++;
     }
     *ts = 0;
 
@@ -5117,21 +5158,18 @@ static uint32_t Stream5GetTcpTimestamp(Packet *p, uint32_t *ts, int strip)
 
 static uint32_t Stream5GetMss(Packet *p, uint16_t *value)
 {
-    unsigned int i = 0;
+    const uint8_t *data;
 
     STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
                     "Getting MSS...\n"););
-    while(i < p->tcp_option_count && i < TCP_OPTLENMAX)
-    {
-        if(p->tcp_options[i].code == TCPOPT_MAXSEG)
-        {
-            *value = EXTRACT_16BITS(p->tcp_options[i].data);
-            STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
-                            "Found MSS %u\n", *value););
-            return TF_MSS;
-        }
+    data = GetTcpOptionData(p, TCPOPT_MAXSEG);
 
-        i++;
+    if(data)
+    {
+        *value = EXTRACT_16BITS(data);
+        STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
+                        "Found MSS %u\n", *value););
+        return TF_MSS;
     }
 
     *value = 0;
@@ -5143,33 +5181,30 @@ static uint32_t Stream5GetMss(Packet *p, uint16_t *value)
 
 static uint32_t Stream5GetWscale(Packet *p, uint16_t *value)
 {
-    unsigned int i = 0;
+    const uint8_t *data;
 
     STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
                     "Getting wscale...\n"););
-    while(i < p->tcp_option_count && i < TCP_OPTLENMAX)
-    {
-        if(p->tcp_options[i].code == TCPOPT_WSCALE)
-        {
-            *value = (uint16_t) p->tcp_options[i].data[0];
-            STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
-                            "Found wscale %d\n", *value););
+    data = GetTcpOptionData(p, TCPOPT_WSCALE);
 
-            /* If scale specified in option is larger than 14,
-             * use 14 because of limitation in the math of
-             * shifting a 32bit value (max scaled window is 2^30th).
-             *
-             * See RFC 1323 for details.
-             */
-            if (*value > 14)
-            {
-                *value = 14;
-            }
+    if(data)
+    {
+        *value = (uint16_t) data[0];
+        STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
+                        "Found wscale %d\n", *value););
 
-            return TF_WSCALE;
+        /* If scale specified in option is larger than 14,
+         * use 14 because of limitation in the math of
+         * shifting a 32bit value (max scaled window is 2^30th).
+         *
+         * See RFC 1323 for details.
+         */
+        if (*value > 14)
+        {
+            *value = 14;
         }
 
-        i++;
+        return TF_WSCALE;
     }
 
     *value = 0;
@@ -5386,7 +5421,12 @@ static void NewQueue(StreamTracker *st, Packet *p, TcpDataBlock *tdb, TcpSession
             }
         }
 
-        AddStreamNode(st, p, tdb, tcpssn, p->dsize, overlap, 0, tdb->seq+overlap, NULL, &ss);
+        if ( AddStreamNode(st, p, tdb, tcpssn, p->dsize, overlap, 0,
+                tdb->seq+overlap, NULL, &ss) != STREAM_INSERT_OK )
+        {
+            PREPROC_PROFILE_END(s5TcpInsertPerfStats);
+            return;
+        }
 
         STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
                     "Attached new queue to seglist, %d bytes queued, "
@@ -5472,6 +5512,347 @@ static inline int SegmentFastTrack(StreamSegment *tail, TcpDataBlock *tdb)
     return 0;
 }
 
+/*
+ * Graded memcap pressure handling (memcap_policy graded).
+ *
+ * Rather than evicting whole sessions in LRU order as soon as the
+ * memcap is hit, memory is reclaimed in increasing order of cost:
+ *
+ *   elevated - release acked segments that were already flushed to
+ *              detection but are still queued
+ *   high     - also hold each flow to a byte budget by force flushing
+ *              and purging its acked data
+ *   critical - also release flushed segments that are not yet acked,
+ *              then evict sessions, those with nothing pending first,
+ *              then those without active PAF, then plain LRU
+ */
+#define S5_PRESSURE_WINDOW   64   /* sessions examined per reclaim pass */
+#define S5_PRESSURE_IDLE_WINDOW  512
+
+static inline int Stream5PressureLevel(void)
+{
+    const Stream5GlobalConfig *gc = s5_global_eval_config;
+    uint64_t used;
+
+    if ( !gc || !(gc->flags & STREAM5_CONFIG_MEMCAP_GRADED) )
+        return S5_PRESSURE_NONE;
+
+    used = (uint64_t)mem_in_use * 100;
+
+    if ( mem_in_use > gc->memcap )
+        return S5_PRESSURE_CRITICAL;
+
+    if ( used >= (uint64_t)gc->memcap * gc->pressure_high )
+        return S5_PRESSURE_HIGH;
+
+    if ( used >= (uint64_t)gc->memcap * gc->pressure_elevated )
+        return S5_PRESSURE_ELEVATED;
+
+    return S5_PRESSURE_NONE;
+}
+
+static inline void Stream5UpdatePressure(int level)
+{
+    sfBase.stream5_pressure_level = level;
+    sfBase.stream5_mem_in_use = mem_in_use;
+}
+
+static inline uint32_t Stream5FlowBudget(void)
+{
+    const Stream5GlobalConfig *gc = s5_global_eval_config;
+
+    if ( gc->flow_budget )
+        return gc->flow_budget;
+
+    return gc->memcap / S5_DEFAULT_FLOW_BUDGET_DIV;
+}
+
+static inline void Stream5CountReclaim(int tier, uint32_t before)
+{
+    uint32_t bytes;
+
+    if ( mem_in_use >= before )
+        return;
+
+    bytes = before - mem_in_use;
+
+    switch ( tier )
+    {
+    case PERF_RECLAIM_FLUSHED:
+        s5stats.tcp_reclaim_flushed += bytes;
+        break;
+    case PERF_RECLAIM_BUDGET:
+        s5stats.tcp_reclaim_budget += bytes;
+        break;
+    default:
+        s5stats.tcp_reclaim_evict += bytes;
+        break;
+    }
+    sfBase.stream5_reclaimed[tier] += bytes;
+}
+
+/*
+ * purge segments that were already flushed.  unacked data is still in
+ * flight and needed for retransmission and overlap checks so it is only
+ * released when unackd is set, which is reserved for the critical level.
+ */
+static inline int purge_flushed (
+    TcpSession *tcpssn, StreamTracker *st, bool unackd)
+{
+    StreamSegment* seg = st->seglist;
+    uint32_t seq = 0;
+
+    while ( seg && seg->buffered )
+    {
+        uint32_t end = seg->seq + seg->size;
+
+        if ( !unackd && !SEQ_LEQ(end, st->r_win_base) )
+            break;
+
+        seq = end;
+        seg = seg->next;
+    }
+    if ( seq )
+        return purge_to_seq(tcpssn, st, seq);
+
+    return 0;
+}
+
+static inline TcpSession* Stream5PressureSession (SFXHASH_NODE* hnode)
+{
+    Stream5LWSession* lwssn = (Stream5LWSession*)hnode->data;
+
+    if ( !lwssn || !lwssn->proto_specific_data )
+        return NULL;
+
+    return (TcpSession*)lwssn->proto_specific_data->data;
+}
+
+/*
+ * tier 1 resumes where the previous pass stopped so successive passes
+ * cover the whole cache instead of the same few oldest sessions.  the
+ * key is kept rather than the node since sessions may be deleted in
+ * between; the lookup must not splay or it would reorder the lru list.
+ */
+static SessionKey s5_reclaim_key;
+static bool s5_reclaim_resume = false;
+
+static inline SFXHASH_NODE* Stream5ReclaimStart (SFXHASH* t)
+{
+    SFXHASH_NODE* hnode = NULL;
+
+    if ( s5_reclaim_resume )
+    {
+        sfxhash_splaymode(t, 0);
+        hnode = sfxhash_find_node(t, &s5_reclaim_key);
+        sfxhash_splaymode(t, 1);
+    }
+    if ( !hnode )
+        hnode = sfxhash_lru_node(t);
+
+    return hnode;
+}
+
+static inline void Stream5ReclaimStop (SFXHASH_NODE* hnode)
+{
+    if ( hnode )
+    {
+        memcpy(&s5_reclaim_key, hnode->key, sizeof(s5_reclaim_key));
+        s5_reclaim_resume = true;
+    }
+    else
+        s5_reclaim_resume = false;
+}
+
+/*
+ * tier 1: walk the oldest sessions releasing flushed segments; save_me
+ * is skipped since its seglist may be in the middle of an insert
+ */
+static void Stream5ReclaimFlushed (
+    unsigned window, bool unackd, Stream5LWSession* save_me)
+{
+    SFXHASH_NODE* hnode;
+    uint32_t before = mem_in_use;
+
+    if ( !tcp_lws_cache )
+        return;
+
+    hnode = Stream5ReclaimStart(tcp_lws_cache->hashTable);
+
+    while ( hnode && window-- )
+    {
+        TcpSession* tcpssn = Stream5PressureSession(hnode);
+
+        if ( tcpssn && (Stream5LWSession*)hnode->data != save_me )
+        {
+            if ( tcpssn->client.flush_count )
+                purge_flushed(tcpssn, &tcpssn->client, unackd);
+
+            if ( tcpssn->server.flush_count )
+                purge_flushed(tcpssn, &tcpssn->server, unackd);
+        }
+        hnode = hnode->gprev;
+    }
+    Stream5ReclaimStop(hnode);
+    Stream5CountReclaim(PERF_RECLAIM_FLUSHED, before);
+}
+
+/* tier 2: hold the receiving tracker of this packet to the flow budget */
+static void Stream5EnforceFlowBudget (
+    TcpSession* tcpssn, StreamTracker* listener, Packet* p)
+{
+    uint32_t budget = Stream5FlowBudget();
+    uint32_t before = mem_in_use;
+
+    if ( listener->seg_bytes_total <= budget )
+        return;
+
+    if ( listener->flush_count )
+        purge_flushed(tcpssn, listener, false);
+
+    if ( (listener->seg_bytes_total > budget) &&
+         (listener->flush_mgr.flush_policy != STREAM_FLPOLICY_IGNORE) )
+    {
+        /* data queued on the listener came from the talker */
+        uint32_t dir = p->packet_flags & (PKT_FROM_CLIENT|PKT_FROM_SERVER);
+
+        listener->flags |= TF_FORCE_FLUSH;
+        flush_ackd(tcpssn, listener, p,
+            GET_SRC_IP(p), GET_DST_IP(p),
+            p->tcph->th_sport, p->tcph->th_dport, dir);
+        listener->flags &= ~TF_FORCE_FLUSH;
+
+        purge_flushed_ackd(tcpssn, listener);
+    }
+    Stream5CountReclaim(PERF_RECLAIM_BUDGET, before);
+}
+
+static inline int Stream5NothingPending (TcpSession* tcpssn)
+{
+    return (tcpssn->client.seg_count == tcpssn->client.flush_count) &&
+           (tcpssn->server.seg_count == tcpssn->server.flush_count);
+}
+
+static inline int Stream5NoPaf (TcpSession* tcpssn)
+{
+    return !s5_paf_active(&tcpssn->client.paf_state) &&
+           !s5_paf_active(&tcpssn->server.paf_state);
+}
+
+/*
+ * tier 3: evict up to cleanup_sessions sessions among the oldest that
+ * satisfy the given test; the walk restarts after each delete since
+ * the cache may change underneath us
+ */
+static unsigned Stream5EvictWhere (
+    int (*test)(TcpSession*), int reason, Stream5LWSession* save_me)
+{
+    unsigned evicted = 0;
+    uint32_t before = mem_in_use;
+
+    while ( (evicted < tcp_lws_cache->cleanup_sessions) &&
+            (mem_in_use > s5_global_eval_config->memcap) &&
+            (sfxhash_count(tcp_lws_cache->hashTable) > 1) )
+    {
+        SFXHASH_NODE* hnode = sfxhash_lru_node(tcp_lws_cache->hashTable);
+        Stream5LWSession* victim = NULL;
+        unsigned window = S5_PRESSURE_WINDOW;
+
+        while ( hnode && window-- )
+        {
+            Stream5LWSession* lwssn = (Stream5LWSession*)hnode->data;
+            TcpSession* tcpssn = Stream5PressureSession(hnode);
+
+            if ( lwssn != save_me && tcpssn &&
+                 !(lwssn->session_flags & (SSNFLAG_DROP_CLIENT|SSNFLAG_DROP_SERVER)) &&
+                 test(tcpssn) )
+            {
+                victim = lwssn;
+                break;
+            }
+            hnode = hnode->gprev;
+        }
+        if ( !victim )
+            break;
+
+        victim->session_flags |= SSNFLAG_PRUNED;
+        DeleteLWSession(tcp_lws_cache, victim, "memcap/graded");
+        tcp_lws_cache->prunes++;
+        evicted++;
+    }
+    if ( evicted )
+    {
+        sfBase.stream5_evictions[reason] += evicted;
+
+        if ( reason == PERF_EVICT_NO_PENDING )
+            s5stats.tcp_evict_no_pending += evicted;
+        else
+            s5stats.tcp_evict_no_paf += evicted;
+    }
+    Stream5CountReclaim(PERF_RECLAIM_EVICT, before);
+    return evicted;
+}
+
+static void Stream5ReclaimCritical (Packet* p)
+{
+    Stream5LWSession* save_me = (Stream5LWSession*)p->ssnptr;
+    uint32_t before;
+
+    Stream5ReclaimFlushed(S5_PRESSURE_WINDOW, true, save_me);
+
+    if ( mem_in_use <= s5_global_eval_config->memcap )
+        return;
+
+    Stream5EvictWhere(Stream5NothingPending, PERF_EVICT_NO_PENDING, save_me);
+
+    if ( mem_in_use <= s5_global_eval_config->memcap )
+        return;
+
+    Stream5EvictWhere(Stream5NoPaf, PERF_EVICT_NO_PAF, save_me);
+
+    if ( mem_in_use <= s5_global_eval_config->memcap )
+        return;
+
+    before = mem_in_use;
+    {
+        int pruned = PruneLWSessionCache(tcp_lws_cache, 0, save_me, 1);
+
+        if ( pruned > 0 )
+        {
+            s5stats.tcp_evict_lru += pruned;
+            sfBase.stream5_evictions[PERF_EVICT_LRU] += pruned;
+        }
+    }
+    Stream5CountReclaim(PERF_RECLAIM_EVICT, before);
+}
+
+/* called at the end of each tcp packet */
+static inline void Stream5CheckPressure (
+    TcpSession* tcpssn, StreamTracker* listener, Packet* p)
+{
+    int level = Stream5PressureLevel();
+
+    if ( level == S5_PRESSURE_NONE )
+        return;
+
+    Stream5ReclaimFlushed(S5_PRESSURE_WINDOW / 8, false, NULL);
+
+    if ( level >= S5_PRESSURE_HIGH && listener->seg_bytes_total )
+        Stream5EnforceFlowBudget(tcpssn, listener, p);
+
+    Stream5UpdatePressure(Stream5PressureLevel());
+}
+
+/* bigger tier 1 sweep when the packet source is idle */
+static void Stream5PressureIdle (void)
+{
+    if ( Stream5PressureLevel() == S5_PRESSURE_NONE )
+        return;
+
+    Stream5ReclaimFlushed(S5_PRESSURE_IDLE_WINDOW, false, NULL);
+    Stream5UpdatePressure(Stream5PressureLevel());
+}
+
 static void *SegmentAlloc(uint32_t size, Packet *p, bool pruneOk)
 {
     void *tmp;
@@ -5492,6 +5873,18 @@ static void *SegmentAlloc(uint32_t size, Packet *p, bool pruneOk)
         if (!PruneLWSessionCache(tcp_lws_cache, p->pkth->ts.tv_sec,
                     (Stream5LWSession*)p->ssnptr, 0))
         {
+            if ( s5_global_eval_config->flags & STREAM5_CONFIG_MEMCAP_GRADED )
+            {
+                Stream5ReclaimCritical(p);
+                Stream5UpdatePressure(Stream5PressureLevel());
+
+                if ( mem_in_use > s5_global_eval_config->memcap )
+                {
+                    mem_in_use -= size;
+                    return NULL;
+                }
+                return SnortAlloc(size);
+            }
             /* Try the memcap - last parameter (1) specifies check
              * based on memory cap. */
             PruneLWSessionCache(tcp_lws_cache, 0,
@@ -5565,8 +5958,20 @@ static int AddStreamNode(StreamTracker *st, Packet *p,
 #endif
 
     ss = (StreamSegment *) SegmentAlloc(sizeof(StreamSegment), p, true);
+
+    /* graded memcap fails the allocation if reclaiming didn't help */
+    if ( !ss )
+        return STREAM_INSERT_FAILED;
+
     ss->pktOrig = ss->pkt = (uint8_t *) SegmentAlloc(p->pkth->caplen + SPARC_TWIDDLE, p, true);
 
+    if ( !ss->pkt )
+    {
+        mem_in_use -= sizeof(StreamSegment);
+        free(ss);
+        return STREAM_INSERT_FAILED;
+    }
+
     ss->caplen = p->pkth->caplen + SPARC_TWIDDLE;
     ss->pkt += SPARC_TWIDDLE;
 
@@ -6796,32 +7201,137 @@ static inline void CopyMacAddr(Packet *p,
     }
 }
 
-static int NewTcpSession(Packet *p,
-                         Stream5LWSession *lwssn,
-                         TcpDataBlock *tdb,
-                         Stream5TcpPolicy *dstPolicy)
+/* Set up the flush managers of a new session from the configured
+ * flush policy (or PAF) for the server port. */
+static void InitTcpSessionFlushMgrs(TcpSession *tmp, uint16_t server_port)
 {
-    MemBucket *tmpBucket = NULL;
-    TcpSession *tmp = NULL;
-    uint16_t server_port = 0;
-    PROFILE_VARS;
-
-    PREPROC_PROFILE_START(s5TcpNewSessPerfStats);
+#ifdef TARGET_BASED
+    Stream5LWSession *lwssn = tmp->lwssn;
+#endif
 
-    if (TCP_ISFLAGSET(p->tcph, TH_SYN) &&
-        !TCP_ISFLAGSET(p->tcph, TH_ACK))
+    /* Set up the flush behaviour, based on the configured info
+     * for the server and client ports.
+     */
+    /* Yes, the server flush manager gets the info from the
+     * policy's server port's the flush policy from the client
+     * and visa-versa.
+     *
+     * For example, when policy said 'ports client 80', that means
+     * reassemble packets from the client side (stored in the server's
+     * flush buffer in the session) destined for port 80.  Port 80 is
+     * the server port and we're reassembling the client side.
+     * That should make this almost as clear as opaque mud!
+     */
+#ifdef TARGET_BASED
+    if (tmp->server.tcp_policy->flush_config_protocol[lwssn->application_protocol].configured == 1)
     {
-        /******************************************************************
-         * start new sessions on proper SYN packets
-         *****************************************************************/
-        tmpBucket = mempool_alloc(&tcp_session_mempool);
-        tmp = tmpBucket->data;
-        STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
-                    "Creating new session tracker on SYN!\n"););
+        uint8_t flush_policy =
+            tmp->server.tcp_policy->flush_config_protocol[lwssn->application_protocol].client.flush_policy;
+        uint8_t auto_disable = 0;
 
-#ifdef DEBUG
-        tmp->ssn_time.tv_sec = p->pkth->ts.tv_sec;
-        tmp->ssn_time.tv_usec = p->pkth->ts.tv_usec;
+#ifdef ENABLE_PAF
+        bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
+
+        if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, TRUE, flush) )
+        {
+            flush_policy = STREAM_FLPOLICY_PROTOCOL;
+            s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->server.paf_state, server_port, TRUE);
+            auto_disable = !flush;
+        }
+#endif
+        InitFlushMgr(&tmp->server.flush_mgr,
+            &tmp->server.tcp_policy->flush_point_list, flush_policy, auto_disable);
+    }
+    else
+#endif
+    {
+        uint8_t flush_policy =
+             tmp->server.tcp_policy->flush_config[server_port].client.flush_policy;
+        uint8_t auto_disable = 0;
+
+#ifdef ENABLE_PAF
+        bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
+
+        if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, TRUE, flush) )
+        {
+            flush_policy = STREAM_FLPOLICY_PROTOCOL;
+            s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->server.paf_state, server_port, TRUE);
+            auto_disable = !flush;
+        }
+#endif
+        InitFlushMgr(&tmp->server.flush_mgr,
+            &tmp->server.tcp_policy->flush_point_list, flush_policy, auto_disable);
+    }
+
+#ifdef TARGET_BASED
+    if (tmp->client.tcp_policy->flush_config_protocol[lwssn->application_protocol].configured == 1)
+    {
+        uint8_t flush_policy =
+            tmp->client.tcp_policy->flush_config_protocol[lwssn->application_protocol].server.flush_policy;
+        uint8_t auto_disable = 0;
+
+#ifdef ENABLE_PAF
+        bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
+
+        if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, FALSE, flush) )
+        {
+            flush_policy = STREAM_FLPOLICY_PROTOCOL;
+            s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->client.paf_state, server_port, FALSE);
+            auto_disable = !flush;
+        }
+#endif
+        InitFlushMgr(&tmp->client.flush_mgr,
+            &tmp->client.tcp_policy->flush_point_list, flush_policy, auto_disable);
+    }
+    else
+#endif
+    {
+        uint8_t flush_policy =
+            tmp->client.tcp_policy->flush_config[server_port].server.flush_policy;
+        uint8_t auto_disable = 0;
+
+#ifdef ENABLE_PAF
+        bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
+
+        if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, FALSE, flush) )
+        {
+            flush_policy = STREAM_FLPOLICY_PROTOCOL;
+            s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->client.paf_state, server_port, FALSE);
+            auto_disable = !flush;
+        }
+#endif
+        InitFlushMgr(&tmp->client.flush_mgr,
+            &tmp->client.tcp_policy->flush_point_list, flush_policy, auto_disable);
+    }
+
+}
+
+static int NewTcpSession(Packet *p,
+                         Stream5LWSession *lwssn,
+                         TcpDataBlock *tdb,
+                         Stream5TcpPolicy *dstPolicy)
+{
+    MemBucket *tmpBucket = NULL;
+    TcpSession *tmp = NULL;
+    uint16_t server_port = 0;
+    PROFILE_VARS;
+
+    PREPROC_PROFILE_START(s5TcpNewSessPerfStats);
+
+    if (TCP_ISFLAGSET(p->tcph, TH_SYN) &&
+        !TCP_ISFLAGSET(p->tcph, TH_ACK))
+    {
+        /******************************************************************
+         * start new sessions on proper SYN packets
+         *****************************************************************/
+        tmpBucket = mempool_alloc(&tcp_session_mempool);
+        tmp = tmpBucket->data;
+        STREAM5_DEBUG_WRAP(DebugMessage(DEBUG_STREAM_STATE,
+                    "Creating new session tracker on SYN!\n"););
+
+#ifdef DEBUG
+        tmp->ssn_time.tv_sec = p->pkth->ts.tv_sec;
+        tmp->ssn_time.tv_usec = p->pkth->ts.tv_usec;
 #endif
         lwssn->session_flags |= SSNFLAG_SEEN_CLIENT;
 
@@ -7106,101 +7616,7 @@ static int NewTcpSession(Packet *p,
             lwssn->session_flags &= ~SSNFLAG_RESET;
 
         SetOSPolicy(tmp);
-        /* Set up the flush behaviour, based on the configured info
-         * for the server and client ports.
-         */
-        /* Yes, the server flush manager gets the info from the
-         * policy's server port's the flush policy from the client
-         * and visa-versa.
-         *
-         * For example, when policy said 'ports client 80', that means
-         * reassemble packets from the client side (stored in the server's
-         * flush buffer in the session) destined for port 80.  Port 80 is
-         * the server port and we're reassembling the client side.
-         * That should make this almost as clear as opaque mud!
-         */
-#ifdef TARGET_BASED
-        if (tmp->server.tcp_policy->flush_config_protocol[lwssn->application_protocol].configured == 1)
-        {
-            uint8_t flush_policy =
-                tmp->server.tcp_policy->flush_config_protocol[lwssn->application_protocol].client.flush_policy;
-            uint8_t auto_disable = 0;
-
-#ifdef ENABLE_PAF
-            bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
-
-            if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, TRUE, flush) )
-            {
-                flush_policy = STREAM_FLPOLICY_PROTOCOL;
-                s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->server.paf_state, server_port, TRUE);
-                auto_disable = !flush;
-            }
-#endif
-            InitFlushMgr(&tmp->server.flush_mgr,
-                &tmp->server.tcp_policy->flush_point_list, flush_policy, auto_disable);
-        }
-        else
-#endif
-        {
-            uint8_t flush_policy =
-                 tmp->server.tcp_policy->flush_config[server_port].client.flush_policy;
-            uint8_t auto_disable = 0;
-
-#ifdef ENABLE_PAF
-            bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
-
-            if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, TRUE, flush) )
-            {
-                flush_policy = STREAM_FLPOLICY_PROTOCOL;
-                s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->server.paf_state, server_port, TRUE);
-                auto_disable = !flush;
-            }
-#endif
-            InitFlushMgr(&tmp->server.flush_mgr,
-                &tmp->server.tcp_policy->flush_point_list, flush_policy, auto_disable);
-        }
-
-#ifdef TARGET_BASED
-        if (tmp->client.tcp_policy->flush_config_protocol[lwssn->application_protocol].configured == 1)
-        {
-            uint8_t flush_policy =
-                tmp->client.tcp_policy->flush_config_protocol[lwssn->application_protocol].server.flush_policy;
-            uint8_t auto_disable = 0;
-
-#ifdef ENABLE_PAF
-            bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
-
-            if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, FALSE, flush) )
-            {
-                flush_policy = STREAM_FLPOLICY_PROTOCOL;
-                s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->client.paf_state, server_port, FALSE);
-                auto_disable = !flush;
-            }
-#endif
-            InitFlushMgr(&tmp->client.flush_mgr,
-                &tmp->client.tcp_policy->flush_point_list, flush_policy, auto_disable);
-        }
-        else
-#endif
-        {
-            uint8_t flush_policy =
-                tmp->client.tcp_policy->flush_config[server_port].server.flush_policy;
-            uint8_t auto_disable = 0;
-
-#ifdef ENABLE_PAF
-            bool flush = (flush_policy != STREAM_FLPOLICY_IGNORE);
-
-            if ( s5_paf_enabled(s5_tcp_eval_config->paf_config, server_port, FALSE, flush) )
-            {
-                flush_policy = STREAM_FLPOLICY_PROTOCOL;
-                s5_paf_setup(s5_tcp_eval_config->paf_config, &tmp->client.paf_state, server_port, FALSE);
-                auto_disable = !flush;
-            }
-#endif
-            InitFlushMgr(&tmp->client.flush_mgr,
-                &tmp->client.tcp_policy->flush_point_list, flush_policy, auto_disable);
-        }
-
+        InitTcpSessionFlushMgrs(tmp, server_port);
 
 #ifdef DEBUG_STREAM5
         PrintTcpSession(tmp);
@@ -7226,6 +7642,651 @@ static int NewTcpSession(Packet *p,
     return 0;
 }
 
+/*  S E S S I O N  S N A P S H O T  *********************************/
+/*
+ * The TCP session table can be saved to a file on shutdown and loaded
+ * again on startup so that established sessions survive a restart
+ * instead of going through midstream pickup (or being dropped with
+ * require_3whs).  The file is a header followed by one fixed size
+ * record per session, each followed by the unflushed segments of the
+ * client and then the server tracker.  Every record is padded to 8
+ * bytes so the restore can walk the mapped file in place.
+ *
+ * Only transport state is saved.  Application data, flowbits and PAF
+ * state start over just as they would for a new session.
+ */
+#define S5_SNAP_MAGIC    0x50414e53  /* "SNAP" */
+#define S5_SNAP_VERSION  1
+#define S5_SNAP_ALIGN(n) (((n) + 7) & ~((size_t)7))
+
+typedef struct _S5SnapHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t ssn_size;       /* sizeof(S5SnapSession) */
+    uint16_t seg_size;       /* sizeof(S5SnapSegment) */
+    uint16_t pad;
+    uint32_t sessions;
+} S5SnapHeader;
+
+typedef struct _S5SnapTracker
+{
+    uint32_t l_unackd;
+    uint32_t l_nxt_seq;
+    uint32_t l_window;
+    uint32_t r_nxt_ack;
+    uint32_t r_win_base;
+    uint32_t isn;
+    uint32_t ts_last;
+    uint32_t ts_last_pkt;
+    uint32_t seglist_base_seq;
+    uint32_t transition_seq;
+    uint32_t stq_get_seq;
+    uint32_t seg_count;      /* segment records that follow */
+    uint16_t wscale;
+    uint16_t mss;
+    uint8_t  state;
+    uint8_t  sub_state;
+    uint8_t  state_queue;
+    uint8_t  expected_flags;
+    uint8_t  flags;
+    uint8_t  mac_addr[6];
+    uint8_t  pad;
+} S5SnapTracker;
+
+typedef struct _S5SnapSession
+{
+    SessionKey key;
+    uint32_t client_ip[4];
+    uint32_t server_ip[4];
+    uint64_t expire_time;
+    int64_t  last_data_seen;
+    uint32_t session_flags;
+    uint32_t policy_id;
+    uint16_t session_state;
+    uint16_t client_port;    /* network order, as in Stream5LWSession */
+    uint16_t server_port;
+    int16_t  application_protocol;
+    uint8_t  ipv6;
+    uint8_t  ignore_direction;
+    uint8_t  inner_client_ttl;
+    uint8_t  inner_server_ttl;
+    uint8_t  outer_client_ttl;
+    uint8_t  outer_server_ttl;
+    uint8_t  ecn;
+    uint8_t  pad;
+    S5SnapTracker client;
+    S5SnapTracker server;
+} S5SnapSession;
+
+typedef struct _S5SnapSegment
+{
+    uint32_t tv_sec;
+    uint32_t tv_usec;
+    uint32_t caplen;         /* raw packet bytes that follow */
+    uint32_t pktlen;
+    uint32_t seq;
+    uint32_t ts;
+    uint16_t data;           /* offset of tcp data in packet */
+    uint16_t payload;        /* offset of payload in tcp data */
+    uint16_t size;
+    uint16_t orig_dsize;
+    uint16_t urg_offset;
+    uint16_t pad[3];
+} S5SnapSegment;
+
+static Stream5GlobalConfig* Stream5SnapConfig (void)
+{
+    Stream5Config* config;
+
+    if ( !s5_config || !tcp_lws_cache )
+        return NULL;
+
+    config = (Stream5Config*)sfPolicyUserDataGet(s5_config, getDefaultPolicy());
+
+    if ( !config || !config->global_config ||
+         !config->global_config->snapshot_file )
+        return NULL;
+
+    return config->global_config;
+}
+
+static inline int Stream5SnapEligible (const TcpSession* tcpssn)
+{
+    uint8_t c = tcpssn->client.s_mgr.state;
+    uint8_t s = tcpssn->server.s_mgr.state;
+
+    if ( tcpssn->lwssn->session_flags & SSNFLAG_RESET )
+        return 0;
+
+    if ( tcpssn->lwssn->session_state & STREAM5_STATE_TIMEDOUT )
+        return 0;
+
+    return ( c >= TCP_STATE_ESTABLISHED && c < TCP_STATE_TIME_WAIT &&
+             s >= TCP_STATE_ESTABLISHED && s < TCP_STATE_TIME_WAIT );
+}
+
+/* returns the number of unflushed segments to save for this tracker;
+ * all or none of them are saved, within the remaining byte budget */
+static uint32_t Stream5SnapSegCount (const StreamTracker* st, uint32_t* budget)
+{
+    const StreamSegment* ss;
+    uint32_t n = 0, bytes = 0;
+
+    for ( ss = st->seglist; ss; ss = ss->next )
+    {
+        if ( ss->buffered )
+            continue;
+        n++;
+        bytes += ss->pkth.caplen;
+    }
+    if ( bytes > *budget )
+        return 0;
+
+    *budget -= bytes;
+    return n;
+}
+
+static int Stream5SnapWrite (FILE* f, const void* buf, size_t len)
+{
+    static const uint8_t zero[8] = { 0 };
+    size_t pad = S5_SNAP_ALIGN(len) - len;
+
+    if ( len && fwrite(buf, len, 1, f) != 1 )
+        return -1;
+
+    if ( pad && fwrite(zero, pad, 1, f) != 1 )
+        return -1;
+
+    return 0;
+}
+
+static void Stream5SnapTrackerSave (
+    const StreamTracker* st, S5SnapTracker* rec, uint32_t segs)
+{
+    rec->l_unackd = st->l_unackd;
+    rec->l_nxt_seq = st->l_nxt_seq;
+    rec->l_window = st->l_window;
+    rec->r_nxt_ack = st->r_nxt_ack;
+    rec->r_win_base = st->r_win_base;
+    rec->isn = st->isn;
+    rec->ts_last = st->ts_last;
+    rec->ts_last_pkt = st->ts_last_pkt;
+    rec->transition_seq = st->s_mgr.transition_seq;
+    rec->stq_get_seq = st->s_mgr.stq_get_seq;
+    rec->wscale = st->wscale;
+    rec->mss = st->mss;
+    rec->state = st->s_mgr.state;
+    rec->sub_state = st->s_mgr.sub_state;
+    rec->state_queue = st->s_mgr.state_queue;
+    rec->expected_flags = st->s_mgr.expected_flags;
+    rec->flags = st->flags;
+    memcpy(rec->mac_addr, st->mac_addr, sizeof(rec->mac_addr));
+
+    rec->seg_count = segs;
+
+    /* queued data that isn't saved is simply missed after restart */
+    rec->seglist_base_seq = segs ? st->seglist_base_seq : st->r_nxt_ack;
+}
+
+static void Stream5SnapTrackerRestore (
+    StreamTracker* st, const S5SnapTracker* rec)
+{
+    st->l_unackd = rec->l_unackd;
+    st->l_nxt_seq = rec->l_nxt_seq;
+    st->l_window = rec->l_window;
+    st->r_nxt_ack = rec->r_nxt_ack;
+    st->r_win_base = rec->r_win_base;
+    st->isn = rec->isn;
+    st->ts_last = rec->ts_last;
+    st->ts_last_pkt = rec->ts_last_pkt;
+    st->seglist_base_seq = rec->seglist_base_seq;
+    st->s_mgr.transition_seq = rec->transition_seq;
+    st->s_mgr.stq_get_seq = rec->stq_get_seq;
+    st->wscale = rec->wscale;
+    st->mss = rec->mss;
+    st->s_mgr.state = rec->state;
+    st->s_mgr.sub_state = rec->sub_state;
+    st->s_mgr.state_queue = rec->state_queue;
+    st->s_mgr.expected_flags = rec->expected_flags;
+    st->flags = rec->flags;
+    memcpy(st->mac_addr, rec->mac_addr, sizeof(st->mac_addr));
+}
+
+static int Stream5SnapSegsSave (FILE* f, const StreamTracker* st)
+{
+    const StreamSegment* ss;
+    S5SnapSegment rec;
+
+    for ( ss = st->seglist; ss; ss = ss->next )
+    {
+        if ( ss->buffered )
+            continue;
+
+        memset(&rec, 0, sizeof(rec));
+        rec.tv_sec = (uint32_t)ss->pkth.ts.tv_sec;
+        rec.tv_usec = (uint32_t)ss->pkth.ts.tv_usec;
+        rec.caplen = ss->pkth.caplen;
+        rec.pktlen = ss->pkth.pktlen;
+        rec.seq = ss->seq;
+        rec.ts = ss->ts;
+        rec.data = (uint16_t)(ss->data - ss->pkt);
+        rec.payload = (uint16_t)(ss->payload - ss->data);
+        rec.size = ss->size;
+        rec.orig_dsize = ss->orig_dsize;
+        rec.urg_offset = ss->urg_offset;
+
+        if ( Stream5SnapWrite(f, &rec, sizeof(rec)) ||
+             Stream5SnapWrite(f, ss->pkt, rec.caplen) )
+            return -1;
+    }
+    return 0;
+}
+
+/* validate the segment records of one session; returns the position
+ * after them or NULL if the file is truncated or corrupt */
+static const uint8_t* Stream5SnapSkipSegs (
+    const uint8_t* pos, const uint8_t* end, uint32_t n)
+{
+    while ( n-- )
+    {
+        const S5SnapSegment* rec = (const S5SnapSegment*)pos;
+
+        if ( (size_t)(end - pos) < S5_SNAP_ALIGN(sizeof(*rec)) )
+            return NULL;
+
+        pos += S5_SNAP_ALIGN(sizeof(*rec));
+
+        if ( (size_t)(end - pos) < S5_SNAP_ALIGN(rec->caplen) )
+            return NULL;
+
+        if ( (uint32_t)rec->data + rec->payload + rec->size > rec->caplen )
+            return NULL;
+
+        pos += S5_SNAP_ALIGN(rec->caplen);
+    }
+    return pos;
+}
+
+static const uint8_t* Stream5SnapSegsRestore (
+    StreamTracker* st, const uint8_t* pos, uint32_t n)
+{
+    while ( n-- )
+    {
+        const S5SnapSegment* rec = (const S5SnapSegment*)pos;
+        const uint8_t* pkt = pos + S5_SNAP_ALIGN(sizeof(*rec));
+        StreamSegment* ss;
+
+        pos = pkt + S5_SNAP_ALIGN(rec->caplen);
+
+        /* restore never prunes; whatever doesn't fit is missed */
+        if ( mem_in_use + sizeof(*ss) + rec->caplen + SPARC_TWIDDLE >
+             s5_global_eval_config->memcap )
+            continue;
+
+        ss = (StreamSegment*)SnortAlloc(sizeof(*ss));
+        ss->pktOrig = ss->pkt = (uint8_t*)SnortAlloc(rec->caplen + SPARC_TWIDDLE);
+        mem_in_use += sizeof(*ss) + rec->caplen + SPARC_TWIDDLE;
+
+        ss->caplen = rec->caplen + SPARC_TWIDDLE;
+        ss->pkt += SPARC_TWIDDLE;
+        memcpy(ss->pkt, pkt, rec->caplen);
+
+        ss->pkth.ts.tv_sec = rec->tv_sec;
+        ss->pkth.ts.tv_usec = rec->tv_usec;
+        ss->pkth.caplen = rec->caplen;
+        ss->pkth.pktlen = rec->pktlen;
+
+        ss->data = ss->pkt + rec->data;
+        ss->payload = ss->data + rec->payload;
+        ss->orig_dsize = rec->orig_dsize;
+        ss->size = rec->size;
+        ss->urg_offset = rec->urg_offset;
+        ss->seq = rec->seq;
+        ss->ts = rec->ts;
+
+        Stream5SeglistAddNode(st, st->seglist_tail, ss);
+        st->seg_bytes_logical += ss->size;
+        st->seg_bytes_total += ss->caplen;
+        st->total_segs_queued++;
+        st->total_bytes_queued += ss->size;
+
+        s5stats.tcp_snapshot_segs++;
+    }
+    return pos;
+}
+
+static int Stream5SnapSessionRestore (
+    const S5SnapSession* rec, const uint8_t* segs)
+{
+    Stream5Config* config;
+    Stream5LWSession* lwssn;
+    Stream5TcpPolicy* policy;
+    TcpSession* tcpssn;
+    MemBucket* bucket;
+    SessionKey key = rec->key;
+    int family = rec->ipv6 ? AF_INET6 : AF_INET;
+    sfip_t cip, sip;
+
+    config = (Stream5Config*)sfPolicyUserDataGet(s5_config, rec->policy_id);
+
+    if ( !config || !config->global_config || !config->tcp_config )
+        return 0;
+
+    s5_global_eval_config = config->global_config;
+    s5_tcp_eval_config = config->tcp_config;
+
+    if ( sfip_set_raw(&cip, (void*)rec->client_ip, family) != SFIP_SUCCESS ||
+         sfip_set_raw(&sip, (void*)rec->server_ip, family) != SFIP_SUCCESS )
+        return 0;
+
+    policy = Stream5PolicyLookup(&sip);
+
+    lwssn = RestoreLWSession(
+        tcp_lws_cache, &key, policy, rec->policy_id, (long)rec->last_data_seen);
+
+    if ( !lwssn )
+        return 0;
+
+    bucket = mempool_alloc(&tcp_session_mempool);
+
+    if ( !bucket )
+    {
+        DeleteLWSession(tcp_lws_cache, lwssn, "snapshot restore failed");
+        return 0;
+    }
+    lwssn->client_ip = cip;
+    lwssn->server_ip = sip;
+    lwssn->client_port = rec->client_port;
+    lwssn->server_port = rec->server_port;
+    lwssn->expire_time = rec->expire_time;
+    lwssn->session_state = rec->session_state;
+    lwssn->ignore_direction = rec->ignore_direction;
+    lwssn->inner_client_ttl = rec->inner_client_ttl;
+    lwssn->inner_server_ttl = rec->inner_server_ttl;
+    lwssn->outer_client_ttl = rec->outer_client_ttl;
+    lwssn->outer_server_ttl = rec->outer_server_ttl;
+#ifdef TARGET_BASED
+    lwssn->application_protocol = rec->application_protocol;
+#endif
+
+    /* perf base counts are not carried over */
+    lwssn->session_flags = rec->session_flags &
+        ~(SSNFLAG_COUNTED_INITIALIZE | SSNFLAG_COUNTED_ESTABLISH |
+          SSNFLAG_COUNTED_CLOSING);
+
+    lwssn->proto_specific_data = bucket;
+    tcpssn = bucket->data;
+    tcpssn->lwssn = lwssn;
+    tcpssn->ecn = rec->ecn;
+
+    tcpssn->client.tcp_policy = Stream5PolicyLookup(&cip);
+    tcpssn->server.tcp_policy = policy;
+
+    Stream5SnapTrackerRestore(&tcpssn->client, &rec->client);
+    Stream5SnapTrackerRestore(&tcpssn->server, &rec->server);
+
+    /* policies and flushing follow the current configuration */
+    SetOSPolicy(tcpssn);
+    InitTcpSessionFlushMgrs(tcpssn, ntohs(lwssn->server_port));
+
+    segs = Stream5SnapSegsRestore(&tcpssn->client, segs, rec->client.seg_count);
+    Stream5SnapSegsRestore(&tcpssn->server, segs, rec->server.seg_count);
+
+    s5stats.total_tcp_sessions++;
+    s5stats.tcp_streamtrackers_created++;
+
+    AddStreamSession(&sfBase, lwssn->session_state & STREAM5_STATE_MIDSTREAM ? SSNFLAG_MIDSTREAM : 0);
+
+    return 1;
+}
+
+static void Stream5SnapSessionSave (
+    const TcpSession* tcpssn, S5SnapSession* rec, uint32_t nc, uint32_t ns)
+{
+    const Stream5LWSession* lwssn = tcpssn->lwssn;
+
+    memset(rec, 0, sizeof(*rec));
+
+    rec->key = *lwssn->key;
+    rec->ipv6 = (lwssn->client_ip.family == AF_INET6);
+    memcpy(rec->client_ip, lwssn->client_ip.ip32, sizeof(rec->client_ip));
+    memcpy(rec->server_ip, lwssn->server_ip.ip32, sizeof(rec->server_ip));
+
+    rec->expire_time = lwssn->expire_time;
+    rec->last_data_seen = lwssn->last_data_seen;
+    rec->session_flags = lwssn->session_flags;
+    rec->policy_id = lwssn->policy_id;
+    rec->session_state = lwssn->session_state;
+    rec->client_port = lwssn->client_port;
+    rec->server_port = lwssn->server_port;
+#ifdef TARGET_BASED
+    rec->application_protocol = lwssn->application_protocol;
+#endif
+    rec->ignore_direction = lwssn->ignore_direction;
+    rec->inner_client_ttl = lwssn->inner_client_ttl;
+    rec->inner_server_ttl = lwssn->inner_server_ttl;
+    rec->outer_client_ttl = lwssn->outer_client_ttl;
+    rec->outer_server_ttl = lwssn->outer_server_ttl;
+    rec->ecn = tcpssn->ecn;
+
+    Stream5SnapTrackerSave(&tcpssn->client, &rec->client, nc);
+    Stream5SnapTrackerSave(&tcpssn->server, &rec->server, ns);
+}
+
+/* the sessions are written oldest first so that restoring them in
+ * file order rebuilds the same LRU order */
+static int Stream5SnapSaveSessions (FILE* f, uint32_t budget, uint32_t* count)
+{
+    SFXHASH_NODE* hnode = sfxhash_lru_node(tcp_lws_cache->hashTable);
+    S5SnapSession rec;
+
+    for ( ; hnode; hnode = hnode->gprev )
+    {
+        Stream5LWSession* lwssn = (Stream5LWSession*)hnode->data;
+        TcpSession* tcpssn;
+        uint32_t nc, ns;
+
+        if ( !lwssn || !lwssn->proto_specific_data )
+            continue;
+
+        tcpssn = (TcpSession*)lwssn->proto_specific_data->data;
+
+        if ( !Stream5SnapEligible(tcpssn) )
+            continue;
+
+        nc = Stream5SnapSegCount(&tcpssn->client, &budget);
+        ns = Stream5SnapSegCount(&tcpssn->server, &budget);
+
+        Stream5SnapSessionSave(tcpssn, &rec, nc, ns);
+
+        if ( Stream5SnapWrite(f, &rec, sizeof(rec)) )
+            return -1;
+
+        if ( nc && Stream5SnapSegsSave(f, &tcpssn->client) )
+            return -1;
+
+        if ( ns && Stream5SnapSegsSave(f, &tcpssn->server) )
+            return -1;
+
+        (*count)++;
+    }
+    return 0;
+}
+
+/* once the snapshot is safely written, drop the saved segments so the
+ * exit flush doesn't inspect data the next instance will inspect */
+static void Stream5SnapPurgeSaved (uint32_t budget)
+{
+    SFXHASH_NODE* hnode = sfxhash_lru_node(tcp_lws_cache->hashTable);
+
+    for ( ; hnode; hnode = hnode->gprev )
+    {
+        Stream5LWSession* lwssn = (Stream5LWSession*)hnode->data;
+        TcpSession* tcpssn;
+
+        if ( !lwssn || !lwssn->proto_specific_data )
+            continue;
+
+        tcpssn = (TcpSession*)lwssn->proto_specific_data->data;
+
+        if ( !Stream5SnapEligible(tcpssn) )
+            continue;
+
+        if ( Stream5SnapSegCount(&tcpssn->client, &budget) )
+            purge_all(&tcpssn->client);
+
+        if ( Stream5SnapSegCount(&tcpssn->server, &budget) )
+            purge_all(&tcpssn->server);
+    }
+}
+
+void Stream5SaveTcp (void)
+{
+    Stream5GlobalConfig* gconfig = Stream5SnapConfig();
+    S5SnapHeader hdr;
+    uint32_t count = 0;
+    FILE* f;
+    int err;
+
+    if ( !gconfig )
+        return;
+
+    f = fopen(gconfig->snapshot_file, "wb");
+
+    if ( !f )
+    {
+        ErrorMessage("Stream5: can't create session snapshot %s: %s\n",
+            gconfig->snapshot_file, strerror(errno));
+        return;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = S5_SNAP_MAGIC;
+    hdr.version = S5_SNAP_VERSION;
+    hdr.ssn_size = sizeof(S5SnapSession);
+    hdr.seg_size = sizeof(S5SnapSegment);
+
+    err = Stream5SnapWrite(f, &hdr, sizeof(hdr));
+
+    if ( !err )
+        err = Stream5SnapSaveSessions(f, gconfig->snapshot_max_bytes, &count);
+
+    /* the header is rewritten with the final count */
+    if ( !err )
+    {
+        hdr.sessions = count;
+        err = fseek(f, 0, SEEK_SET) || Stream5SnapWrite(f, &hdr, sizeof(hdr));
+    }
+    if ( fclose(f) )
+        err = -1;
+
+    if ( err )
+    {
+        ErrorMessage("Stream5: failed to write session snapshot %s: %s\n",
+            gconfig->snapshot_file, strerror(errno));
+        unlink(gconfig->snapshot_file);
+        return;
+    }
+    Stream5SnapPurgeSaved(gconfig->snapshot_max_bytes);
+    s5stats.tcp_snapshot_saved = count;
+
+    LogMessage("Stream5: saved %u TCP sessions to %s\n",
+        count, gconfig->snapshot_file);
+}
+
+void Stream5RestoreTcp (void)
+{
+    Stream5GlobalConfig* gconfig = Stream5SnapConfig();
+    Stream5GlobalConfig* save_global = s5_global_eval_config;
+    Stream5TcpConfig* save_tcp = s5_tcp_eval_config;
+    const S5SnapHeader* hdr;
+    const uint8_t* pos, * end;
+    uint32_t i, sessions, restored = 0;
+    struct stat st;
+    uint8_t* base;
+    int fd;
+
+    if ( !gconfig )
+        return;
+
+    fd = open(gconfig->snapshot_file, O_RDONLY);
+
+    if ( fd < 0 )
+    {
+        if ( errno != ENOENT )
+            ErrorMessage("Stream5: can't open session snapshot %s: %s\n",
+                gconfig->snapshot_file, strerror(errno));
+        return;
+    }
+    if ( fstat(fd, &st) || (size_t)st.st_size < S5_SNAP_ALIGN(sizeof(*hdr)) )
+    {
+        ErrorMessage("Stream5: ignoring truncated session snapshot %s\n",
+            gconfig->snapshot_file);
+        close(fd);
+        unlink(gconfig->snapshot_file);
+        return;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if ( base == MAP_FAILED )
+    {
+        ErrorMessage("Stream5: can't map session snapshot %s: %s\n",
+            gconfig->snapshot_file, strerror(errno));
+        return;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(base, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    hdr = (const S5SnapHeader*)base;
+    sessions = hdr->sessions;
+
+    if ( hdr->magic != S5_SNAP_MAGIC || hdr->version != S5_SNAP_VERSION ||
+         hdr->ssn_size != sizeof(S5SnapSession) ||
+         hdr->seg_size != sizeof(S5SnapSegment) )
+    {
+        ErrorMessage("Stream5: ignoring incompatible session snapshot %s\n",
+            gconfig->snapshot_file);
+        sessions = 0;
+    }
+    pos = base + S5_SNAP_ALIGN(sizeof(*hdr));
+    end = base + st.st_size;
+
+    for ( i = 0; i < sessions; i++ )
+    {
+        const S5SnapSession* rec = (const S5SnapSession*)pos;
+        const uint8_t* segs;
+
+        if ( (size_t)(end - pos) < S5_SNAP_ALIGN(sizeof(*rec)) )
+            break;
+
+        segs = pos + S5_SNAP_ALIGN(sizeof(*rec));
+        pos = Stream5SnapSkipSegs(
+            segs, end, rec->client.seg_count + rec->server.seg_count);
+
+        if ( !pos )
+            break;
+
+        restored += Stream5SnapSessionRestore(rec, segs);
+    }
+    if ( i < sessions )
+        ErrorMessage("Stream5: session snapshot %s is truncated\n",
+            gconfig->snapshot_file);
+
+    munmap(base, st.st_size);
+
+    /* consumed; a later crash must not bring these sessions back */
+    unlink(gconfig->snapshot_file);
+
+    s5_global_eval_config = save_global;
+    s5_tcp_eval_config = save_tcp;
+    s5stats.tcp_snapshot_restored = restored;
+
+    LogMessage("Stream5: restored %u of %u TCP sessions from %s\n",
+        restored, sessions, gconfig->snapshot_file);
+}
+
 static int RepeatedSyn(
     StreamTracker *listener, StreamTracker *talker,
     TcpDataBlock *tdb, TcpSession *tcpssn)
@@ -7356,6 +8417,59 @@ static void LogTcpEvents(Stream5TcpPolicy *s5TcpPolicy, int eventcode)
         EventWindowSlam(s5TcpPolicy);
 }
 
+/*
+ * header prediction (as in BSD tcp_input): an in sequence, in window
+ * ACK (or ACK|PSH) segment on a session established in both directions
+ * with no pending state transition can be handled with UpdateSsn() and
+ * the data / flush checks alone.  anything the full state machine could
+ * treat differently (hijack checks, window limits and slams, stream
+ * normalizations) is excluded here so the result is the same either way.
+ */
+static inline int Stream5PredictSegment(
+    Stream5LWSession* lwssn, StreamTracker* talker, StreamTracker* listener,
+    TcpDataBlock* tdb, Packet* p)
+{
+    const Stream5TcpPolicy* policy = listener->tcp_policy;
+    uint32_t win = tdb->win;
+
+    if ( (p->tcph->th_flags & ~TH_PUSH) != TH_ACK )
+        return 0;
+
+    if ( (talker->s_mgr.state != TCP_STATE_ESTABLISHED) ||
+         (listener->s_mgr.state != TCP_STATE_ESTABLISHED) ||
+         (talker->s_mgr.state_queue != TCP_STATE_NONE) ||
+         (listener->s_mgr.state_queue != TCP_STATE_NONE) )
+        return 0;
+
+    if ( !SEQ_EQ(tdb->seq, listener->r_nxt_ack) ||
+         !SEQ_LT(tdb->seq, listener->r_win_base + Stream5GetWindow(listener)) )
+        return 0;
+
+    if ( policy->flags & STREAM5_CONFIG_CHECK_SESSION_HIJACKING )
+        return 0;
+
+    /* window checks in ProcessTcp() are done on the scaled window */
+    if ( (talker->flags & TF_WSCALE) && (listener->flags & TF_WSCALE) )
+        win <<= talker->wscale;
+
+    if ( policy->max_window && (win > policy->max_window) )
+        return 0;
+
+    if ( (p->packet_flags & PKT_FROM_CLIENT) && (win <= SLAM_MAX) &&
+         (tdb->ack == listener->isn + 1) &&
+         !(lwssn->session_flags & SSNFLAG_MIDSTREAM) )
+        return 0;
+
+#ifdef NORMALIZER
+    if ( p->dsize && !(lwssn->session_flags & SSNFLAG_MIDSTREAM) &&
+         (Normalize_IsEnabled(snort_conf, NORM_TCP_TRIM) ||
+          Normalize_IsEnabled(snort_conf, NORM_TCP_ECN_STR)) )
+        return 0;
+#endif
+
+    return 1;
+}
+
 static int ProcessTcp(Stream5LWSession *lwssn, Packet *p, TcpDataBlock *tdb,
         Stream5TcpPolicy *s5TcpPolicy)
 {
@@ -7844,6 +8958,55 @@ static int ProcessTcp(Stream5LWSession *lwssn, Packet *p, TcpDataBlock *tdb,
                 listener->s_mgr.state););
     STREAM5_DEBUG_WRAP(PrintFlushMgr(&listener->flush_mgr););
 
+    if ( !new_ssn && Stream5PredictSegment(lwssn, talker, listener, tdb, p) )
+    {
+        s5stats.tcp_pred_hits++;
+        sfBase.iPegs[PERF_COUNT_TCP_PRED_HIT]++;
+        talker->s_mgr.sub_state |= SUB_ACK_SENT;
+
+        if ((talker->flags & TF_WSCALE) && (listener->flags & TF_WSCALE))
+            tdb->win <<= talker->wscale;
+
+        ts_action = ValidTimestamp(talker, listener, tdb, p, &eventcode, &got_ts);
+
+        if (ts_action != ACTION_NOTHING)
+        {
+            s5stats.tcp_discards++;
+            LogTcpEvents(listener->tcp_policy, eventcode);
+            PREPROC_PROFILE_END(s5TcpStatePerfStats);
+            return ts_action;
+        }
+
+        /* seq == r_nxt_ack is given, so PAWS only needs the ts check */
+        if ( got_ts &&
+            ((int32_t)(tdb->ts - talker->ts_last) >= 0 ||
+             (uint32_t)p->pkth->ts.tv_sec >= talker->ts_last_pkt+PAWS_24DAYS) )
+        {
+            talker->ts_last = tdb->ts;
+            talker->ts_last_pkt = p->pkth->ts.tv_sec;
+        }
+
+        UpdateSsn(p, listener, talker, tdb);
+
+        if ( p->dsize )
+        {
+            ProcessTcpData(p, listener, tcpssn, tdb, s5TcpPolicy);
+#ifdef NORMALIZER
+            CheckFlushPolicyOnData(tcpssn, talker, listener, tdb, p);
+#endif
+        }
+        CheckFlushPolicyOnAck(tcpssn, talker, listener, tdb, p);
+
+        if ( s5_global_eval_config->flags & STREAM5_CONFIG_MEMCAP_GRADED )
+            Stream5CheckPressure(tcpssn, listener, p);
+
+        LogTcpEvents(listener->tcp_policy, eventcode);
+        PREPROC_PROFILE_END(s5TcpStatePerfStats);
+        return ACTION_NOTHING;
+    }
+    s5stats.tcp_pred_misses++;
+    sfBase.iPegs[PERF_COUNT_TCP_PRED_MISS]++;
+
     // may find better placement to eliminate redundant flag checks
     if(p->tcph->th_flags & TH_SYN)
         talker->s_mgr.sub_state |= SUB_SYN_SENT;
@@ -8569,6 +9732,9 @@ dupfin:
     if ( p->tcph->th_flags & TH_ACK )
         CheckFlushPolicyOnAck(tcpssn, talker, listener, tdb, p);
 
+    if ( s5_global_eval_config->flags & STREAM5_CONFIG_MEMCAP_GRADED )
+        Stream5CheckPressure(tcpssn, listener, p);
+
     LogTcpEvents(listener->tcp_policy, eventcode);
     PREPROC_PROFILE_END(s5TcpStatePerfStats);
     return ACTION_NOTHING;
@@ -8994,7 +10160,12 @@ int CheckFlushPolicyOnAck(
         case STREAM_FLPOLICY_PROTOCOL:
         {
             uint32_t flags = GetReverseDir(p);
-            uint32_t flush_amt = flush_pdu_ackd(tcpssn, talker, p, &flags);
+            uint32_t flush_amt;
+
+            if ( talker->skip && !skip_pdu_ackd(tcpssn, talker) )
+                break;
+
+            flush_amt = flush_pdu_ackd(tcpssn, talker, p, &flags);
 
             while ( flush_amt > 0 )
             {
@@ -9011,8 +10182,14 @@ int CheckFlushPolicyOnAck(
                 // but that throws off base
                 purge_to_seq(tcpssn, talker, base + flush_amt);
 
+                if ( talker->skip )
+                {
+                    // a skip requested while flushing takes priority
+                    if ( !skip_pdu_ackd(tcpssn, talker) )
+                        break;
+                }
                 // if we didn't flush as expected, bail
-                if ( flushed != flush_amt )
+                else if ( flushed != flush_amt )
                     break;
 
                 flags = GetReverseDir(p);
@@ -9464,6 +10641,49 @@ uint32_t Stream5GetFlushPointTcp(Stream5LWSession *lwssn, char dir)
     return 0;
 }
 
+void Stream5SkipTcp(Stream5LWSession *lwssn, char dir, uint32_t bytes)
+{
+    TcpSession *tcpssn = NULL;
+    StreamTracker *st;
+    uint32_t end;
+
+    if (lwssn == NULL)
+        return;
+
+    if (lwssn->proto_specific_data != NULL)
+        tcpssn = (TcpSession *)lwssn->proto_specific_data->data;
+
+    if (tcpssn == NULL)
+        return;
+
+    if (dir & SSN_DIR_CLIENT)
+        st = &tcpssn->client;
+    else if (dir & SSN_DIR_SERVER)
+        st = &tcpssn->server;
+    else
+        return;
+
+    // only the ack driven pdu flush knows where the next pdu starts
+    if ( st->flush_mgr.flush_policy != STREAM_FLPOLICY_PROTOCOL )
+        return;
+
+    if ( !s5_paf_boundary(&st->paf_state, &end) )
+        return;
+
+    if ( !SEQ_GT(end, st->seglist_base_seq) )
+        return;
+
+    if ( bytes < end - st->seglist_base_seq )
+        end = st->seglist_base_seq + bytes;
+
+    if ( !st->skip || SEQ_GT(end, st->skip_seq) )
+    {
+        st->skip_seq = end;
+        st->skip = 1;
+        s5stats.tcp_skips++;
+    }
+}
+
 void Stream5SetFlushPointTcp(Stream5LWSession *lwssn,
         char dir, uint32_t flush_point)
 {
@@ -31,6 +31,8 @@ extern LogExtraData extra_data_log;
 extern void *extra_data_config;
 
 void Stream5CleanTcp(void);
+void Stream5SaveTcp(void);
+void Stream5RestoreTcp(void);
 void Stream5ResetTcp(void);
 void Stream5InitTcp(Stream5GlobalConfig *);
 void Stream5TcpRegisterPreprocProfiles(void);
@@ -58,6 +60,7 @@ int Stream5LogSessionAlertExtraDataTcp(Stream5LWSession *lwssn, Packet *p, uint3
 char Stream5GetReassemblyDirectionTcp(Stream5LWSession *lwssn);
 uint32_t Stream5GetFlushPointTcp(Stream5LWSession *lwssn, char dir);
 void Stream5SetFlushPointTcp(Stream5LWSession *lwssn, char dir, uint32_t flush_point);
+void Stream5SkipTcp(Stream5LWSession *lwssn, char dir, uint32_t bytes);
 char Stream5SetReassemblyTcp(Stream5LWSession *lwssn, uint8_t flush_policy, char dir, char flags);
 char Stream5GetReassemblyFlushPolicyTcp(Stream5LWSession *lwssn, char dir);
 char Stream5IsStreamSequencedTcp(Stream5LWSession *lwssn, char dir);
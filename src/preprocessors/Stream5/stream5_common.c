@@ -579,6 +579,9 @@ void Stream5FreeConfig(Stream5Config *config)
 
     if (config->global_config != NULL)
     {
+        if (config->global_config->snapshot_file != NULL)
+            free(config->global_config->snapshot_file);
+
         free(config->global_config);
         config->global_config = NULL;
     }
@@ -107,6 +107,20 @@
 #define STREAM5_CONFIG_IPS                      0x00002000
 #define STREAM5_CONFIG_CHECK_SESSION_HIJACKING  0x00004000
 #define STREAM5_CONFIG_NO_ASYNC_REASSEMBLY      0x00008000
+#define STREAM5_CONFIG_MEMCAP_GRADED            0x00010000
+
+/* memcap pressure levels for graded pruning; each level includes
+ * the reclamation done by the levels below it */
+#define S5_PRESSURE_NONE        0  /* below elevated threshold */
+#define S5_PRESSURE_ELEVATED    1  /* reclaim already flushed segments */
+#define S5_PRESSURE_HIGH        2  /* + enforce per flow byte budget */
+#define S5_PRESSURE_CRITICAL    3  /* + evict sessions (memcap reached) */
+
+#define S5_DEFAULT_PRESSURE_ELEVATED  70  /* percent of memcap */
+#define S5_DEFAULT_PRESSURE_HIGH      85  /* percent of memcap */
+#define S5_DEFAULT_FLOW_BUDGET_DIV    32  /* flow_budget 0 => memcap/32 */
+
+#define S5_DEFAULT_SNAPSHOT_MAX_BYTES 67108864 /* 64 MB of queued segments */
 
 /* traffic direction identification */
 #define FROM_SERVER     0
@@ -204,6 +218,15 @@ typedef struct _Stream5GlobalConfig
     uint32_t   prune_log_max;
     uint32_t   flags;
 
+    /* graded memcap pruning (STREAM5_CONFIG_MEMCAP_GRADED) */
+    uint32_t   flow_budget;       /* max queued bytes per tracker under pressure */
+    uint8_t    pressure_elevated; /* percent of memcap */
+    uint8_t    pressure_high;     /* percent of memcap */
+
+    /* tcp session snapshot for warm restart */
+    char      *snapshot_file;
+    uint32_t   snapshot_max_bytes; /* max queued segment bytes saved */
+
 #ifdef ACTIVE_RESPONSE
     uint32_t   min_response_seconds;
     uint8_t    max_active_responses;
@@ -392,6 +415,8 @@ typedef struct _Stream5Stats
     uint32_t   tcp_overlaps;
     uint32_t   tcp_discards;
     uint32_t   tcp_gaps;
+    uint64_t   tcp_pred_hits;         /* segments taking the prediction fast path */
+    uint64_t   tcp_pred_misses;       /* segments taking the full state machine */
     uint32_t   udp_timeouts;
     uint32_t   udp_sessions_created;
     uint32_t   udp_sessions_released;
@@ -402,6 +427,17 @@ typedef struct _Stream5Stats
     uint32_t   ip_timeouts;
     uint32_t   events;
     uint32_t   internalEvents;
+    uint32_t   tcp_evict_no_pending;  /* memcap evictions, nothing left to inspect */
+    uint32_t   tcp_evict_no_paf;      /* memcap evictions, no paf state */
+    uint32_t   tcp_evict_lru;         /* memcap evictions, plain lru */
+    uint64_t   tcp_reclaim_flushed;   /* bytes of flushed segments released early */
+    uint64_t   tcp_reclaim_budget;    /* bytes flushed and released over flow_budget */
+    uint64_t   tcp_reclaim_evict;     /* bytes released by session eviction */
+    uint32_t   tcp_snapshot_saved;    /* sessions written to snapshot */
+    uint32_t   tcp_snapshot_restored; /* sessions restored from snapshot */
+    uint32_t   tcp_snapshot_segs;     /* queued segments restored */
+    uint32_t   tcp_skips;             /* pdu remainders skipped on request */
+    uint64_t   tcp_skip_bytes;        /* bytes purged without reassembly */
     tPortFilterStats  tcp_port_filter;
     tPortFilterStats  udp_port_filter;
 } Stream5Stats;
@@ -286,6 +286,45 @@ void s5_paf_clear (PAF_State* ps)
 
 //--------------------------------------------------------------------
 
+bool s5_paf_boundary (PAF_State* ps, uint32_t* seq)
+{
+    if ( (ps->paf != PAF_FLUSH) && (ps->paf != PAF_SKIP) )
+        return false;
+
+    *seq = ps->pos + ps->fpt;
+    return true;
+}
+
+void s5_paf_jump (PAF_State* ps, uint32_t seq)
+{
+    uint32_t delta;
+
+    if ( !SEQ_GT(seq, ps->pos) )
+        return;
+
+    delta = seq - ps->pos;
+
+    if ( ps->fpt > delta )
+        ps->fpt -= delta;
+    else
+        ps->fpt = 0;
+
+    ps->pos = seq;
+
+    if ( SEQ_GT(seq, ps->seq) )
+        ps->seq = seq;
+
+    // the tail went with the skipped bytes; the callback
+    // already reset itself when it found this flush point
+    if ( (ps->paf == PAF_FLUSH) && !ps->fpt )
+    {
+        ps->paf = PAF_SEARCH;
+        ps->tot = 0;
+    }
+}
+
+//--------------------------------------------------------------------
+
 uint32_t s5_paf_check (
     void* pv, PAF_State* ps, void* ssn,
     const uint8_t* data, uint32_t len, uint32_t total,
@@ -82,6 +82,13 @@ static inline uint32_t s5_paf_active (PAF_State* ps)
     return ( ps->paf != PAF_ABORT );
 }
 
+// end of the current pdu or skipped chunk if known
+bool s5_paf_boundary(PAF_State*, uint32_t* seq);
+
+// move past bytes purged without scanning; seq must not
+// be beyond the boundary
+void s5_paf_jump(PAF_State*, uint32_t seq);
+
 // called on each in order segment
 uint32_t s5_paf_check(
     void* paf_config, PAF_State*, void* ssn,
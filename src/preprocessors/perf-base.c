@@ -169,13 +169,11 @@ int InitBaseStats(SFBASE *sfBase)
     sfBase->iFragTimeouts = 0;
     sfBase->iFragFaults = 0;
 
-#ifdef NORMALIZER
     {
         int i = 0;
         for ( i = 0; i < PERF_COUNT_MAX; i++ )
             sfBase->iPegs[i] = 0;
     }
-#endif
 
     sfBase->iNewUDPSessions = 0;
     sfBase->iDeletedUDPSessions = 0;
@@ -193,6 +191,10 @@ int InitBaseStats(SFBASE *sfBase)
     sfBase->frag3_mem_in_use = 0;
     sfBase->stream5_mem_in_use = 0;
 
+    sfBase->stream5_pressure_level = 0;
+    memset(sfBase->stream5_reclaimed, 0, sizeof(sfBase->stream5_reclaimed));
+    memset(sfBase->stream5_evictions, 0, sizeof(sfBase->stream5_evictions));
+
     return 0;
 }
 
@@ -671,13 +673,11 @@ int GetEventsPerSecond(SFBASE *sfBase, SFBASE_STATS *sfBaseStats,
     sfBase->iFragTimeouts = 0;
     sfBase->iFragFaults = 0;
 
-#ifdef NORMALIZER
     {
         int i = 0;
         for ( i = 0; i < PERF_COUNT_MAX; i++ )
             sfBase->iPegs[i] = 0;
     }
-#endif
 
     sfBaseStats->total_udp_sessions = sfBase->iTotalUDPSessions;
     sfBaseStats->max_udp_sessions = sfBase->iMaxUDPSessions;
@@ -976,13 +976,11 @@ int CalculateBasePerfStats(SFBASE *sfBase, SFBASE_STATS *sfBaseStats)
     sfBaseStats->total_tcp_filtered_packets = sfBase->total_tcp_filtered_packets;
     sfBaseStats->total_udp_filtered_packets = sfBase->total_udp_filtered_packets;
 
-#ifdef NORMALIZER
     {
         int iCtr;
         for ( iCtr = 0; iCtr < PERF_COUNT_MAX; iCtr++ )
             sfBaseStats->pegs[iCtr] = sfBase->iPegs[iCtr];
     }
-#endif
 
     /*
     **  Avg. bytes per Packet
@@ -1090,6 +1088,18 @@ int CalculateBasePerfStats(SFBASE *sfBase, SFBASE_STATS *sfBaseStats)
     sfBaseStats->frag3_mem_in_use = sfBase->frag3_mem_in_use;
     sfBaseStats->stream5_mem_in_use = sfBase->stream5_mem_in_use;
 
+    /*
+    **  Stream5 memcap pressure; reclaimed bytes and evictions
+    **  are per interval, the level is current.
+    */
+    sfBaseStats->stream5_pressure_level = sfBase->stream5_pressure_level;
+    memcpy(sfBaseStats->stream5_reclaimed, sfBase->stream5_reclaimed,
+        sizeof(sfBaseStats->stream5_reclaimed));
+    memcpy(sfBaseStats->stream5_evictions, sfBase->stream5_evictions,
+        sizeof(sfBaseStats->stream5_evictions));
+    memset(sfBase->stream5_reclaimed, 0, sizeof(sfBase->stream5_reclaimed));
+    memset(sfBase->stream5_evictions, 0, sizeof(sfBase->stream5_evictions));
+
     /*
     **  Set the date string for print out
     */
@@ -1358,22 +1368,25 @@ int LogBasePerfStats(SFBASE_STATS *sfBaseStats,  FILE * fh )
             sfBaseStats->total_tcp_filtered_packets,
             sfBaseStats->total_udp_filtered_packets);
 
-#ifdef NORMALIZER
     for ( iCtr = 0; iCtr < PERF_COUNT_MAX; iCtr++ )
         fprintf(fh, CSVu64, sfBaseStats->pegs[iCtr]);
-#endif
 
     fprintf(fh, CSVu64, sfBaseStats->total_injected_packets);
     fprintf(fh, CSVu64, sfBaseStats->frag3_mem_in_use);
     fprintf(fh, CSVu64, sfBaseStats->stream5_mem_in_use);
 
+    fprintf(fh, CSVu64, sfBaseStats->stream5_pressure_level);
+    for ( iCtr = 0; iCtr < PERF_RECLAIM_MAX; iCtr++ )
+        fprintf(fh, CSVu64, sfBaseStats->stream5_reclaimed[iCtr]);
+    for ( iCtr = 0; iCtr < PERF_EVICT_MAX; iCtr++ )
+        fprintf(fh, CSVu64, sfBaseStats->stream5_evictions[iCtr]);
+
     fprintf(fh,"\n");
     fflush(fh);
 
     return 0;
 }
 
-#ifdef NORMALIZER
 static const char* iNames[PERF_COUNT_MAX] = {
     "ip4::trim",
     "ip4::tos",
@@ -1398,9 +1411,10 @@ static const char* iNames[PERF_COUNT_MAX] = {
     "tcp::ts_ecr",
     "tcp::ts_nop",
     "tcp::ips_data",
-    "tcp::block"
+    "tcp::block",
+    "tcp::pred_hit",
+    "tcp::pred_miss"
 };
-#endif
 
 // IMPORTANT - whatever changes you make here, please be sure
 // they correspond to the LogBasePerfStats() above!
@@ -1533,10 +1547,8 @@ void LogBasePerfHeader (FILE* fh)
         "total_tcp_filtered_packets",
         "total_udp_filtered_packets");
 
-#ifdef NORMALIZER
     for ( iCtr = 0; iCtr < PERF_COUNT_MAX; iCtr++ )
         fprintf(fh, ",%s", iNames[iCtr]);
-#endif
 
     fprintf(fh,
         ",%s,%s,%s",
@@ -1544,6 +1556,16 @@ void LogBasePerfHeader (FILE* fh)
         "frag3_mem_in_use",
         "stream5_mem_in_use");
 
+    fprintf(fh,
+        ",%s,%s,%s,%s,%s,%s,%s",
+        "stream5_pressure_level",
+        "stream5_reclaimed_flushed",
+        "stream5_reclaimed_budget",
+        "stream5_reclaimed_evict",
+        "stream5_evict_no_pending",
+        "stream5_evict_no_paf",
+        "stream5_evict_lru");
+
     fprintf(fh,"\n");
     fflush(fh);
 }
@@ -1706,16 +1728,28 @@ int DisplayBasePerfStatsConsole(SFBASE_STATS *sfBaseStats, int iFlags)
     LogMessage("Current Cached UDP Ssns:  " STDu64 "\n", sfBaseStats->total_udp_sessions);
     LogMessage("Max Cached UDP Ssns    :  " STDu64 "\n\n", sfBaseStats->max_udp_sessions);
 
+    LogMessage("Stream5 Memcap Pressure:  " STDu64 "\n", sfBaseStats->stream5_pressure_level);
+    LogMessage("Reclaimed Flushed Bytes:  " STDu64 "\n",
+        sfBaseStats->stream5_reclaimed[PERF_RECLAIM_FLUSHED]);
+    LogMessage("Reclaimed Budget Bytes :  " STDu64 "\n",
+        sfBaseStats->stream5_reclaimed[PERF_RECLAIM_BUDGET]);
+    LogMessage("Reclaimed Evicted Bytes:  " STDu64 "\n",
+        sfBaseStats->stream5_reclaimed[PERF_RECLAIM_EVICT]);
+    LogMessage("Evicted Idle Sessions  :  " STDu64 "\n",
+        sfBaseStats->stream5_evictions[PERF_EVICT_NO_PENDING]);
+    LogMessage("Evicted Non-PAF Ssns   :  " STDu64 "\n",
+        sfBaseStats->stream5_evictions[PERF_EVICT_NO_PAF]);
+    LogMessage("Evicted LRU Sessions   :  " STDu64 "\n\n",
+        sfBaseStats->stream5_evictions[PERF_EVICT_LRU]);
+
 #ifdef TARGET_BASED
     LogMessage("Attribute Table Hosts  :  " STDu64 "\n", sfBaseStats->current_attribute_hosts);
     LogMessage("Attribute Table Reloads:  " STDu64 "\n\n", sfBaseStats->attribute_table_reloads);
 #endif
 
-#ifdef NORMALIZER
     for ( iCtr = 0; iCtr < PERF_COUNT_MAX; iCtr++ )
         LogMessage("%-26s:  " STDu64 "\n",
             iNames[iCtr], sfBaseStats->pegs[iCtr]);
-#endif
     LogMessage("\n");
 
     /*
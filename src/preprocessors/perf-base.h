@@ -75,9 +75,27 @@ typedef enum {
     PERF_COUNT_TCP_TS_NOP,
     PERF_COUNT_TCP_IPS_DATA,
     PERF_COUNT_TCP_BLOCK,
+    PERF_COUNT_TCP_PRED_HIT,
+    PERF_COUNT_TCP_PRED_MISS,
     PERF_COUNT_MAX
 } PerfCounts;
 
+/* stream5 memcap pressure: bytes reclaimed per tier */
+typedef enum {
+    PERF_RECLAIM_FLUSHED,   /* already inspected segments */
+    PERF_RECLAIM_BUDGET,    /* flows over their byte budget */
+    PERF_RECLAIM_EVICT,     /* whole sessions */
+    PERF_RECLAIM_MAX
+} PerfReclaimTiers;
+
+/* stream5 memcap pressure: session evictions by reason */
+typedef enum {
+    PERF_EVICT_NO_PENDING,  /* nothing left to inspect */
+    PERF_EVICT_NO_PAF,      /* no protocol aware flushing state */
+    PERF_EVICT_LRU,         /* oldest session */
+    PERF_EVICT_MAX
+} PerfEvictReasons;
+
 typedef struct _SFBASE
 {
     uint64_t   total_wire_packets;
@@ -130,9 +148,7 @@ typedef struct _SFBASE
     uint64_t   iFragTimeouts;   /* # of times we've reached timeout */
     uint64_t   iFragFaults;     /* # of times we've run out of memory */
 
-#ifdef NORMALIZER
     uint64_t   iPegs[PERF_COUNT_MAX];
-#endif
 
 #ifdef LINUX_SMP
     SFPROCPIDSTATS sfProcPidStats;
@@ -167,6 +183,10 @@ typedef struct _SFBASE
 
     uint64_t   frag3_mem_in_use;
     uint64_t   stream5_mem_in_use;
+
+    uint64_t   stream5_pressure_level;
+    uint64_t   stream5_reclaimed[PERF_RECLAIM_MAX];
+    uint64_t   stream5_evictions[PERF_EVICT_MAX];
 }  SFBASE;
 
 typedef struct _SYSTIMES {
@@ -228,9 +248,7 @@ typedef struct _SFBASE_STATS {
     double   patmatch_percent;
     time_t   time;
 
-#ifdef NORMALIZER
     uint64_t   pegs[PERF_COUNT_MAX];
-#endif
 
 #ifdef LINUX_SMP
     SFPROCPIDSTATS *sfProcPidStats;
@@ -272,6 +290,10 @@ typedef struct _SFBASE_STATS {
 
     uint64_t   frag3_mem_in_use;
     uint64_t   stream5_mem_in_use;
+
+    uint64_t   stream5_pressure_level;
+    uint64_t   stream5_reclaimed[PERF_RECLAIM_MAX];
+    uint64_t   stream5_evictions[PERF_EVICT_MAX];
 }  SFBASE_STATS;
 
 int InitBaseStats(SFBASE *sfBase);
@@ -105,6 +105,13 @@ extern MemPool *hi_gzip_mempool;
 /* Stats tracking for HTTP Inspect */
 HIStats hi_stats;
 
+/* Session memory; the gauges live outside hi_stats so a stats reset
+ * doesn't lose track of what is still allocated */
+HiMemPool hi_session_pool = { NULL, NULL, sizeof(HttpSessionData), 0 };
+HiMemPool hi_log_state_pool = { NULL, NULL, sizeof(HTTP_LOG_STATE), 0 };
+HiMemPool hi_true_ip_pool = { NULL, NULL, sizeof(sfip_t), 0 };
+HiSessionMem hi_session_mem;
+
 DataBuffer HttpDecodeBuf;
 
 const HiSearchToken hi_patterns[] =
@@ -173,6 +180,7 @@ HISearchInfo hi_search_info;
 #define SMALL_CHUNK_LENGTH  "small_chunk_length"
 #define MAX_HDR_LENGTH    "max_header_length"
 #define PIPELINE          "no_pipeline_req"
+#define PIPELINE_BATCH    "batch_pipeline_req"
 #define ASCII             "ascii"
 #define DOUBLE_DECODE     "double_decode"
 #define U_ENCODE          "u_encode"
@@ -217,6 +225,7 @@ HISearchInfo hi_search_info;
 #define LOG_URI           "log_uri"
 #define LOG_HOSTNAME      "log_hostname"
 #define HTTP_MEMCAP       "memcap"
+#define SESSION_MEMCAP    "session_memcap"
 #define MAX_SPACES    "max_spaces"
 
 #define MAX_CLIENT_DEPTH 1460
@@ -642,6 +651,44 @@ static int ProcessHttpMemcap(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
 
 }
 
+static int ProcessSessionMemcap(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
+                char *ErrorString, int ErrStrLen)
+{
+    char *pcToken, *pcEnd;
+    int memcap;
+
+    pcToken = strtok(NULL, CONF_SEPARATORS);
+    if(pcToken == NULL)
+    {
+        SnortSnprintf(ErrorString, ErrStrLen,
+                    "No argument to '%s' token.", SESSION_MEMCAP);
+        return -1;
+    }
+
+    memcap = SnortStrtolRange(pcToken, &pcEnd, 10, 0 , INT_MAX);
+    if(*pcEnd)
+    {
+        SnortSnprintf(ErrorString, ErrStrLen,
+                    "Invalid argument to '%s'.", SESSION_MEMCAP);
+
+        return -1;
+    }
+
+    /* 0 leaves session memory uncapped */
+    if(memcap && memcap < MIN_HTTP_SESSION_MEMCAP)
+    {
+        SnortSnprintf(ErrorString, ErrStrLen,
+                "Invalid argument to '%s'.  Must be 0 or between %d and "
+                "%d.", SESSION_MEMCAP, MIN_HTTP_SESSION_MEMCAP, INT_MAX);
+
+        return -1;
+    }
+
+    GlobalConf->session_memcap = memcap;
+
+    return 0;
+}
+
 
 #ifdef ZLIB
 static int ProcessMaxGzipMem(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
@@ -879,6 +926,12 @@ int ProcessGlobalConf(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
             if(iRet)
                 return iRet;
         }
+        else if (!strcmp(SESSION_MEMCAP, pcToken))
+        {
+            iRet = ProcessSessionMemcap(GlobalConf, ErrorString, ErrStrLen);
+            if(iRet)
+                return iRet;
+        }
         else
         {
             SnortSnprintf(ErrorString, ErrStrLen,
@@ -1692,6 +1745,9 @@ static int ProcessNonRfcChar(HTTPINSPECT_CONF *ServerConf,
         }
 
         ServerConf->non_rfc_chars[iChar] = 1;
+
+        if(iChar >= 0x20 && iChar < 0x80)
+            ServerConf->non_rfc_printable = 1;
     }
 
     if(!iEndChar)
@@ -2208,6 +2264,10 @@ static int ProcessServerConf(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
                     return iRet;
                 }
             }
+            else if(!strcmp(PIPELINE_BATCH, pcToken))
+            {
+                ServerConf->batch_pipeline = 1;
+            }
             else
             {
                 SnortSnprintf(ErrorString, ErrStrLen,
@@ -2215,13 +2275,14 @@ static int ProcessServerConf(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
                               "The only allowed tokens when configuring profiles "
                               "are: '%s', '%s', '%s', '%s', '%s', '%s', '%s', "
                               "'%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s',"
-                              "'%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', and '%s'. ",
+                              "'%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', and '%s'. ",
                               PORTS,IIS_UNICODE_MAP, ALLOW_PROXY, FLOW_DEPTH,
                               CLIENT_FLOW_DEPTH, GLOBAL_ALERT, OVERSIZE_DIR, MAX_HDR_LENGTH,
                               INSPECT_URI_ONLY, INSPECT_COOKIES, INSPECT_RESPONSE,
                               EXTRACT_GZIP,MAX_HEADERS, NORMALIZE_COOKIES, ENABLE_XFF,
                               NORMALIZE_HEADERS, NORMALIZE_UTF, UNLIMIT_DECOMPRESS, HTTP_METHODS, 
-                              LOG_URI, LOG_HOSTNAME, MAX_SPACES, NORMALIZE_JS, MAX_JS_WS);
+                              LOG_URI, LOG_HOSTNAME, MAX_SPACES, NORMALIZE_JS, MAX_JS_WS,
+                              PIPELINE_BATCH);
 
                 return -1;
             }
@@ -2311,6 +2372,10 @@ static int ProcessServerConf(HTTPINSPECT_GLOBAL_CONF *GlobalConf,
         {
             ServerConf->no_pipeline = 1;
         }
+        else if(!strcmp(PIPELINE_BATCH, pcToken))
+        {
+            ServerConf->batch_pipeline = 1;
+        }
         else if(!strcmp(NON_STRICT, pcToken))
         {
             ServerConf->non_strict = 1;
@@ -2724,6 +2789,8 @@ static int PrintServerConf(HTTPINSPECT_CONF *ServerConf)
     LogMessage("      Max Number of WhiteSpaces allowed with header folding: %d\n", ServerConf->max_spaces);
     LogMessage("      Inspect Pipeline Requests: %s\n",
                ServerConf->no_pipeline ? "NO" : "YES");
+    LogMessage("      Detect Pipeline Requests Together: %s\n",
+               ServerConf->batch_pipeline ? "YES" : "NO");
     LogMessage("      URI Discovery Strict Mode: %s\n",
                ServerConf->non_strict ? "NO" : "YES");
     LogMessage("      Allow Proxy Usage: %s\n",
@@ -3069,6 +3136,11 @@ int PrintGlobalConf(HTTPINSPECT_GLOBAL_CONF *GlobalConf)
                GlobalConf->iis_unicode_codepage);
     LogMessage("      Memcap used for logging URI and Hostname: %u\n",
                GlobalConf->memcap);
+    if(GlobalConf->session_memcap)
+        LogMessage("      Session Memcap:           %d\n",
+                   GlobalConf->session_memcap);
+    else
+        LogMessage("      Session Memcap:           UNLIMITED\n");
 #ifdef ZLIB
     LogMessage("      Max Gzip Memory: %d\n",
                 GlobalConf->max_gzip_mem);
@@ -3341,6 +3413,29 @@ static inline void setFileName(Packet *p)
     GetHttpUriData(p->ssnptr, &buf, &len, &type);
     file_api->set_file_name (p->ssnptr, buf, len);
 }
+
+/*
+**  Detects the pipelined requests saved with HttpBufferSetSave() in one
+**  pass through the detection engine.  The current request's buffers are
+**  put back afterwards.
+*/
+static inline void DetectHttpBufferSets(Packet *p)
+{
+    HttpUri uri_bufs[HTTP_BUFFER_MAX];
+    uint8_t uri_count = p->uri_count;
+    uint32_t pipeline_count = p->http_pipeline_count;
+
+    if (HttpBufferSetCount == 0)
+        return;
+
+    memcpy(uri_bufs, UriBufs, sizeof(uri_bufs));
+    Detect(p);
+    HttpBufferSetReset();
+    memcpy(UriBufs, uri_bufs, sizeof(UriBufs));
+    p->uri_count = uri_count;
+    p->http_pipeline_count = pipeline_count;
+}
+
 /*
 **  NAME
 **    SnortHttpInspect::
@@ -3373,6 +3468,7 @@ static inline void setFileName(Packet *p)
 #define HTTP_BUF_COOKIE_FLAG        0x10
 #define HTTP_BUF_STAT_CODE          0x20
 #define HTTP_BUF_STAT_MSG           0x40
+
 int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
 {
     HI_SESSION  *Session;
@@ -3380,6 +3476,7 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
     int iInspectMode = 0;
     int iRet;
     int iCallDetect = 1;
+    int iBatchDetect = 0;
     HttpSessionData *hsd = NULL;
 
     PROFILE_VARS;
@@ -3513,7 +3610,14 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
     **  The reason for the loop is for pipelined requests.  Doing pipelined
     **  requests in this way doesn't require any memory or tracking overhead.
     **  Instead, we just process each request linearly.
+    **
+    **  With batch_pipeline_req the buffers of each request are saved and
+    **  the requests are detected together once the loop is done, so the
+    **  packet itself only goes through the detection engine once.
     */
+    if ((iInspectMode == HI_SI_CLIENT_MODE) && Session->server_conf->batch_pipeline)
+        iBatchDetect = 1;
+
     do
     {
         /*
@@ -3529,6 +3633,7 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
         iRet = hi_mi_mode_inspection(Session, iInspectMode, p, hsd);
         if (iRet)
         {
+            DetectHttpBufferSets(p);
             LogEvents(Session, p, iInspectMode, hsd);
             return iRet;
         }
@@ -3536,6 +3641,7 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
         iRet = hi_normalization(Session, iInspectMode, hsd);
         if (iRet)
         {
+            DetectHttpBufferSets(p);
             LogEvents(Session, p, iInspectMode, hsd);
             return iRet;
         }
@@ -3690,6 +3796,7 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
 
                 if( (p->uri_count == 0) && (p->alt_dsize == 0)  )
                 {
+                    DetectHttpBufferSets(p);
                     DisableDetect(p);
                     SetAllPreprocBits(p);
                     return 0;
@@ -3857,7 +3964,17 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
         */
         PREPROC_PROFILE_START(hiDetectPerfStats);
         p->http_pipeline_count++; /* Increment the count */
-        Detect(p);
+
+        if (!iBatchDetect)
+            Detect(p);
+        else if (!HttpBufferSetSave(p))
+        {
+            /* Out of room, detect the requests saved so far first */
+            DetectHttpBufferSets(p);
+
+            if (!HttpBufferSetSave(p))
+                Detect(p);
+        }
 #ifdef PERF_PROFILING
         hiDetectCalled = 1;
 #endif
@@ -3883,6 +4000,13 @@ int SnortHttpInspect(HTTPINSPECT_GLOBAL_CONF *GlobalConf, Packet *p)
 
     } while(Session->client.request.pipeline_req);
 
+    if (iBatchDetect)
+    {
+        PREPROC_PROFILE_START(hiDetectPerfStats);
+        DetectHttpBufferSets(p);
+        PREPROC_PROFILE_END(hiDetectPerfStats);
+    }
+
     if ( iCallDetect == 0 )
     {
         /* Detect called at least once from above pkt processing loop. */
@@ -3937,7 +4061,10 @@ HttpSessionData * SetNewHttpSessionData(Packet *p, void *data)
         return NULL;
 
 
-    hsd = (HttpSessionData *)SnortAlloc(sizeof(HttpSessionData));
+    hsd = (HttpSessionData *)HttpSessionMemAlloc(&hi_session_pool);
+    if (hsd == NULL)
+        return NULL;
+
     init_decode_utf_state(&hsd->utf_state);
 
     stream_api->set_application_data(p->ssnptr, PP_HTTPINSPECT, hsd, FreeHttpSessionData);
@@ -3948,14 +4075,21 @@ HttpSessionData * SetNewHttpSessionData(Packet *p, void *data)
 void FreeHttpSessionData(void *data)
 {
     HttpSessionData *hsd = (HttpSessionData *)data;
+    uint32_t size;
 
     if (hsd == NULL)
         return;
 
+    size = HttpSessionMemSize(hsd);
+    hi_stats.sessions_freed++;
+    hi_stats.session_mem_freed += size;
+    if (hi_stats.session_mem_max < size)
+        hi_stats.session_mem_max = size;
+
 #ifdef ZLIB
     if (hsd->decomp_state != NULL)
     {
-        inflateEnd(&(hsd->decomp_state->d_stream));
+        ResetGzipState(hsd->decomp_state);
         mempool_free(hi_gzip_mempool, hsd->decomp_state->bkt);
     }
 #endif
@@ -3963,15 +4097,221 @@ void FreeHttpSessionData(void *data)
     if (hsd->log_state != NULL)
     {
         mempool_free(http_mempool, hsd->log_state->log_bucket);
-        free(hsd->log_state);
+        HttpSessionMemFree(&hi_log_state_pool, hsd->log_state);
     }
 
     if(hsd->true_ip)
-        sfip_free(hsd->true_ip);
+        HttpSessionMemFree(&hi_true_ip_pool, hsd->true_ip);
+
+    HttpSessionMemFree(&hi_session_pool, hsd);
+}
+
+/*
+**  Everything a session holds, whichever pool it came from.
+*/
+uint32_t HttpSessionMemSize(HttpSessionData *hsd)
+{
+    uint32_t size = sizeof(*hsd);
+
+#ifdef ZLIB
+    if (hsd->decomp_state != NULL)
+        size += sizeof(DECOMPRESS_STATE);
+#endif
+
+    if (hsd->log_state != NULL)
+        size += sizeof(HTTP_LOG_STATE) + MAX_URI_EXTRACTED + MAX_HOSTNAME;
+
+    if (hsd->true_ip != NULL)
+        size += sizeof(sfip_t);
+
+    return size;
+}
+
+#define HI_POOL_SLAB_OBJS 64
+
+/* objects are padded so the free list link in each stays aligned */
+static inline size_t HiPoolStride(const HiMemPool *pool)
+{
+    return (pool->obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+}
+
+static int HiPoolGrow(HiMemPool *pool)
+{
+    size_t stride = HiPoolStride(pool);
+    size_t slab_size = sizeof(void *) + stride * HI_POOL_SLAB_OBJS;
+    uint8_t *slab, *obj;
+    int i;
+
+    slab = (uint8_t *)malloc(slab_size);
+    if (slab == NULL)
+        return -1;
+
+    /* first word links the slabs for HttpSessionMemDestroy() */
+    *(void **)slab = pool->slabs;
+    pool->slabs = slab;
+
+    obj = slab + sizeof(void *);
+    for (i = 0; i < HI_POOL_SLAB_OBJS; i++, obj += stride)
+    {
+        *(void **)obj = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    hi_session_mem.reserved += slab_size;
+    return 0;
+}
+
+/*
+**  Returns a zeroed object or NULL if the session memcap would be
+**  exceeded.  Callers already treat a NULL from the gzip and log
+**  mempools as "do without"; the same holds here.
+*/
+void *HttpSessionMemAlloc(HiMemPool *pool)
+{
+    void *obj;
+
+    if (hi_session_mem.memcap &&
+        (hi_session_mem.in_use + pool->obj_size > hi_session_mem.memcap))
+    {
+        hi_stats.session_memcap_drops++;
+        return NULL;
+    }
+
+    if ((pool->free_list == NULL) && HiPoolGrow(pool))
+        return NULL;
+
+    obj = pool->free_list;
+    pool->free_list = *(void **)obj;
+    pool->in_use++;
+
+    hi_session_mem.in_use += pool->obj_size;
+    if (hi_session_mem.peak < hi_session_mem.in_use)
+        hi_session_mem.peak = hi_session_mem.in_use;
+
+    memset(obj, 0, pool->obj_size);
+    return obj;
+}
+
+void HttpSessionMemFree(HiMemPool *pool, void *obj)
+{
+    if (obj == NULL)
+        return;
+
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->in_use--;
+
+    hi_session_mem.in_use -= pool->obj_size;
+}
+
+static void HiPoolDestroy(HiMemPool *pool)
+{
+    void *slab = pool->slabs;
+
+    while (slab != NULL)
+    {
+        void *next = *(void **)slab;
+        free(slab);
+        slab = next;
+    }
+
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+}
+
+void HttpSessionMemDestroy(void)
+{
+    HiPoolDestroy(&hi_session_pool);
+    HiPoolDestroy(&hi_log_state_pool);
+    HiPoolDestroy(&hi_true_ip_pool);
+
+    hi_session_mem.in_use = 0;
+    hi_session_mem.reserved = 0;
+}
+
+#ifdef ZLIB
+/*
+**  Inflate contexts are pooled so that each compressed body costs an
+**  inflateReset2() instead of an inflateInit()/inflateEnd() pair and the
+**  ~40K of zlib state and window that goes with it.  Contexts in use are
+**  bounded by the gzip mempool (one per DECOMPRESS_STATE); idle ones by
+**  MAX_INFLATE_POOL.
+*/
+#if ZLIB_VERNUM >= 0x1234
+#define HI_INFLATE_RESET2
+#endif
+
+static z_stream *inflate_pool[MAX_INFLATE_POOL];
+static unsigned inflate_pool_count = 0;
+
+int HttpInspectInflateReset(z_stream *stream, int wbits)
+{
+#ifdef HI_INFLATE_RESET2
+    return inflateReset2(stream, wbits);
+#else
+    inflateEnd(stream);
+    memset(stream, 0, sizeof(*stream));
+    return inflateInit2(stream, wbits);
+#endif
+}
+
+z_stream *HttpInspectInflateGet(int wbits)
+{
+    z_stream *stream;
+
+    while (inflate_pool_count)
+    {
+        stream = inflate_pool[--inflate_pool_count];
+
+        if (HttpInspectInflateReset(stream, wbits) == Z_OK)
+        {
+            hi_stats.inflate_reused++;
+            return stream;
+        }
+        inflateEnd(stream);
+        free(stream);
+    }
+
+    stream = (z_stream *)calloc(1, sizeof(*stream));
+
+    if (stream == NULL)
+        return NULL;
 
-    free(hsd);
+    if (inflateInit2(stream, wbits) != Z_OK)
+    {
+        inflateEnd(stream);
+        free(stream);
+        return NULL;
+    }
+    return stream;
 }
 
+void HttpInspectInflatePut(z_stream *stream)
+{
+    if (stream == NULL)
+        return;
+
+    if (inflate_pool_count < MAX_INFLATE_POOL)
+    {
+        inflate_pool[inflate_pool_count++] = stream;
+        return;
+    }
+    inflateEnd(stream);
+    free(stream);
+}
+
+void HttpInspectInflateFree(void)
+{
+    while (inflate_pool_count)
+    {
+        z_stream *stream = inflate_pool[--inflate_pool_count];
+        inflateEnd(stream);
+        free(stream);
+    }
+}
+#endif
+
 int GetHttpTrueIP(void *data, uint8_t **buf, uint32_t *len, uint32_t *type)
 {
     sfip_t *true_ip = NULL;
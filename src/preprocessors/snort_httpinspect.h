@@ -59,6 +59,7 @@ extern DataBuffer HttpDecodeBuf;
 #define DEFAULT_HTTP_MEMCAP 150994944 /* 144 MB */
 #define MIN_HTTP_MEMCAP     2304
 #define MAX_HTTP_MEMCAP     603979776 /* 576 MB */
+#define MIN_HTTP_SESSION_MEMCAP 65536
 #define MAX_URI_EXTRACTED   2048
 #define MAX_HOSTNAME        256
 
@@ -74,6 +75,10 @@ extern DataBuffer HttpDecodeBuf;
 #define DEFLATE_RAW_WBITS -15
 #define DEFLATE_WBITS   15
 #define GZIP_WBITS      31
+#define AUTO_WBITS      47  /* gzip or zlib header */
+
+/* idle inflate contexts kept for reuse; each holds ~40K of zlib state */
+#define MAX_INFLATE_POOL 64
 
 
 typedef enum _HttpRespCompressType
@@ -85,16 +90,15 @@ typedef enum _HttpRespCompressType
 
 typedef struct s_DECOMPRESS_STATE
 {
-    uint8_t inflate_init;
+    uint8_t raw_deflate;    /* retried the body as raw deflate */
     int compr_bytes_read;
     int decompr_bytes_read;
     int compr_depth;
     int decompr_depth;
     uint16_t compress_fmt;
     uint8_t decompress_data;
-    z_stream d_stream;
+    z_stream *d_stream;     /* from the inflate pool, NULL until the body starts */
     MemBucket *bkt;
-    bool deflate_initialized;
 
 } DECOMPRESS_STATE;
 #endif
@@ -110,6 +114,7 @@ typedef struct s_HTTP_RESP_STATE
     int data_extracted;
     uint32_t max_seq;
     bool flow_depth_excd;
+    JSResume js_resume;     /* script left open by the last body segment */
 }HTTP_RESP_STATE;
 
 typedef struct s_HTTP_LOG_STATE
@@ -121,21 +126,54 @@ typedef struct s_HTTP_LOG_STATE
     uint8_t *hostname_extracted;
 }HTTP_LOG_STATE;
 
+/* Only what every session needs is kept inline; the rest is attached
+ * when a session first uses it.  Pointers first to keep it to 64 bytes. */
 typedef struct _HttpSessionData
 {
-    uint32_t event_flags;
-    HTTP_RESP_STATE resp_state;
 #ifdef ZLIB
-    DECOMPRESS_STATE *decomp_state;
+    DECOMPRESS_STATE *decomp_state;     /* hi_gzip_mempool */
 #endif
-    HTTP_LOG_STATE *log_state;
-    sfip_t *true_ip;
+    HTTP_LOG_STATE *log_state;          /* hi_log_state_pool + http_mempool */
+    sfip_t *true_ip;                    /* hi_true_ip_pool */
+    uint32_t event_flags;
+    HTTP_RESP_STATE resp_state;
     decode_utf_state_t utf_state;
     uint8_t log_flags;
     uint8_t cli_small_chunk_count;
     uint8_t srv_small_chunk_count;
 } HttpSessionData;
 
+/*
+**  Typed pools for session memory.  Objects are carved from slabs and
+**  recycled through a free list; slabs are kept until exit.  Live
+**  objects are counted against the global session_memcap.
+*/
+typedef struct _HiMemPool
+{
+    void *free_list;
+    void *slabs;
+    size_t obj_size;
+    uint32_t in_use;
+} HiMemPool;
+
+typedef struct _HiSessionMem
+{
+    uint64_t memcap;        /* 0 is no cap */
+    uint64_t in_use;        /* bytes in live pooled objects */
+    uint64_t peak;
+    uint64_t reserved;      /* bytes in slabs */
+} HiSessionMem;
+
+extern HiMemPool hi_session_pool;
+extern HiMemPool hi_log_state_pool;
+extern HiMemPool hi_true_ip_pool;
+extern HiSessionMem hi_session_mem;
+
+void *HttpSessionMemAlloc(HiMemPool *);
+void HttpSessionMemFree(HiMemPool *, void *);
+void HttpSessionMemDestroy(void);
+uint32_t HttpSessionMemSize(HttpSessionData *);
+
 typedef struct _HISearch
 {
     char *name;
@@ -269,14 +307,23 @@ static inline void HttpLogFuncs(HTTPINSPECT_GLOBAL_CONF *GlobalConf, HttpSession
 
 
 #ifdef ZLIB
+z_stream *HttpInspectInflateGet(int wbits);
+int HttpInspectInflateReset(z_stream *, int wbits);
+void HttpInspectInflatePut(z_stream *);
+void HttpInspectInflateFree(void);
+
 static inline void ResetGzipState(DECOMPRESS_STATE *ds)
 {
     if (ds == NULL)
         return;
 
-    inflateEnd(&(ds->d_stream));
+    if (ds->d_stream != NULL)
+    {
+        HttpInspectInflatePut(ds->d_stream);
+        ds->d_stream = NULL;
+    }
 
-    ds->inflate_init = 0;
+    ds->raw_deflate = 0;
     ds->compr_bytes_read = 0;
     ds->decompr_bytes_read = 0;
     ds->compress_fmt = 0;
@@ -296,6 +343,7 @@ static inline void ResetRespState(HTTP_RESP_STATE *ds)
     ds->chunk_remainder = 0;
     ds->data_extracted = 0;
     ds->max_seq = 0;
+    memset(&ds->js_resume, 0, sizeof(ds->js_resume));
 }
 
 static inline int SetLogBuffers(HttpSessionData *hsd)
@@ -307,7 +355,7 @@ static inline int SetLogBuffers(HttpSessionData *hsd)
 
         if (bkt != NULL)
         {
-            hsd->log_state = (HTTP_LOG_STATE *)calloc(1, sizeof(HTTP_LOG_STATE));
+            hsd->log_state = (HTTP_LOG_STATE *)HttpSessionMemAlloc(&hi_log_state_pool);
             if( hsd->log_state != NULL )
             {
                 hsd->log_state->log_bucket = bkt;
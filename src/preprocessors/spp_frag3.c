@@ -158,6 +158,11 @@ extern OptTreeNode *otn_tmp;
 /* max frags in a single frag tracker */
 #define DEFAULT_MAX_FRAGS   8192
 
+/* offset index for long fraglists, one slot per 1K of datagram */
+#define FRAG_INDEX_MIN      16
+#define FRAG_INDEX_SHIFT    10
+#define FRAG_INDEX_SLOTS    ((IP_MAXPACKET >> FRAG_INDEX_SHIFT) + 1)
+
 /* return values for CheckTimeout() */
 #define FRAG_TIME_OK            0
 #define FRAG_TIMEOUT            1
@@ -265,6 +270,7 @@ typedef struct _Frag3Config
     uint32_t   static_frags;         /* static frag nodes to keep around */
     uint8_t    use_prealloc;         /* flag to indicate prealloc nodes in use */
     uint8_t    use_prealloc_frags;   /* flag to indicate prealloc nodes in use */
+    uint8_t    prealloc_trackers;    /* allocate max_frags trackers at startup */
     Frag3Context *default_context;
     Frag3Context **frag3ContextList;  /* List of Frag3 Contexts configured */
     uint8_t numFrag3Contexts;
@@ -300,6 +306,9 @@ typedef struct _FragTracker
     Frag3Frag *fraglist;      /* list of fragments */
     Frag3Frag *fraglist_tail; /* tail ptr for easy appending */
     int fraglist_count;       /* handy dandy counter */
+    Frag3Frag **frag_index;   /* first frag per index slot, NULL until
+                                * the list reaches FRAG_INDEX_MIN nodes
+                                */
 
     uint32_t alert_gid[MAX_FRAG_ALERTS]; /* flag alerts seen in a frag list  */
     uint32_t alert_sid[MAX_FRAG_ALERTS]; /* flag alerts seen in a frag list  */
@@ -435,6 +444,8 @@ static int Frag3UserFree(void *, void *);
 /* fraglist handler funcs */
 static inline void Frag3FraglistAddNode(FragTracker *, Frag3Frag *, Frag3Frag *);
 static inline void Frag3FraglistDeleteNode(FragTracker *, Frag3Frag *);
+static void Frag3IndexBuild(FragTracker *);
+static Frag3Frag *Frag3IndexFindLeft(FragTracker *, uint16_t);
 
 /* prealloc queue handler funcs */
 static inline Frag3Frag *Frag3PreallocPop();
@@ -561,6 +572,8 @@ static void Frag3PrintGlobalConfig(Frag3Config *gconfig)
         LogMessage("      Frag3: INACTIVE\n");
     }
     LogMessage("    Max frags: %d\n", gconfig->max_frags);
+    if(gconfig->prealloc_trackers)
+        LogMessage("    Preallocated trackers: %d\n", gconfig->max_frags);
     if(!gconfig->use_prealloc)
         LogMessage("    Fragment memory cap: %lu bytes\n",
                 gconfig->memcap);
@@ -1169,6 +1182,15 @@ static void Frag3GlobalInit(char *args)
         }
 
         sfxhash_set_keyops(f_cache, Frag3KeyHashFunc, Frag3KeyCmpFunc);
+
+        /* under a fragment flood new datagrams then just pop a tracker
+         * off the free list instead of going to the allocator */
+        if (pCurrentPolicyConfig->prealloc_trackers)
+        {
+            int n = sfxhash_prealloc(f_cache, pCurrentPolicyConfig->max_frags);
+
+            LogMessage("Frag3: preallocated %d trackers\n", n);
+        }
     }
 
     /* display the global config for the user */
@@ -1530,6 +1552,10 @@ static void Frag3ParseGlobalArgs(Frag3Config *gconfig, char *args)
                            file_line);
             }
         }
+        else if(!strcasecmp(stoks[0], "prealloc_trackers"))
+        {
+            gconfig->prealloc_trackers = 1;
+        }
         else if(!strcasecmp(stoks[0], "disabled"))
         {
             gconfig->disabled = 1;
@@ -2408,11 +2434,13 @@ static int Frag3HandleIPOptions(FragTracker *ft,
         }
         else
         {
+            const Options *ipo = GetIpOptions(p);
+
             ft->copied_ip_option_count = p->ip_option_count;
             for (i = 0;i< p->ip_option_count && i < IP_OPTMAX; i++)
             {
                 /* Is the high bit set?  If not, weird anomaly. */
-                if (!(p->ip_options[i].code & 0x80))
+                if (!(ipo[i].code & 0x80))
                     EventAnomIpOpts(ft->context);
             }
         }
@@ -2619,6 +2647,7 @@ static int Frag3NewTracker(Packet *p, FRAGKEY *fkey, Frag3Context *f3context)
 
     /* initialize the fragment list */
     tmp->fraglist = NULL;
+    tmp->frag_index = NULL;
 
     /*
      * setup the Frag3Frag struct with the current packet's data
@@ -3261,24 +3290,51 @@ static int Frag3Insert(Packet *p, FragTracker *ft, FRAGKEY *fkey,
 
     /*
      * Need to figure out where in the frag list this frag should go
-     * and who its neighbors are
+     * and who its neighbors are.  The list is sorted by offset so
+     * fragments that go after the tail or before the head, ie all
+     * in order and reverse order traffic, don't need the walk.  Long
+     * lists get an offset index so overlap floods don't walk either.
      */
-    for(idx = ft->fraglist; idx; idx = idx->next)
+    if(ft->fraglist_tail && (ft->fraglist_tail->offset < frag_offset))
     {
-        i++;
-        right = idx;
-
-        DEBUG_WRAP(DebugMessage(DEBUG_FRAG,
-                    "%d right o %d s %d ptr %p prv %p nxt %p\n",
-                    i, right->offset, right->size, right,
-                    right->prev, right->next););
+        left = ft->fraglist_tail;
+        i = ft->fraglist_count;
+    }
+    else if(ft->fraglist && (ft->fraglist->offset >= frag_offset))
+    {
+        idx = right = ft->fraglist;
+        i = 1;
+    }
+    else
+    {
+        if(!ft->frag_index && (ft->fraglist_count >= FRAG_INDEX_MIN))
+            Frag3IndexBuild(ft);
 
-        if(right->offset >= frag_offset)
+        if(ft->frag_index)
         {
-            break;
+            left = Frag3IndexFindLeft(ft, frag_offset);
+            idx = right = left ? left->next : ft->fraglist;
         }
+        else
+        {
+            for(idx = ft->fraglist; idx; idx = idx->next)
+            {
+                i++;
+                right = idx;
 
-        left = right;
+                DEBUG_WRAP(DebugMessage(DEBUG_FRAG,
+                            "%d right o %d s %d ptr %p prv %p nxt %p\n",
+                            i, right->offset, right->size, right,
+                            right->prev, right->next););
+
+                if(right->offset >= frag_offset)
+                {
+                    break;
+                }
+
+                left = right;
+            }
+        }
     }
 
     /*
@@ -4146,6 +4202,15 @@ static void Frag3DeleteTracker(FragTracker *ft)
         Frag3DeleteFrag(dump_me);
     }
     ft->fraglist = NULL;
+    ft->fraglist_tail = NULL;
+    ft->fraglist_count = 0;
+    if (ft->frag_index)
+    {
+        free(ft->frag_index);
+        ft->frag_index = NULL;
+        mem_in_use -= FRAG_INDEX_SLOTS * sizeof(Frag3Frag *);
+        sfBase.frag3_mem_in_use = mem_in_use;
+    }
     if (ft->ip_options_data)
     {
         free(ft->ip_options_data);
@@ -4661,6 +4726,14 @@ static inline void Frag3FraglistAddNode(FragTracker *ft, Frag3Frag *prev,
         ft->fraglist = node;
     }
 
+    if(ft->frag_index)
+    {
+        Frag3Frag **slot = &ft->frag_index[node->offset >> FRAG_INDEX_SHIFT];
+
+        if(!*slot || ((*slot)->offset > node->offset))
+            *slot = node;
+    }
+
     ft->fraglist_count++;
     return;
 }
@@ -4696,10 +4769,103 @@ static inline void Frag3FraglistDeleteNode(FragTracker *ft, Frag3Frag *node)
         ft->fraglist_tail = node->prev;
     }
 
+    if(ft->frag_index)
+    {
+        int i;
+
+        /*
+         * trimming moves offsets after a node is indexed, so check
+         * every slot rather than trust the node's current one
+         */
+        for(i = 0; i < FRAG_INDEX_SLOTS; i++)
+        {
+            if(ft->frag_index[i] != node)
+                continue;
+
+            if(node->next && ((node->next->offset >> FRAG_INDEX_SHIFT) == i))
+                ft->frag_index[i] = node->next;
+            else
+                ft->frag_index[i] = NULL;
+        }
+    }
+
     Frag3DeleteFrag(node);
     ft->fraglist_count--;
 }
 
+/**
+ * Build the offset index of a FragTracker from its fraglist
+ *
+ * Each slot points at the lowest offset fragment that starts in that
+ * 1K of the datagram, so a lookup walks at most one slot's worth of
+ * fragments no matter how long the list gets.
+ *
+ * @param ft FragTracker to index
+ *
+ * @return none
+ */
+static void Frag3IndexBuild(FragTracker *ft)
+{
+    Frag3Frag *idx;
+
+    ft->frag_index = (Frag3Frag **)
+        SnortAlloc(FRAG_INDEX_SLOTS * sizeof(Frag3Frag *));
+    mem_in_use += FRAG_INDEX_SLOTS * sizeof(Frag3Frag *);
+    sfBase.frag3_mem_in_use = mem_in_use;
+
+    for(idx = ft->fraglist; idx; idx = idx->next)
+    {
+        Frag3Frag **slot = &ft->frag_index[idx->offset >> FRAG_INDEX_SHIFT];
+
+        if(!*slot)
+            *slot = idx;
+    }
+
+    DEBUG_WRAP(DebugMessage(DEBUG_FRAG,
+                "Indexed fraglist of %d nodes\n", ft->fraglist_count););
+}
+
+/**
+ * Find the fragment a new fragment goes after, using the offset index
+ *
+ * Any fragment below the new offset is a valid place to start because
+ * the fraglist is sorted, so stale or empty slots only cost a longer walk.
+ *
+ * @param ft FragTracker with a frag_index
+ * @param offset offset of the new fragment
+ *
+ * @return the last fragment with a lower offset, NULL if there is none
+ */
+static Frag3Frag *Frag3IndexFindLeft(FragTracker *ft, uint16_t offset)
+{
+    Frag3Frag *left = NULL;
+    int i;
+
+    for(i = offset >> FRAG_INDEX_SHIFT; i >= 0; i--)
+    {
+        left = ft->frag_index[i];
+
+        if(left && (left->offset < offset))
+            break;
+
+        left = NULL;
+    }
+
+    /* a trimmed fragment can slide out of its slot, so fall back to the head */
+    if(!left)
+    {
+        if(!ft->fraglist || (ft->fraglist->offset >= offset))
+            return NULL;
+
+        left = ft->fraglist;
+    }
+
+    while(left->next && (left->next->offset < offset))
+        left = left->next;
+
+    return left;
+}
+
 /*
 **
 **  NAME
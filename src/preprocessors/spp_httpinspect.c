@@ -297,7 +297,18 @@ static void HttpInspectDropStats(int exiting)
     LogMessage("    Gzip Compressed Data Processed:       %-10.2f\n", (double)hi_stats.compr_bytes_read);
     LogMessage("    Gzip Decompressed Data Processed:     %-10.2f\n", (double)hi_stats.decompr_bytes_read);
     }
+    LogMessage("    Gzip Inflate Contexts Reused:         %-10I64u\n", hi_stats.inflate_reused);
 #endif
+    LogMessage("    Sessions freed:                       %-10I64u\n", hi_stats.sessions_freed);
+    if (hi_stats.sessions_freed == 0)
+    LogMessage("    Avg memory per session:               %-10s\n", "n/a");
+    else
+    LogMessage("    Avg memory per session:               %-10.2f\n", (double)hi_stats.session_mem_freed / (double)hi_stats.sessions_freed);
+    LogMessage("    Max memory per session:               %-10I64u\n", hi_stats.session_mem_max);
+    LogMessage("    Session memory in use:                %-10I64u\n", hi_session_mem.in_use);
+    LogMessage("    Session memory peak:                  %-10I64u\n", hi_session_mem.peak);
+    LogMessage("    Session memory reserved:              %-10I64u\n", hi_session_mem.reserved);
+    LogMessage("    Session memcap drops:                 %-10I64u\n", hi_stats.session_memcap_drops);
     LogMessage("    Total packets processed:              %-10I64u\n", hi_stats.total);
 #else
     LogMessage("    POST methods:                         "FMTu64("-10")"\n", hi_stats.post);
@@ -349,7 +360,18 @@ static void HttpInspectDropStats(int exiting)
     LogMessage("    Gzip Compressed Data Processed:       %-10.2f\n", (double)hi_stats.compr_bytes_read);
     LogMessage("    Gzip Decompressed Data Processed:     %-10.2f\n", (double)hi_stats.decompr_bytes_read);
     }
+    LogMessage("    Gzip Inflate Contexts Reused:         "FMTu64("-10")"\n", hi_stats.inflate_reused);
 #endif
+    LogMessage("    Sessions freed:                       "FMTu64("-10")"\n", hi_stats.sessions_freed);
+    if (hi_stats.sessions_freed == 0)
+    LogMessage("    Avg memory per session:               %-10s\n", "n/a");
+    else
+    LogMessage("    Avg memory per session:               %-10.2f\n", (double)hi_stats.session_mem_freed / (double)hi_stats.sessions_freed);
+    LogMessage("    Max memory per session:               "FMTu64("-10")"\n", hi_stats.session_mem_max);
+    LogMessage("    Session memory in use:                "FMTu64("-10")"\n", hi_session_mem.in_use);
+    LogMessage("    Session memory peak:                  "FMTu64("-10")"\n", hi_session_mem.peak);
+    LogMessage("    Session memory reserved:              "FMTu64("-10")"\n", hi_session_mem.reserved);
+    LogMessage("    Session memcap drops:                 "FMTu64("-10")"\n", hi_stats.session_memcap_drops);
     LogMessage("    Total packets processed:              "FMTu64("-10")"\n", hi_stats.total);
 #endif
 }
@@ -368,6 +390,7 @@ static void HttpInspectCleanExit(int signal, void *data)
         free(hi_gzip_mempool);
         hi_gzip_mempool = NULL;
     }
+    HttpInspectInflateFree();
 #endif
 
     if (mempool_destroy(http_mempool) == 0)
@@ -375,6 +398,8 @@ static void HttpInspectCleanExit(int signal, void *data)
         free(http_mempool);
         http_mempool = NULL;
     }
+
+    HttpSessionMemDestroy();
 }
 
 static void HttpInspectReset(int signal, void *data)
@@ -464,10 +489,16 @@ static void CheckMemcap(HTTPINSPECT_GLOBAL_CONF *pPolicyConfig,
                     "configured in the default policy.\n");
         }
 
+        if (pPolicyConfig->session_memcap)
+        {
+            FatalError("http_inspect: session_memcap must be "
+                    "configured in the default policy.\n");
+        }
     }
     else
     {
         pPolicyConfig->memcap = defaultConfig->memcap;
+        pPolicyConfig->session_memcap = defaultConfig->session_memcap;
     }
 }
 
@@ -1158,6 +1189,8 @@ static void HttpInspectCheckConfig(void)
 
     defaultConfig = (HTTPINSPECT_GLOBAL_CONF *)sfPolicyUserDataGetDefault(hi_config);
 
+    if (defaultConfig != NULL)
+        hi_session_mem.memcap = defaultConfig->session_memcap;
 
 #ifdef ZLIB
     {
@@ -1513,6 +1546,7 @@ static int HttpInspectReloadVerify(void)
 static void * HttpInspectReloadSwap(void)
 {
     tSfPolicyUserContextId old_config = hi_config;
+    HTTPINSPECT_GLOBAL_CONF *defaultConfig;
 
     if (hi_swap_config == NULL)
         return NULL;
@@ -1520,6 +1554,11 @@ static void * HttpInspectReloadSwap(void)
     hi_config = hi_swap_config;
     hi_swap_config = NULL;
 
+    /* the session memcap only gates new allocations so it can change
+     * without a restart; sessions already over it just keep what they have */
+    defaultConfig = (HTTPINSPECT_GLOBAL_CONF *)sfPolicyUserDataGetDefault(hi_config);
+    hi_session_mem.memcap = defaultConfig ? defaultConfig->session_memcap : 0;
+
     return (void *)old_config;
 }
 
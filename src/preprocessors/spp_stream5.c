@@ -521,6 +521,9 @@ static void Stream5GlobalInit(char *args)
     pCurrentPolicyConfig->global_config->max_ip_sessions = S5_DEFAULT_MAX_IP_SESSIONS;
     pCurrentPolicyConfig->global_config->memcap = S5_DEFAULT_MEMCAP;
     pCurrentPolicyConfig->global_config->prune_log_max = S5_DEFAULT_PRUNE_LOG_MAX;
+    pCurrentPolicyConfig->global_config->pressure_elevated = S5_DEFAULT_PRESSURE_ELEVATED;
+    pCurrentPolicyConfig->global_config->pressure_high = S5_DEFAULT_PRESSURE_HIGH;
+    pCurrentPolicyConfig->global_config->snapshot_max_bytes = S5_DEFAULT_SNAPSHOT_MAX_BYTES;
 #ifdef ACTIVE_RESPONSE
     pCurrentPolicyConfig->global_config->max_active_responses =
         S5_DEFAULT_MAX_ACTIVE_RESPONSES;
@@ -552,6 +555,23 @@ static void Stream5GlobalInit(char *args)
             pDefaultPolicyConfig->global_config->max_ip_sessions;
         pCurrentPolicyConfig->global_config->memcap =
             pDefaultPolicyConfig->global_config->memcap;
+        pCurrentPolicyConfig->global_config->flow_budget =
+            pDefaultPolicyConfig->global_config->flow_budget;
+        pCurrentPolicyConfig->global_config->pressure_elevated =
+            pDefaultPolicyConfig->global_config->pressure_elevated;
+        pCurrentPolicyConfig->global_config->pressure_high =
+            pDefaultPolicyConfig->global_config->pressure_high;
+        pCurrentPolicyConfig->global_config->flags &= ~STREAM5_CONFIG_MEMCAP_GRADED;
+        pCurrentPolicyConfig->global_config->flags |=
+            (pDefaultPolicyConfig->global_config->flags & STREAM5_CONFIG_MEMCAP_GRADED);
+
+        /* the session table is shared so only the default policy saves it */
+        if (pCurrentPolicyConfig->global_config->snapshot_file != NULL)
+        {
+            FatalError("%s(%d) ==> Stream5 'snapshot' can only be "
+                       "configured in the default policy\n",
+                       file_name, file_line);
+        }
     }
 
     Stream5PrintGlobalConfig(pCurrentPolicyConfig->global_config);
@@ -802,6 +822,91 @@ static void Stream5ParseGlobalArgs(Stream5GlobalConfig *config, char *args)
         {
             config->flags |= STREAM5_CONFIG_SHOW_PACKETS;
         }
+        else if(!strcasecmp(stoks[0], "memcap_policy"))
+        {
+            if (stoks[1] && !strcasecmp(stoks[1], "graded"))
+                config->flags |= STREAM5_CONFIG_MEMCAP_GRADED;
+            else if (stoks[1] && !strcasecmp(stoks[1], "lru"))
+                config->flags &= ~STREAM5_CONFIG_MEMCAP_GRADED;
+            else
+            {
+                FatalError("%s(%d) => 'memcap_policy' requires 'graded' or 'lru'\n",
+                           file_name, file_line);
+            }
+        }
+        else if(!strcasecmp(stoks[0], "memcap_pressure"))
+        {
+            unsigned long elevated = 0, high = 0;
+
+            if (stoks[1])
+                elevated = strtoul(stoks[1], &endPtr, 10);
+
+            if (!stoks[1] || (endPtr == &stoks[1][0]))
+            {
+                FatalError("%s(%d) => Invalid memcap_pressure in config file.  "
+                           "Requires two integer parameters.\n",
+                           file_name, file_line);
+            }
+
+            if (stoks[2])
+                high = strtoul(stoks[2], &endPtr, 10);
+
+            if (!stoks[2] || (endPtr == &stoks[2][0]))
+            {
+                FatalError("%s(%d) => Invalid memcap_pressure in config file.  "
+                           "Requires two integer parameters.\n",
+                           file_name, file_line);
+            }
+
+            if ((elevated == 0) || (elevated >= high) || (high > 100))
+            {
+                FatalError("%s(%d) => 'memcap_pressure %s %s' invalid: values "
+                           "are percent of memcap and must satisfy "
+                           "0 < elevated < high <= 100\n",
+                           file_name, file_line, stoks[1], stoks[2]);
+            }
+            config->pressure_elevated = (uint8_t)elevated;
+            config->pressure_high = (uint8_t)high;
+        }
+        else if(!strcasecmp(stoks[0], "flow_budget"))
+        {
+            if (stoks[1])
+            {
+                config->flow_budget = strtoul(stoks[1], &endPtr, 10);
+            }
+
+            if (!stoks[1] || (endPtr == &stoks[1][0]))
+            {
+                FatalError("%s(%d) => Invalid flow_budget in config file.  Requires integer parameter.\n",
+                           file_name, file_line);
+            }
+        }
+        else if(!strcasecmp(stoks[0], "snapshot"))
+        {
+            if (!stoks[1] || (s_toks > 2))
+            {
+                FatalError("%s(%d) => 'snapshot' requires a file name\n",
+                           file_name, file_line);
+            }
+
+            if (config->snapshot_file != NULL)
+                free(config->snapshot_file);
+
+            config->snapshot_file = SnortStrdup(stoks[1]);
+        }
+        else if(!strcasecmp(stoks[0], "snapshot_max_bytes"))
+        {
+            if (stoks[1])
+            {
+                config->snapshot_max_bytes = strtoul(stoks[1], &endPtr, 10);
+            }
+
+            if (!stoks[1] || (endPtr == &stoks[1][0]))
+            {
+                FatalError("%s(%d) => Invalid snapshot_max_bytes in config file.  Requires integer parameter.\n",
+                           file_name, file_line);
+            }
+        }
         else if(!strcasecmp(stoks[0], "prune_log_max"))
         {
             if (stoks[1])
@@ -908,6 +1013,18 @@ static void Stream5PrintGlobalConfig(Stream5GlobalConfig *config)
             config->max_tcp_sessions);
     LogMessage("    Memcap (for reassembly packet storage): %d\n",
         config->memcap);
+    if (config->flags & STREAM5_CONFIG_MEMCAP_GRADED)
+    {
+        LogMessage("    Memcap policy: GRADED (elevated %u%%, high %u%%)\n",
+            config->pressure_elevated, config->pressure_high);
+        LogMessage("    Per flow budget under pressure: %u\n",
+            config->flow_budget ? config->flow_budget :
+            config->memcap / S5_DEFAULT_FLOW_BUDGET_DIV);
+    }
+    else
+    {
+        LogMessage("    Memcap policy: LRU\n");
+    }
     LogMessage("    Track UDP sessions: %s\n",
         config->track_udp_sessions == S5_TRACK_YES ?
         "ACTIVE" : "INACTIVE");
@@ -931,6 +1048,11 @@ static void Stream5PrintGlobalConfig(Stream5GlobalConfig *config)
         LogMessage("    Log info if session memory consumption exceeds %d\n",
             config->prune_log_max);
     }
+    if (config->snapshot_file)
+    {
+        LogMessage("    TCP session snapshot: %s (max %u queued bytes)\n",
+            config->snapshot_file, config->snapshot_max_bytes);
+    }
 #ifdef ACTIVE_RESPONSE
     LogMessage("    Send up to %d active responses\n",
         config->max_active_responses);
@@ -1134,6 +1256,9 @@ static void Stream5CleanExit(int signal, void *foo)
     s5stats.icmp_prunes = Stream5GetIcmpPrunes();
     s5stats.ip_prunes = Stream5GetIpPrunes();
 
+    /* Save the tcp sessions before they are flushed and deleted */
+    Stream5SaveTcp();
+
     /* Clean up the hash tables for these */
     Stream5CleanTcp();
     Stream5CleanUdp();
@@ -1339,6 +1464,9 @@ static void Stream5VerifyConfig(void)
 #ifdef TARGET_BASED
     s5InitServiceFilterStatus();
 #endif
+
+    /* Everything sessions depend on is set up now */
+    Stream5RestoreTcp();
 }
 
 static void Stream5PrintStats(int exiting)
@@ -1370,6 +1498,8 @@ static void Stream5PrintStats(int exiting)
     LogMessage("         TCP Segments Used: %u\n", s5stats.tcp_rebuilt_seqs_used);
     LogMessage("              TCP Discards: %u\n", s5stats.tcp_discards);
     LogMessage("                  TCP Gaps: %u\n", s5stats.tcp_gaps);
+    LogMessage("       TCP Prediction Hits: " STDu64 "\n", s5stats.tcp_pred_hits);
+    LogMessage("     TCP Prediction Misses: " STDu64 "\n", s5stats.tcp_pred_misses);
     LogMessage("      UDP Sessions Created: %u\n",
             s5stats.udp_sessions_created);
     LogMessage("      UDP Sessions Deleted: %u\n",
@@ -1378,6 +1508,30 @@ static void Stream5PrintStats(int exiting)
     LogMessage("              UDP Discards: %u\n", s5stats.udp_discards);
     LogMessage("                    Events: %u\n", s5stats.events);
     LogMessage("           Internal Events: %u\n", s5stats.internalEvents);
+    if ( s5stats.tcp_reclaim_flushed || s5stats.tcp_reclaim_budget ||
+         s5stats.tcp_reclaim_evict )
+    {
+        LogMessage("       TCP Memcap Reclamation\n");
+        LogMessage("             Flushed Bytes: " STDu64 "\n", s5stats.tcp_reclaim_flushed);
+        LogMessage("              Budget Bytes: " STDu64 "\n", s5stats.tcp_reclaim_budget);
+        LogMessage("             Evicted Bytes: " STDu64 "\n", s5stats.tcp_reclaim_evict);
+        LogMessage("      Evicted (no pending): %u\n", s5stats.tcp_evict_no_pending);
+        LogMessage("          Evicted (no PAF): %u\n", s5stats.tcp_evict_no_paf);
+        LogMessage("             Evicted (LRU): %u\n", s5stats.tcp_evict_lru);
+    }
+    if ( s5stats.tcp_snapshot_saved || s5stats.tcp_snapshot_restored )
+    {
+        LogMessage("       TCP Session Snapshot\n");
+        LogMessage("                     Saved: %u\n", s5stats.tcp_snapshot_saved);
+        LogMessage("                  Restored: %u\n", s5stats.tcp_snapshot_restored);
+        LogMessage("         Segments Restored: %u\n", s5stats.tcp_snapshot_segs);
+    }
+    if ( s5stats.tcp_skips )
+    {
+        LogMessage("          TCP PDU Skipping\n");
+        LogMessage("                     Skips: %u\n", s5stats.tcp_skips);
+        LogMessage("             Skipped Bytes: " STDu64 "\n", s5stats.tcp_skip_bytes);
+    }
     LogMessage("           TCP Port Filter\n");
     LogMessage("                   Dropped: %u\n", s5stats.tcp_port_filter.dropped);
     LogMessage("                 Inspected: %u\n", s5stats.tcp_port_filter.inspected);
@@ -1664,6 +1818,41 @@ static const StreamSessionKey *Stream5GetKeyFromSessionPtr(const void *ssnptr)
     return ssn->key;
 }
 
+/*
+ * Called for packets passed by the flow bypass cache, at most once a
+ * second per flow.  Those packets never reach stream5, so the session is
+ * moved to the front of the LRU and its timeout pushed out here; otherwise
+ * it looks idle and gets pruned or timed out while the flow is active.
+ */
+void Stream5TouchSession(Packet *p)
+{
+    Stream5SessionCache *cache;
+    Stream5LWSession *lwssn;
+    SessionKey key;
+
+    if (p->tcph)
+        cache = tcp_lws_cache;
+    else if (p->udph)
+        cache = udp_lws_cache;
+    else
+        return;
+
+    if (!cache || !GetLWSessionKey(p, &key))
+        return;
+
+    lwssn = GetLWSessionFromKey(cache, &key);
+
+    if (!lwssn || (lwssn->last_data_seen >= p->pkth->ts.tv_sec))
+        return;
+
+    if (lwssn->expire_time)
+    {
+        lwssn->expire_time +=
+            (uint64_t)(p->pkth->ts.tv_sec - lwssn->last_data_seen) * TCP_HZ;
+    }
+    lwssn->last_data_seen = p->pkth->ts.tv_sec;
+}
+
 static void Stream5CheckSessionClosed(Packet* p)
 {
     Stream5LWSession* ssn;
@@ -1927,6 +2116,17 @@ static void Stream5StopInspection(
     if (!ssn)
         return;
 
+    /* A byte count only skips the rest of the current PDU; the
+     * session is neither ignored nor is the packet disabled. */
+    if ((bytes > 0) && (ssn->protocol == IPPROTO_TCP))
+    {
+        if (Stream5SetRuntimeConfiguration(ssn, ssn->protocol) == -1)
+            return;
+
+        Stream5SkipTcp(ssn, dir, (uint32_t)bytes);
+        return;
+    }
+
     switch (dir)
     {
         case SSN_DIR_BOTH:
@@ -1957,7 +2157,7 @@ static void Stream5StopInspection(
         }
     }
 
-    /* TODO: Handle bytes/response parameters */
+    /* TODO: Handle response parameter */
 
     Stream5DisableInspection(ssn, p);
 }
@@ -2776,6 +2976,9 @@ static void Stream5GlobalReload(char *args)
     pCurrentPolicyConfig->global_config->max_ip_sessions = S5_DEFAULT_MAX_IP_SESSIONS;
     pCurrentPolicyConfig->global_config->memcap = S5_DEFAULT_MEMCAP;
     pCurrentPolicyConfig->global_config->prune_log_max = S5_DEFAULT_PRUNE_LOG_MAX;
+    pCurrentPolicyConfig->global_config->pressure_elevated = S5_DEFAULT_PRESSURE_ELEVATED;
+    pCurrentPolicyConfig->global_config->pressure_high = S5_DEFAULT_PRESSURE_HIGH;
+    pCurrentPolicyConfig->global_config->snapshot_max_bytes = S5_DEFAULT_SNAPSHOT_MAX_BYTES;
 #ifdef ACTIVE_RESPONSE
     pCurrentPolicyConfig->global_config->max_active_responses =
         S5_DEFAULT_MAX_ACTIVE_RESPONSES;
@@ -2807,6 +3010,23 @@ static void Stream5GlobalReload(char *args)
             pDefaultPolicyConfig->global_config->max_ip_sessions;
         pCurrentPolicyConfig->global_config->memcap =
             pDefaultPolicyConfig->global_config->memcap;
+        pCurrentPolicyConfig->global_config->flow_budget =
+            pDefaultPolicyConfig->global_config->flow_budget;
+        pCurrentPolicyConfig->global_config->pressure_elevated =
+            pDefaultPolicyConfig->global_config->pressure_elevated;
+        pCurrentPolicyConfig->global_config->pressure_high =
+            pDefaultPolicyConfig->global_config->pressure_high;
+        pCurrentPolicyConfig->global_config->flags &= ~STREAM5_CONFIG_MEMCAP_GRADED;
+        pCurrentPolicyConfig->global_config->flags |=
+            (pDefaultPolicyConfig->global_config->flags & STREAM5_CONFIG_MEMCAP_GRADED);
+
+        /* the session table is shared so only the default policy saves it */
+        if (pCurrentPolicyConfig->global_config->snapshot_file != NULL)
+        {
+            FatalError("%s(%d) ==> Stream5 'snapshot' can only be "
+                       "configured in the default policy\n",
+                       file_name, file_line);
+        }
     }
 
     Stream5PrintGlobalConfig(pCurrentPolicyConfig->global_config);
@@ -28,5 +28,6 @@
 
 /* list of function prototypes for this preprocessor */
 void SetupStream5(void);
+void Stream5TouchSession(Packet *);
 
 #endif  /* __SPP_STREAM5_H__ */
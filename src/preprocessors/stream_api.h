@@ -220,6 +220,11 @@ typedef struct _stream_api
      *
      * Also marks the packet to be ignored
      *
+     * For TCP with protocol aware flushing, a positive count instead
+     * purges up to count bytes of the current PDU without reassembly,
+     * stopping at the next PAF flush or skip point where reassembly
+     * resumes.  The session and packet are not otherwise affected.
+     *
      * Parameters
      *     Session Ptr
      *     Packet
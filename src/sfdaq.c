@@ -30,6 +30,8 @@
 #endif
 
 #include "sfdaq.h"
+#include "sfdaq_pcap_mmap.h"
+#include "sfdaq_tpacket.h"
 #include "snort.h"
 #include "util.h"
 #include "sfutil/strvec.h"
@@ -61,7 +63,25 @@ static int loaded = 0;
 static int s_error = DAQ_SUCCESS;
 static DAQ_Stats_t daq_stats, tot_stats;
 
+typedef struct
+{
+    DAQ_PktHdr_t hdr[DAQ_BURST_MAX];
+    const DAQ_PktHdr_t* hdrs[DAQ_BURST_MAX];
+    const uint8_t* pkts[DAQ_BURST_MAX];
+    DAQ_Verdict verdicts[DAQ_BURST_MAX];
+    uint8_t* data;          // size * snap bytes of frame copies
+    unsigned size;
+    unsigned count;
+} DAQ_Burst;
+
+static DAQ_Burst* burst = NULL;
+static DAQ_Burst_Func_t burst_func = NULL;
+static void* burst_user = NULL;
+
 static void DAQ_Accumulate(void);
+static const DAQ_Module_t* DAQ_FindModule(const char*);
+static void DAQ_BurstNew(const SnortConfig*);
+static void DAQ_BurstDelete(void);
 
 //--------------------------------------------------------------------
 
@@ -85,38 +105,80 @@ void DAQ_Unload ()
 
 //--------------------------------------------------------------------
 
-int DAQ_PrintTypes (FILE* f)
+typedef struct
 {
-    DAQ_Module_Info_t* list = NULL;
-    int i, nMods = daq_get_module_list(&list);
+    const DAQ_Module_t* (*get)(void);
+    uint32_t version;
+} DAQ_Builtin;
 
-    if ( nMods )
-        fprintf(f, "Available DAQ modules:\n");
-    else
-        fprintf(f, "No available DAQ modules "
-            "(try adding directories with --daq-dir).\n");
+static const DAQ_Builtin builtins[] =
+{
+    { PCAP_MMAP_DAQ_GetModule, PCAP_MMAP_DAQ_VERSION },
+    { TPACKET_DAQ_GetModule, TPACKET_DAQ_VERSION },
+};
 
-    for ( i = 0; i < nMods; i++ )
+#define NUM_BUILTINS (sizeof(builtins) / sizeof(builtins[0]))
+
+// built-in modules are found before the loaded ones
+static const DAQ_Module_t* DAQ_FindModule (const char* type)
+{
+    unsigned i;
+
+    for ( i = 0; i < NUM_BUILTINS; i++ )
     {
-        fprintf(f, "%s(v%u):", list[i].name, list[i].version);
+        const DAQ_Module_t* mod = builtins[i].get();
+
+        if ( mod && !strcasecmp(type, daq_get_name(mod)) )
+            return mod;
+    }
+    return daq_find_module(type);
+}
+
+static void DAQ_PrintType (
+    FILE* f, const char* name, uint32_t version, uint32_t type)
+{
+    fprintf(f, "%s(v%u):", name, version);
 
-        if ( list[i].type & DAQ_TYPE_FILE_CAPABLE )
-            fprintf(f, " %s", "readback");
+    if ( type & DAQ_TYPE_FILE_CAPABLE )
+        fprintf(f, " %s", "readback");
+
+    if ( type & DAQ_TYPE_INTF_CAPABLE )
+        fprintf(f, " %s", "live");
+
+    if ( type & DAQ_TYPE_INLINE_CAPABLE )
+        fprintf(f, " %s", "inline");
+
+    if ( type & DAQ_TYPE_MULTI_INSTANCE )
+        fprintf(f, " %s", "multi");
+
+    if ( !(type & DAQ_TYPE_NO_UNPRIV) )
+        fprintf(f, " %s", "unpriv");
+
+    fprintf(f, "\n");
+}
 
-        if ( list[i].type & DAQ_TYPE_INTF_CAPABLE )
-            fprintf(f, " %s", "live");
+int DAQ_PrintTypes (FILE* f)
+{
+    DAQ_Module_Info_t* list = NULL;
+    int i, nMods = daq_get_module_list(&list);
+    unsigned j;
 
-        if ( list[i].type & DAQ_TYPE_INLINE_CAPABLE )
-            fprintf(f, " %s", "inline");
+    fprintf(f, "Available DAQ modules:\n");
 
-        if ( list[i].type & DAQ_TYPE_MULTI_INSTANCE )
-            fprintf(f, " %s", "multi");
+    for ( i = 0; i < nMods; i++ )
+        DAQ_PrintType(f, list[i].name, list[i].version, list[i].type);
 
-        if ( !(list[i].type & DAQ_TYPE_NO_UNPRIV) )
-            fprintf(f, " %s", "unpriv");
+    for ( j = 0; j < NUM_BUILTINS; j++ )
+    {
+        const DAQ_Module_t* mod = builtins[j].get();
 
-        fprintf(f, "\n");
+        if ( mod )
+            DAQ_PrintType(f, daq_get_name(mod), builtins[j].version, daq_get_type(mod));
     }
+    if ( !nMods )
+        fprintf(f, "No loadable DAQ modules "
+            "(try adding directories with --daq-dir).\n");
+
     daq_free_module_list(list, nMods);
     return 0;
 }
@@ -247,7 +309,7 @@ void DAQ_Init (const SnortConfig* sc)
 
     if ( sc->daq_type ) type = sc->daq_type;
 
-    daq_mod = daq_find_module(type);
+    daq_mod = DAQ_FindModule(type);
 
     if ( !daq_mod )
         FatalError("Can't find %s DAQ!\n", type);
@@ -465,6 +527,8 @@ int DAQ_New (const SnortConfig* sc, const char* intf)
     DAQ_SetFilter(sc->bpf_filter);
     daq_config_clear_values(&cfg);
 
+    DAQ_BurstNew(sc);
+
     return 0;
 }
 
@@ -476,6 +540,8 @@ int DAQ_Delete(void)
         daq_shutdown(daq_mod, daq_hand);
         daq_hand = NULL;
     }
+    DAQ_BurstDelete();
+
     if ( interface_spec )
     {
         free(interface_spec);
@@ -553,6 +619,129 @@ int DAQ_Acquire (int max, DAQ_Analysis_Func_t callback, uint8_t* user)
     return err;
 }
 
+//--------------------------------------------------------------------
+// burst shim
+//--------------------------------------------------------------------
+
+static void DAQ_BurstNew (const SnortConfig* sc)
+{
+    unsigned i;
+
+    if ( daq_mode == DAQ_MODE_INLINE || sc->daq_burst < 2 )
+        return;
+
+    burst = (DAQ_Burst*)SnortAlloc(sizeof(*burst));
+    burst->size = sc->daq_burst;
+    burst->data = (uint8_t*)SnortAlloc(burst->size * snap);
+
+    for ( i = 0; i < burst->size; i++ )
+    {
+        burst->hdrs[i] = burst->hdr + i;
+        burst->pkts[i] = burst->data + i * snap;
+    }
+    LogMessage("DAQ burst size: %u frames\n", burst->size);
+}
+
+static void DAQ_BurstDelete (void)
+{
+    if ( !burst )
+        return;
+
+    free(burst->data);
+    free(burst);
+    burst = NULL;
+}
+
+static void DAQ_BurstFlush (void)
+{
+    unsigned n = burst->count;
+
+    if ( !n )
+        return;
+
+    burst->count = 0;
+    burst_func(burst_user, n, burst->hdrs, burst->pkts, burst->verdicts);
+}
+
+static DAQ_Verdict DAQ_BurstSingle (
+    void* user, const DAQ_PktHdr_t* h, const uint8_t* pkt)
+{
+    DAQ_Verdict verdict = DAQ_VERDICT_PASS;
+    burst_func(burst_user, 1, &h, &pkt, &verdict);
+    return verdict;
+}
+
+// the frame must be copied since the daq reuses its buffer once we
+// return; anything bigger than a slot is flushed and passed on as is
+static DAQ_Verdict DAQ_BurstCopy (
+    void* user, const DAQ_PktHdr_t* h, const uint8_t* pkt)
+{
+    unsigned i = burst->count;
+
+    if ( h->caplen > snap )
+    {
+        DAQ_BurstFlush();
+        return DAQ_BurstSingle(user, h, pkt);
+    }
+    burst->hdr[i] = *h;
+    memcpy((uint8_t*)burst->pkts[i], pkt, h->caplen);
+
+    if ( ++burst->count == burst->size )
+        DAQ_BurstFlush();
+
+    return DAQ_VERDICT_PASS;
+}
+
+#ifdef HAVE_DAQ_ACQUIRE_WITH_META
+// keep meta events in order with the frames around them
+static int DAQ_BurstMeta (
+    void* user, const DAQ_MetaHdr_t* hdr, const uint8_t* data)
+{
+    DAQ_BurstFlush();
+    return daq_meta_callback(user, hdr, data);
+}
+#endif
+
+unsigned DAQ_GetBurstSize (void)
+{
+    return burst ? burst->size : 1;
+}
+
+int DAQ_AcquireBurst (int max, DAQ_Burst_Func_t analyze, void* user)
+{
+    DAQ_Analysis_Func_t callback = burst ? DAQ_BurstCopy : DAQ_BurstSingle;
+    int err;
+
+    burst_func = analyze;
+    burst_user = user;
+
+#if HAVE_DAQ_ACQUIRE_WITH_META
+    err = daq_acquire_with_meta(daq_mod, daq_hand, max, callback,
+        (burst && daq_meta_callback) ? DAQ_BurstMeta : daq_meta_callback,
+        (uint8_t*)user);
+#else
+    err = daq_acquire(daq_mod, daq_hand, max, callback, (uint8_t*)user);
+#endif
+
+    // a partial burst is never held across calls so that pcap switches,
+    // packet counts, and idle processing see every acquired frame
+    if ( burst )
+        DAQ_BurstFlush();
+
+    if ( err && err != DAQ_READFILE_EOF )
+        LogMessage("Can't acquire (%d) - %s!\n",
+            err, daq_get_error(daq_mod, daq_hand));
+
+    if ( s_error != DAQ_SUCCESS )
+    {
+        err = s_error;
+        s_error = DAQ_SUCCESS;
+    }
+    return err;
+}
+
+//--------------------------------------------------------------------
+
 int DAQ_Inject(const DAQ_PktHdr_t* h, int rev, const uint8_t* buf, uint32_t len)
 {
     int err = daq_inject(daq_mod, daq_hand, (DAQ_PktHdr_t*)h, buf, len, rev);
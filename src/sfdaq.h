@@ -30,6 +30,7 @@
 #include <daq.h>
 
 #define PKT_TIMEOUT  1000  // ms, worst daq resolution is 1 sec
+#define DAQ_BURST_MAX  64   // max frames per burst callback
 
 struct _SnortConfig;
 
@@ -66,6 +67,21 @@ int DAQ_Stop(void);
 // TBD some stuff may be inlined once encapsulations are straight
 // (but only where performance justifies exposing implementation!)
 int DAQ_Acquire(int max, DAQ_Analysis_Func_t, uint8_t* user);
+
+// burst acquire hands the engine up to DAQ_GetBurstSize() frames at once
+// and takes back one verdict per frame.  daq modules only support per
+// packet callbacks so a shim collects the burst.  the verdict is needed
+// before the module moves on so bursts of more than one frame are only
+// built when verdicts don't matter (passive and read-file modes); those
+// frames are copied and their verdicts are ignored.  otherwise each frame
+// is delivered as a burst of one.
+typedef void (*DAQ_Burst_Func_t)(
+    void* user, unsigned n, const DAQ_PktHdr_t** hdrs,
+    const uint8_t** pkts, DAQ_Verdict* verdicts);
+
+int DAQ_AcquireBurst(int max, DAQ_Burst_Func_t, void* user);
+unsigned DAQ_GetBurstSize(void);
+
 int DAQ_Inject(const DAQ_PktHdr_t*, int rev, const uint8_t* buf, uint32_t len);
 int DAQ_BreakLoop(int error);
 #ifdef HAVE_DAQ_ACQUIRE_WITH_META
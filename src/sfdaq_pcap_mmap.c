@@ -0,0 +1,793 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    sfdaq_pcap_mmap.c
+//
+// the whole file is mapped private (so the engine may still modify
+// packets in place) and records are handed to the engine straight from
+// the mapping.  the kernel is told the access is sequential, upcoming
+// records are prefetched while the current one is processed, and the
+// pages behind the read position are dropped from the page cache so
+// very large captures don't push everything else out of memory.
+//
+// classic pcap (microsecond and nanosecond, either byte order) and
+// pcapng (enhanced, simple, and obsolete packet blocks) are supported.
+// all pcapng interfaces must have the same link type.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sfdaq_pcap_mmap.h"
+
+#ifndef WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <pcap.h>
+#include <daq_api.h>
+
+#define PM_PCAP_MAGIC        0xa1b2c3d4
+#define PM_PCAP_MAGIC_NSEC   0xa1b23c4d
+#define PM_PCAP_HDR_LEN      24
+#define PM_PCAP_REC_LEN      16
+
+#define PM_NG_SHB            0x0a0d0d0a
+#define PM_NG_IDB            0x00000001
+#define PM_NG_PB             0x00000002
+#define PM_NG_SPB            0x00000003
+#define PM_NG_EPB            0x00000006
+#define PM_NG_BOM            0x1a2b3c4d
+#define PM_NG_OPT_TSRESOL    9
+#define PM_NG_MAX_IDBS       64
+
+#define PM_PREFETCH_AHEAD    256
+#define PM_RELEASE_CHUNK     (64 << 20)
+
+// strict alignment targets get each packet copied to an aligned buffer
+#if !defined(__i386__) && !defined(__x86_64__)
+#define PM_ALIGN_COPY
+#endif
+
+typedef struct
+{
+    uint64_t units;     // timestamp units per second
+    uint32_t snaplen;
+} PmIdb;
+
+typedef struct
+{
+    char* file;
+    int fd;
+    uint8_t* base;
+    size_t size;
+    size_t pos;
+    size_t released;
+
+    int ng;
+    int swap;
+    int nsec;
+    int dlt;
+    int snaplen;
+
+    PmIdb idb[PM_NG_MAX_IDBS];
+    unsigned num_idbs;
+
+    DAQ_PktHdr_t hdr;   // persists so simple packet blocks keep the last time
+
+#ifdef PM_ALIGN_COPY
+    uint8_t* align_buf;
+    uint32_t align_len;
+#endif
+
+    struct bpf_program fcode;
+    int have_filter;
+
+    volatile int brk;
+    DAQ_State state;
+    DAQ_Stats_t stats;
+    char errbuf[256];
+} PmContext;
+
+//--------------------------------------------------------------------
+// file format
+//--------------------------------------------------------------------
+
+static inline uint32_t pm_u32 (const PmContext* pc, const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return pc->swap ? __builtin_bswap32(v) : v;
+}
+
+static inline uint16_t pm_u16 (const PmContext* pc, const uint8_t* p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return pc->swap ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+static int pm_error (PmContext* pc, const char* what)
+{
+    snprintf(pc->errbuf, sizeof(pc->errbuf),
+        "%s: %s at offset %lu", pc->file, what, (unsigned long)pc->pos);
+    return DAQ_ERROR;
+}
+
+static uint64_t pm_tsresol (uint8_t v)
+{
+    uint64_t units = 1;
+
+    if ( v & 0x80 )
+        return (uint64_t)1 << ((v & 0x7f) > 63 ? 63 : (v & 0x7f));
+
+    if ( v > 19 )
+        v = 19;
+
+    while ( v-- )
+        units *= 10;
+
+    return units;
+}
+
+static int pm_ng_idb (PmContext* pc, const uint8_t* body, uint32_t len)
+{
+    PmIdb* idb;
+    int dlt;
+    uint32_t off = 8;
+
+    if ( len < 8 )
+        return pm_error(pc, "short interface description block");
+
+    if ( pc->num_idbs == PM_NG_MAX_IDBS )
+        return pm_error(pc, "too many interfaces");
+
+    dlt = pm_u16(pc, body);
+
+    if ( pc->dlt < 0 )
+        pc->dlt = dlt;
+
+    else if ( dlt != pc->dlt )
+        return pm_error(pc, "interfaces with different link types");
+
+    idb = pc->idb + pc->num_idbs++;
+    idb->snaplen = pm_u32(pc, body + 4);
+    idb->units = 1000000;
+
+    while ( off + 4 <= len )
+    {
+        uint16_t code = pm_u16(pc, body + off);
+        uint16_t olen = pm_u16(pc, body + off + 2);
+
+        if ( !code )
+            break;
+
+        if ( code == PM_NG_OPT_TSRESOL && olen >= 1 && off + 5 <= len )
+            idb->units = pm_tsresol(body[off + 4]);
+
+        off += 4 + ((olen + 3) & ~3);
+    }
+    return DAQ_SUCCESS;
+}
+
+static int pm_ng_shb (PmContext* pc, const uint8_t* block, uint32_t* len)
+{
+    uint32_t bom;
+
+    if ( pc->size - pc->pos < 12 )
+        return pm_error(pc, "truncated section header block");
+
+    memcpy(&bom, block + 8, sizeof(bom));
+
+    if ( bom == PM_NG_BOM )
+        pc->swap = 0;
+
+    else if ( __builtin_bswap32(bom) == PM_NG_BOM )
+        pc->swap = 1;
+
+    else
+        return pm_error(pc, "bad byte order magic");
+
+    // interface ids are per section
+    pc->num_idbs = 0;
+    *len = pm_u32(pc, block + 4);
+
+    return DAQ_SUCCESS;
+}
+
+static inline void pm_set_ts (DAQ_PktHdr_t* hdr, uint64_t ts, uint64_t units)
+{
+    uint64_t frac = ts % units;
+    uint64_t usec;
+
+    hdr->ts.tv_sec = (time_t)(ts / units);
+
+    // if_tsresol may be a power of 2, so scale instead of dividing by
+    // units/1000000; very large units are shifted down so frac * 1000000
+    // can't overflow, which only costs precision below a usec
+    while ( units > UINT64_MAX / 1000000 )
+    {
+        units >>= 1;
+        frac >>= 1;
+    }
+    usec = frac * 1000000 / units;
+
+    hdr->ts.tv_usec = (suseconds_t)(usec < 1000000 ? usec : 999999);
+}
+
+// returns 1 with the next packet, 0 at end of file, or an error.  with
+// peek set, stops in front of the first packet block without taking it.
+static int pm_ng_next (PmContext* pc, DAQ_PktHdr_t* hdr, uint8_t** data, int peek)
+{
+    while ( pc->size - pc->pos >= 12 )
+    {
+        uint8_t* block = pc->base + pc->pos;
+        uint32_t type, len, body_len;
+        const uint8_t* body;
+        PmIdb* idb;
+        int err;
+
+        memcpy(&type, block, sizeof(type));
+
+        if ( type == PM_NG_SHB )
+        {
+            if ( (err = pm_ng_shb(pc, block, &len)) )
+                return err;
+        }
+        else
+        {
+            type = pm_u32(pc, block);
+            len = pm_u32(pc, block + 4);
+        }
+        if ( len < 12 || (len & 3) || len > pc->size - pc->pos )
+            return pm_error(pc, "bad block length");
+
+        if ( peek && (type == PM_NG_EPB || type == PM_NG_SPB || type == PM_NG_PB) )
+            return 0;
+
+        body = block + 8;
+        body_len = len - 12;
+        pc->pos += len;
+
+        switch ( type )
+        {
+        case PM_NG_IDB:
+            if ( (err = pm_ng_idb(pc, body, body_len)) )
+                return err;
+            continue;
+
+        case PM_NG_EPB:
+        {
+            uint32_t id;
+
+            if ( body_len < 20 )
+                return pm_error(pc, "short enhanced packet block");
+
+            id = pm_u32(pc, body);
+
+            if ( id >= pc->num_idbs )
+                return pm_error(pc, "packet for unknown interface");
+
+            idb = pc->idb + id;
+            hdr->caplen = pm_u32(pc, body + 12);
+            hdr->pktlen = pm_u32(pc, body + 16);
+
+            if ( hdr->caplen > body_len - 20 )
+                return pm_error(pc, "bad captured length");
+
+            pm_set_ts(hdr, ((uint64_t)pm_u32(pc, body + 4) << 32) |
+                pm_u32(pc, body + 8), idb->units);
+
+            *data = (uint8_t*)body + 20;
+            return 1;
+        }
+        case PM_NG_SPB:
+            if ( body_len < 4 || !pc->num_idbs )
+                return pm_error(pc, "bad simple packet block");
+
+            idb = pc->idb;
+            hdr->pktlen = pm_u32(pc, body);
+            hdr->caplen = hdr->pktlen;
+
+            if ( idb->snaplen && hdr->caplen > idb->snaplen )
+                hdr->caplen = idb->snaplen;
+
+            if ( hdr->caplen > body_len - 4 )
+                hdr->caplen = body_len - 4;
+
+            // no timestamp; keep the last one
+            *data = (uint8_t*)body + 4;
+            return 1;
+
+        case PM_NG_PB:
+        {
+            uint16_t id;
+
+            if ( body_len < 20 )
+                return pm_error(pc, "short packet block");
+
+            id = pm_u16(pc, body);
+
+            if ( id >= pc->num_idbs )
+                return pm_error(pc, "packet for unknown interface");
+
+            idb = pc->idb + id;
+            hdr->caplen = pm_u32(pc, body + 12);
+            hdr->pktlen = pm_u32(pc, body + 16);
+
+            if ( hdr->caplen > body_len - 20 )
+                return pm_error(pc, "bad captured length");
+
+            pm_set_ts(hdr, ((uint64_t)pm_u32(pc, body + 4) << 32) |
+                pm_u32(pc, body + 8), idb->units);
+
+            *data = (uint8_t*)body + 20;
+            return 1;
+        }
+        default:
+            // statistics, name resolution, custom, etc.
+            continue;
+        }
+    }
+    return 0;
+}
+
+static int pm_pcap_next (PmContext* pc, DAQ_PktHdr_t* hdr, uint8_t** data)
+{
+    const uint8_t* rec = pc->base + pc->pos;
+    uint32_t frac;
+
+    if ( pc->size - pc->pos < PM_PCAP_REC_LEN )
+    {
+        if ( pc->size != pc->pos )
+            return pm_error(pc, "truncated record header");
+        return 0;
+    }
+    hdr->caplen = pm_u32(pc, rec + 8);
+    hdr->pktlen = pm_u32(pc, rec + 12);
+
+    if ( hdr->caplen > pc->size - pc->pos - PM_PCAP_REC_LEN )
+        return pm_error(pc, "truncated packet");
+
+    hdr->ts.tv_sec = (time_t)pm_u32(pc, rec);
+    frac = pm_u32(pc, rec + 4);
+    hdr->ts.tv_usec = (suseconds_t)(pc->nsec ? frac / 1000 : frac);
+
+    *data = (uint8_t*)rec + PM_PCAP_REC_LEN;
+    pc->pos += PM_PCAP_REC_LEN + hdr->caplen;
+
+    return 1;
+}
+
+static int pm_open (PmContext* pc)
+{
+    struct stat st;
+    uint32_t magic;
+    int err;
+
+    if ( !strcmp(pc->file, "-") )
+    {
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s can't read stdin; use the pcap DAQ", PCAP_MMAP_DAQ_NAME);
+        return DAQ_ERROR_NOTSUP;
+    }
+    pc->fd = open(pc->file, O_RDONLY);
+
+    if ( pc->fd < 0 || fstat(pc->fd, &st) )
+    {
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s: %s", pc->file, strerror(errno));
+        return DAQ_ERROR;
+    }
+    if ( st.st_size < PM_PCAP_HDR_LEN || (uint64_t)st.st_size > (size_t)-1 )
+    {
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s: bad file size", pc->file);
+        return DAQ_ERROR;
+    }
+    pc->size = (size_t)st.st_size;
+    pc->base = (uint8_t*)mmap(NULL, pc->size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE, pc->fd, 0);
+
+    if ( pc->base == MAP_FAILED )
+    {
+        pc->base = NULL;
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s: mmap failed: %s", pc->file, strerror(errno));
+        return DAQ_ERROR;
+    }
+    (void)madvise(pc->base, pc->size, MADV_SEQUENTIAL);
+    (void)madvise(pc->base, pc->size < PM_RELEASE_CHUNK ?
+        pc->size : PM_RELEASE_CHUNK, MADV_WILLNEED);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    (void)posix_fadvise(pc->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    memcpy(&magic, pc->base, sizeof(magic));
+    pc->dlt = -1;
+
+    if ( magic == PM_NG_SHB )
+    {
+        DAQ_PktHdr_t hdr;
+        uint8_t* data;
+
+        pc->ng = 1;
+
+        // pick up the section and interface headers ahead of the first packet
+        if ( (err = pm_ng_next(pc, &hdr, &data, 1)) < 0 )
+            return err;
+
+        if ( pc->dlt < 0 )
+            return pm_error(pc, "no interface description block");
+
+        return DAQ_SUCCESS;
+    }
+    if ( magic == PM_PCAP_MAGIC || magic == PM_PCAP_MAGIC_NSEC )
+        pc->swap = 0;
+
+    else if ( __builtin_bswap32(magic) == PM_PCAP_MAGIC ||
+        __builtin_bswap32(magic) == PM_PCAP_MAGIC_NSEC )
+        pc->swap = 1;
+
+    else
+        return pm_error(pc, "not a pcap or pcapng file");
+
+    pc->nsec = ( pm_u32(pc, pc->base) == PM_PCAP_MAGIC_NSEC );
+    pc->dlt = (int)pm_u32(pc, pc->base + 20);
+    pc->pos = PM_PCAP_HDR_LEN;
+
+    return DAQ_SUCCESS;
+}
+
+static void pm_close (PmContext* pc)
+{
+    if ( pc->base )
+        munmap(pc->base, pc->size);
+
+    if ( pc->fd >= 0 )
+        close(pc->fd);
+
+    pc->base = NULL;
+    pc->fd = -1;
+}
+
+// drop what we've already read from the mapping and the page cache
+static inline void pm_release (PmContext* pc)
+{
+    size_t end = pc->pos & ~((size_t)PM_RELEASE_CHUNK - 1);
+
+    if ( end <= pc->released )
+        return;
+
+    (void)madvise(pc->base + pc->released, end - pc->released, MADV_DONTNEED);
+
+#ifdef POSIX_FADV_DONTNEED
+    (void)posix_fadvise(pc->fd, (off_t)pc->released,
+        (off_t)(end - pc->released), POSIX_FADV_DONTNEED);
+#endif
+
+    if ( end + PM_RELEASE_CHUNK < pc->size )
+        (void)madvise(pc->base + end + PM_RELEASE_CHUNK,
+            (pc->size - end - PM_RELEASE_CHUNK) < PM_RELEASE_CHUNK ?
+            (pc->size - end - PM_RELEASE_CHUNK) : PM_RELEASE_CHUNK,
+            MADV_WILLNEED);
+
+    pc->released = end;
+}
+
+//--------------------------------------------------------------------
+// module api
+//--------------------------------------------------------------------
+
+static void pm_daq_shutdown (void* handle)
+{
+    PmContext* pc = (PmContext*)handle;
+
+    pm_close(pc);
+
+    if ( pc->have_filter )
+        pcap_freecode(&pc->fcode);
+
+#ifdef PM_ALIGN_COPY
+    if ( pc->align_buf )
+        free(pc->align_buf);
+#endif
+    free(pc->file);
+    free(pc);
+}
+
+static int pm_daq_initialize (
+    const DAQ_Config_t* cfg, void** handle, char* errbuf, size_t len)
+{
+    PmContext* pc = (PmContext*)calloc(1, sizeof(*pc));
+    int err;
+
+    if ( !pc || !cfg->name || !(pc->file = strdup(cfg->name)) )
+    {
+        snprintf(errbuf, len, "%s: can't allocate context", __FUNCTION__);
+        free(pc);
+        return DAQ_ERROR_NOMEM;
+    }
+    pc->fd = -1;
+    pc->snaplen = cfg->snaplen;
+
+    if ( cfg->values )
+    {
+        snprintf(errbuf, len, "%s: unknown variable '%s'",
+            __FUNCTION__, cfg->values->key);
+        pm_daq_shutdown(pc);
+        return DAQ_ERROR_INVAL;
+    }
+    if ( (err = pm_open(pc)) )
+    {
+        snprintf(errbuf, len, "%s", pc->errbuf);
+        pm_daq_shutdown(pc);
+        return err;
+    }
+    pc->state = DAQ_STATE_INITIALIZED;
+    *handle = pc;
+
+    return DAQ_SUCCESS;
+}
+
+static int pm_daq_set_filter (void* handle, const char* filter)
+{
+    PmContext* pc = (PmContext*)handle;
+    pcap_t* dead;
+    struct bpf_program fcode;
+
+    dead = pcap_open_dead(pc->dlt, pc->snaplen);
+
+    if ( !dead )
+    {
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s: can't allocate pcap handle", __FUNCTION__);
+        return DAQ_ERROR_NOMEM;
+    }
+    if ( pcap_compile(dead, &fcode, (char*)filter, 1, 0) < 0 )
+    {
+        snprintf(pc->errbuf, sizeof(pc->errbuf),
+            "%s: %s", __FUNCTION__, pcap_geterr(dead));
+        pcap_close(dead);
+        return DAQ_ERROR;
+    }
+    pcap_close(dead);
+
+    if ( pc->have_filter )
+        pcap_freecode(&pc->fcode);
+
+    pc->fcode = fcode;
+    pc->have_filter = 1;
+
+    return DAQ_SUCCESS;
+}
+
+static int pm_daq_start (void* handle)
+{
+    PmContext* pc = (PmContext*)handle;
+
+    memset(&pc->stats, 0, sizeof(pc->stats));
+    memset(&pc->hdr, 0, sizeof(pc->hdr));
+
+    pc->hdr.ingress_index = pc->hdr.egress_index = DAQ_PKTHDR_UNKNOWN;
+    pc->hdr.ingress_group = pc->hdr.egress_group = DAQ_PKTHDR_UNKNOWN;
+    pc->state = DAQ_STATE_STARTED;
+
+    return DAQ_SUCCESS;
+}
+
+static int pm_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback, void* user)
+{
+    PmContext* pc = (PmContext*)handle;
+    DAQ_PktHdr_t* hdr = &pc->hdr;
+    int got = 0;
+
+    while ( !pc->brk && (cnt <= 0 || got < cnt) )
+    {
+        DAQ_Verdict verdict;
+        uint8_t* data;
+        int rc;
+
+        rc = pc->ng ? pm_ng_next(pc, hdr, &data, 0) : pm_pcap_next(pc, hdr, &data);
+
+        if ( rc <= 0 )
+            return rc ? rc : DAQ_READFILE_EOF;
+
+        // the next record header and the start of its packet
+        __builtin_prefetch(pc->base + pc->pos);
+        __builtin_prefetch(pc->base + pc->pos + 64);
+        __builtin_prefetch(pc->base + pc->pos + PM_PREFETCH_AHEAD);
+
+        pc->stats.hw_packets_received++;
+
+        if ( pc->have_filter &&
+            !bpf_filter(pc->fcode.bf_insns, data, hdr->pktlen, hdr->caplen) )
+        {
+            pc->stats.packets_filtered++;
+            continue;
+        }
+
+#ifdef PM_ALIGN_COPY
+        if ( hdr->caplen > pc->align_len )
+        {
+            uint8_t* buf = (uint8_t*)realloc(pc->align_buf, hdr->caplen);
+
+            if ( !buf )
+                return DAQ_ERROR_NOMEM;
+
+            pc->align_buf = buf;
+            pc->align_len = hdr->caplen;
+        }
+        memcpy(pc->align_buf, data, hdr->caplen);
+        data = pc->align_buf;
+#endif
+        pc->stats.packets_received++;
+        got++;
+
+        verdict = callback(user, hdr, data);
+
+        if ( verdict >= MAX_DAQ_VERDICT )
+            verdict = DAQ_VERDICT_PASS;
+
+        pc->stats.verdicts[verdict]++;
+
+        if ( pc->pos - pc->released >= 2 * (size_t)PM_RELEASE_CHUNK )
+            pm_release(pc);
+    }
+    pc->brk = 0;
+    return DAQ_SUCCESS;
+}
+
+#ifdef HAVE_DAQ_ACQUIRE_WITH_META
+static int pm_daq_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback,
+    DAQ_Meta_Func_t metaback, void* user)
+{
+    return pm_acquire(handle, cnt, callback, user);
+}
+#else
+static int pm_daq_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback, void* user)
+{
+    return pm_acquire(handle, cnt, callback, user);
+}
+#endif
+
+static int pm_daq_inject (
+    void* handle, const DAQ_PktHdr_t* hdr, const uint8_t* data,
+    uint32_t len, int reverse)
+{
+    return DAQ_ERROR_NOTSUP;
+}
+
+static int pm_daq_breakloop (void* handle)
+{
+    ((PmContext*)handle)->brk = 1;
+    return DAQ_SUCCESS;
+}
+
+static int pm_daq_stop (void* handle)
+{
+    PmContext* pc = (PmContext*)handle;
+
+    pm_close(pc);
+    pc->state = DAQ_STATE_STOPPED;
+
+    return DAQ_SUCCESS;
+}
+
+static DAQ_State pm_daq_check_status (void* handle)
+{
+    return ((PmContext*)handle)->state;
+}
+
+static int pm_daq_get_stats (void* handle, DAQ_Stats_t* stats)
+{
+    *stats = ((PmContext*)handle)->stats;
+    return DAQ_SUCCESS;
+}
+
+static void pm_daq_reset_stats (void* handle)
+{
+    memset(&((PmContext*)handle)->stats, 0, sizeof(DAQ_Stats_t));
+}
+
+static int pm_daq_get_snaplen (void* handle)
+{
+    return ((PmContext*)handle)->snaplen;
+}
+
+static uint32_t pm_daq_get_capabilities (void* handle)
+{
+    return DAQ_CAPA_BREAKLOOP | DAQ_CAPA_BPF | DAQ_CAPA_UNPRIV_START;
+}
+
+static int pm_daq_get_datalink_type (void* handle)
+{
+    return ((PmContext*)handle)->dlt;
+}
+
+static const char* pm_daq_get_errbuf (void* handle)
+{
+    return ((PmContext*)handle)->errbuf;
+}
+
+static void pm_daq_set_errbuf (void* handle, const char* s)
+{
+    PmContext* pc = (PmContext*)handle;
+    snprintf(pc->errbuf, sizeof(pc->errbuf), "%s", s ? s : "");
+}
+
+static int pm_daq_get_device_index (void* handle, const char* device)
+{
+    return DAQ_ERROR_NOTSUP;
+}
+
+// designated initializers since the trailing members vary by daq version
+static const DAQ_Module_t pcap_mmap_daq_module =
+{
+    .api_version = DAQ_API_VERSION,
+    .module_version = PCAP_MMAP_DAQ_VERSION,
+    .name = PCAP_MMAP_DAQ_NAME,
+    .type = DAQ_TYPE_FILE_CAPABLE,
+    .initialize = pm_daq_initialize,
+    .set_filter = pm_daq_set_filter,
+    .start = pm_daq_start,
+    .acquire = pm_daq_acquire,
+    .inject = pm_daq_inject,
+    .breakloop = pm_daq_breakloop,
+    .stop = pm_daq_stop,
+    .shutdown = pm_daq_shutdown,
+    .check_status = pm_daq_check_status,
+    .get_stats = pm_daq_get_stats,
+    .reset_stats = pm_daq_reset_stats,
+    .get_snaplen = pm_daq_get_snaplen,
+    .get_capabilities = pm_daq_get_capabilities,
+    .get_datalink_type = pm_daq_get_datalink_type,
+    .get_errbuf = pm_daq_get_errbuf,
+    .set_errbuf = pm_daq_set_errbuf,
+    .get_device_index = pm_daq_get_device_index,
+};
+
+const DAQ_Module_t* PCAP_MMAP_DAQ_GetModule (void)
+{
+    return &pcap_mmap_daq_module;
+}
+
+#else
+
+const DAQ_Module_t* PCAP_MMAP_DAQ_GetModule (void)
+{
+    return NULL;
+}
+
+#endif
+
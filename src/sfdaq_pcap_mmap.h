@@ -0,0 +1,42 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    sfdaq_pcap_mmap.h
+//
+// built-in readback module that memory maps pcap and pcapng files
+// instead of reading them through stdio.  it plugs in behind sfdaq.c
+// like any other daq module and is selected with --daq pcap_mmap.
+// see README.pcap_readmode.
+
+#ifndef __SFDAQ_PCAP_MMAP_H__
+#define __SFDAQ_PCAP_MMAP_H__
+
+#include <daq.h>
+
+#define PCAP_MMAP_DAQ_NAME     "pcap_mmap"
+#define PCAP_MMAP_DAQ_VERSION  1
+
+// returns NULL if the module isn't available on this platform
+const DAQ_Module_t* PCAP_MMAP_DAQ_GetModule(void);
+
+#endif // __SFDAQ_PCAP_MMAP_H__
+
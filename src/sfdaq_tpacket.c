@@ -0,0 +1,1089 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    sfdaq_tpacket.c
+//
+// each interface gets a TPACKET_V3 rx ring and a TPACKET_V2 tx ring.
+// received frames are handed to the engine straight from the ring and
+// the ring block is returned to the kernel once all of its frames have
+// been processed.  forwarded (inline) and injected frames are copied
+// into the tx ring and the ring is kicked with a single send() per block
+// instead of one syscall per frame.
+//
+// the interface spec is one interface or a ':' separated list.  in
+// inline mode the list is taken in pairs (eth0:eth1:eth2:eth3 bridges
+// eth0 with eth1 and eth2 with eth3).
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sfdaq_tpacket.h"
+
+#ifdef LINUX
+#include <linux/if_packet.h>
+#endif
+
+#if defined(LINUX) && defined(TPACKET3_HDRLEN) && defined(PACKET_FANOUT)
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#include <pcap.h>
+#include <daq_api.h>
+
+#define TP_MAX_INTFS       8
+#define TP_VLAN_TAG_LEN    4
+#define TP_MAC_ADDRS_LEN   12
+
+#define TP_DEFAULT_BLOCK_SIZE     (1 << 20)
+#define TP_DEFAULT_BUFFER_MB      32
+#define TP_DEFAULT_BLOCK_TIMEOUT  10    // ms
+#define TP_DEFAULT_TX_FRAMES      1024
+
+// frames the tx rings couldn't take, across all instances.  these are
+// kept out of hw_packets_dropped, which is the kernel's rx ring drops.
+static uint64_t tp_tx_dropped = 0;
+
+typedef struct _TpIntf
+{
+    char name[IFNAMSIZ];
+    int index;
+
+    int rx_fd;
+    uint8_t* rx_ring;
+    size_t rx_size;
+    unsigned rx_block;                 // next block to check
+    struct tpacket_block_desc* held;   // block being walked, if any
+    struct tpacket3_hdr* frame;        // next frame of held block
+    unsigned left;                     // frames left in held block
+
+    int tx_fd;
+    uint8_t* tx_ring;
+    size_t tx_size;
+    unsigned tx_frame_size;
+    unsigned tx_frames;
+    unsigned tx_next;
+    unsigned tx_queued;                // frames queued since last kick
+
+    struct _TpIntf* peer;
+} TpIntf;
+
+typedef struct
+{
+    TpIntf intf[TP_MAX_INTFS];
+    unsigned num_intfs;
+
+    DAQ_Mode mode;
+    int snaplen;
+    int timeout;
+    int promisc;
+
+    unsigned block_size;
+    unsigned block_count;
+    unsigned block_timeout;
+    unsigned tx_frames;
+    int fanout;                        // setsockopt value or -1
+
+    struct bpf_program fcode;
+    int have_filter;
+
+    volatile int brk;
+    int in_acquire;
+    DAQ_State state;
+    DAQ_Stats_t stats;
+    char errbuf[256];
+} TpContext;
+
+//--------------------------------------------------------------------
+// config
+//--------------------------------------------------------------------
+
+static int tp_fanout_type (const char* s)
+{
+    if ( !strcasecmp(s, "hash") )
+        return PACKET_FANOUT_HASH;
+
+    if ( !strcasecmp(s, "lb") )
+        return PACKET_FANOUT_LB;
+
+    if ( !strcasecmp(s, "cpu") )
+        return PACKET_FANOUT_CPU;
+
+#ifdef PACKET_FANOUT_ROLLOVER
+    if ( !strcasecmp(s, "rollover") )
+        return PACKET_FANOUT_ROLLOVER;
+#endif
+#ifdef PACKET_FANOUT_RND
+    if ( !strcasecmp(s, "rnd") )
+        return PACKET_FANOUT_RND;
+#endif
+#ifdef PACKET_FANOUT_QM
+    if ( !strcasecmp(s, "qm") )
+        return PACKET_FANOUT_QM;
+#endif
+    return -1;
+}
+
+static int tp_get_uint (
+    TpContext* tc, const DAQ_Dict* entry, unsigned lo, unsigned hi, unsigned* val)
+{
+    char* end;
+    unsigned long v;
+
+    if ( !entry->value )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: %s requires a value", __FUNCTION__, entry->key);
+        return DAQ_ERROR_INVAL;
+    }
+    errno = 0;
+    v = strtoul(entry->value, &end, 0);
+
+    if ( errno || *end || v < lo || v > hi )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: bad %s '%s' (%u to %u)", __FUNCTION__,
+            entry->key, entry->value, lo, hi);
+        return DAQ_ERROR_INVAL;
+    }
+    *val = (unsigned)v;
+    return DAQ_SUCCESS;
+}
+
+static int tp_parse_vars (TpContext* tc, const DAQ_Config_t* cfg)
+{
+    const DAQ_Dict* entry;
+    unsigned buffer_mb = TP_DEFAULT_BUFFER_MB;
+    unsigned fanout_id = 0, defrag = 0;
+    int fanout_type = -1;
+    int err = DAQ_SUCCESS;
+
+    tc->block_size = TP_DEFAULT_BLOCK_SIZE;
+    tc->block_timeout = TP_DEFAULT_BLOCK_TIMEOUT;
+    tc->tx_frames = TP_DEFAULT_TX_FRAMES;
+
+    for ( entry = cfg->values; entry && !err; entry = entry->next )
+    {
+        if ( !strcmp(entry->key, "block_size") )
+            err = tp_get_uint(tc, entry, 4096, 1 << 28, &tc->block_size);
+
+        else if ( !strcmp(entry->key, "buffer_size_mb") )
+            err = tp_get_uint(tc, entry, 1, 1 << 16, &buffer_mb);
+
+        else if ( !strcmp(entry->key, "block_timeout") )
+            err = tp_get_uint(tc, entry, 1, 60000, &tc->block_timeout);
+
+        else if ( !strcmp(entry->key, "tx_frames") )
+            err = tp_get_uint(tc, entry, 16, 1 << 20, &tc->tx_frames);
+
+        else if ( !strcmp(entry->key, "fanout_id") )
+        {
+            err = tp_get_uint(tc, entry, 0, 0xffff, &fanout_id);
+
+            if ( fanout_type < 0 )
+                fanout_type = PACKET_FANOUT_HASH;
+        }
+        else if ( !strcmp(entry->key, "fanout_type") )
+        {
+            if ( !entry->value || (fanout_type = tp_fanout_type(entry->value)) < 0 )
+            {
+                snprintf(tc->errbuf, sizeof(tc->errbuf),
+                    "%s: bad fanout_type '%s'", __FUNCTION__,
+                    entry->value ? entry->value : "");
+                err = DAQ_ERROR_INVAL;
+            }
+        }
+        else if ( !strcmp(entry->key, "fanout_defrag") )
+            defrag = 1;
+
+        else
+        {
+            snprintf(tc->errbuf, sizeof(tc->errbuf),
+                "%s: unknown variable '%s'", __FUNCTION__, entry->key);
+            err = DAQ_ERROR_INVAL;
+        }
+    }
+    if ( err )
+        return err;
+
+    if ( tc->block_size & (getpagesize() - 1) )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: block_size must be a multiple of the page size", __FUNCTION__);
+        return DAQ_ERROR_INVAL;
+    }
+    tc->block_count = ((uint64_t)buffer_mb << 20) / tc->block_size;
+
+    if ( tc->block_count < 2 )
+        tc->block_count = 2;
+
+    if ( fanout_type < 0 )
+        tc->fanout = -1;
+    else
+    {
+        tc->fanout = (int)(fanout_id | (fanout_type << 16));
+
+        if ( defrag )
+            tc->fanout |= PACKET_FANOUT_FLAG_DEFRAG << 16;
+    }
+    return DAQ_SUCCESS;
+}
+
+static int tp_parse_intfs (TpContext* tc, const char* spec)
+{
+    const char* s = spec;
+    unsigned i;
+
+    while ( *s )
+    {
+        size_t len = strcspn(s, ":");
+        TpIntf* intf;
+
+        if ( !len )
+        {
+            s++;
+            continue;
+        }
+        if ( tc->num_intfs == TP_MAX_INTFS || len >= IFNAMSIZ )
+        {
+            snprintf(tc->errbuf, sizeof(tc->errbuf),
+                "%s: bad interface spec '%s'", __FUNCTION__, spec);
+            return DAQ_ERROR_INVAL;
+        }
+        intf = tc->intf + tc->num_intfs++;
+        memcpy(intf->name, s, len);
+        intf->name[len] = '\0';
+        intf->rx_fd = intf->tx_fd = -1;
+
+        intf->index = if_nametoindex(intf->name);
+
+        if ( !intf->index )
+        {
+            snprintf(tc->errbuf, sizeof(tc->errbuf),
+                "%s: unknown interface '%s'", __FUNCTION__, intf->name);
+            return DAQ_ERROR_NODEV;
+        }
+        s += len;
+    }
+    if ( !tc->num_intfs )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: no interface given", __FUNCTION__);
+        return DAQ_ERROR_NODEV;
+    }
+    if ( tc->mode != DAQ_MODE_INLINE )
+        return DAQ_SUCCESS;
+
+    if ( tc->num_intfs & 1 )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: inline mode requires interface pairs", __FUNCTION__);
+        return DAQ_ERROR_INVAL;
+    }
+    for ( i = 0; i < tc->num_intfs; i += 2 )
+    {
+        tc->intf[i].peer = tc->intf + i + 1;
+        tc->intf[i+1].peer = tc->intf + i;
+    }
+    return DAQ_SUCCESS;
+}
+
+//--------------------------------------------------------------------
+// rings
+//--------------------------------------------------------------------
+
+static int tp_fail (TpContext* tc, const TpIntf* intf, const char* what)
+{
+    snprintf(tc->errbuf, sizeof(tc->errbuf),
+        "%s on %s failed: %s", what, intf->name, strerror(errno));
+    return DAQ_ERROR;
+}
+
+static int tp_bind (int fd, const TpIntf* intf, int proto)
+{
+    struct sockaddr_ll sll;
+
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(proto);
+    sll.sll_ifindex = intf->index;
+
+    return bind(fd, (struct sockaddr*)&sll, sizeof(sll));
+}
+
+static int tp_open_rx (TpContext* tc, TpIntf* intf)
+{
+    struct tpacket_req3 req;
+    int ver = TPACKET_V3;
+    unsigned reserve = TP_VLAN_TAG_LEN;
+    unsigned frame = TPACKET_ALIGN(TPACKET3_HDRLEN + ETH_HLEN);
+
+    intf->rx_fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+
+    if ( intf->rx_fd < 0 )
+        return tp_fail(tc, intf, "rx socket");
+
+    if ( setsockopt(intf->rx_fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) )
+        return tp_fail(tc, intf, "TPACKET_V3");
+
+    // headroom so a stripped vlan tag can be put back in place
+    if ( setsockopt(intf->rx_fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) )
+        return tp_fail(tc, intf, "PACKET_RESERVE");
+
+    if ( tc->have_filter )
+    {
+        struct sock_fprog prog;
+        prog.len = tc->fcode.bf_len;
+        prog.filter = (struct sock_filter*)tc->fcode.bf_insns;
+
+        if ( setsockopt(intf->rx_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) )
+            return tp_fail(tc, intf, "SO_ATTACH_FILTER");
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = tc->block_size;
+    req.tp_block_nr = tc->block_count;
+    req.tp_frame_size = frame;
+    req.tp_frame_nr = (tc->block_size / frame) * tc->block_count;
+    req.tp_retire_blk_tov = tc->block_timeout;
+
+    if ( setsockopt(intf->rx_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) )
+        return tp_fail(tc, intf, "PACKET_RX_RING");
+
+    intf->rx_size = (size_t)tc->block_size * tc->block_count;
+    intf->rx_ring = (uint8_t*)mmap(NULL, intf->rx_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, intf->rx_fd, 0);
+
+    if ( intf->rx_ring == MAP_FAILED )
+    {
+        intf->rx_ring = NULL;
+        return tp_fail(tc, intf, "rx mmap");
+    }
+    if ( tp_bind(intf->rx_fd, intf, ETH_P_ALL) )
+        return tp_fail(tc, intf, "rx bind");
+
+    if ( tc->promisc )
+    {
+        struct packet_mreq mr;
+        memset(&mr, 0, sizeof(mr));
+        mr.mr_ifindex = intf->index;
+        mr.mr_type = PACKET_MR_PROMISC;
+
+        if ( setsockopt(intf->rx_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mr, sizeof(mr)) )
+            return tp_fail(tc, intf, "promiscuous mode");
+    }
+    // must follow bind; all instances with the same id share the load
+    if ( tc->fanout >= 0 )
+    {
+        if ( setsockopt(intf->rx_fd, SOL_PACKET, PACKET_FANOUT, &tc->fanout, sizeof(tc->fanout)) )
+            return tp_fail(tc, intf, "PACKET_FANOUT");
+    }
+    return DAQ_SUCCESS;
+}
+
+// the tx socket uses protocol 0 so it never receives anything
+static int tp_open_tx (TpContext* tc, TpIntf* intf)
+{
+    struct tpacket_req req;
+    int ver = TPACKET_V2;
+    unsigned frame = TPACKET_ALIGN(TPACKET2_HDRLEN + tc->snaplen + TP_VLAN_TAG_LEN);
+    unsigned block = getpagesize();
+
+    while ( block < frame )
+        block <<= 1;
+
+    intf->tx_fd = socket(AF_PACKET, SOCK_RAW, 0);
+
+    if ( intf->tx_fd < 0 )
+        return tp_fail(tc, intf, "tx socket");
+
+    if ( setsockopt(intf->tx_fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) )
+        return tp_fail(tc, intf, "TPACKET_V2");
+
+#ifdef PACKET_QDISC_BYPASS
+    {
+        // best effort; older kernels just queue through the qdisc
+        int one = 1;
+        (void)setsockopt(intf->tx_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one));
+    }
+#endif
+
+    memset(&req, 0, sizeof(req));
+    req.tp_frame_size = frame;
+    req.tp_block_size = block;
+    req.tp_frame_nr = tc->tx_frames;
+    req.tp_block_nr = (tc->tx_frames + (block / frame) - 1) / (block / frame);
+    req.tp_frame_nr = req.tp_block_nr * (block / frame);
+
+    if ( setsockopt(intf->tx_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) )
+        return tp_fail(tc, intf, "PACKET_TX_RING");
+
+    intf->tx_size = (size_t)req.tp_block_size * req.tp_block_nr;
+    intf->tx_ring = (uint8_t*)mmap(NULL, intf->tx_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, intf->tx_fd, 0);
+
+    if ( intf->tx_ring == MAP_FAILED )
+    {
+        intf->tx_ring = NULL;
+        return tp_fail(tc, intf, "tx mmap");
+    }
+    intf->tx_frame_size = frame;
+    intf->tx_frames = req.tp_frame_nr;
+
+    if ( tp_bind(intf->tx_fd, intf, 0) )
+        return tp_fail(tc, intf, "tx bind");
+
+    return DAQ_SUCCESS;
+}
+
+static void tp_close (TpIntf* intf)
+{
+    if ( intf->rx_ring )
+        munmap(intf->rx_ring, intf->rx_size);
+
+    if ( intf->tx_ring )
+        munmap(intf->tx_ring, intf->tx_size);
+
+    if ( intf->rx_fd >= 0 )
+        close(intf->rx_fd);
+
+    if ( intf->tx_fd >= 0 )
+        close(intf->tx_fd);
+
+    intf->rx_ring = intf->tx_ring = NULL;
+    intf->rx_fd = intf->tx_fd = -1;
+    intf->held = NULL;
+    intf->left = intf->rx_block = 0;
+    intf->tx_next = intf->tx_queued = 0;
+}
+
+static inline struct tpacket_block_desc* tp_block (TpIntf* intf, unsigned n, unsigned size)
+{
+    return (struct tpacket_block_desc*)(intf->rx_ring + (size_t)n * size);
+}
+
+//--------------------------------------------------------------------
+// tx
+//--------------------------------------------------------------------
+
+static inline void tp_kick (TpIntf* intf)
+{
+    if ( !intf->tx_queued )
+        return;
+
+    intf->tx_queued = 0;
+    (void)send(intf->tx_fd, NULL, 0, MSG_DONTWAIT);
+}
+
+static void tp_kick_all (TpContext* tc)
+{
+    unsigned i;
+
+    for ( i = 0; i < tc->num_intfs; i++ )
+        tp_kick(tc->intf + i);
+}
+
+// copy into the next tx frame; the kernel sends it on the next kick.
+// if the ring is full, kick once and retry before giving up.  frames
+// that don't make it are counted in tp_tx_dropped.
+static int tp_queue (TpIntf* intf, const uint8_t* data, uint32_t len)
+{
+    struct tpacket2_hdr* h;
+    unsigned off = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+
+    if ( len > intf->tx_frame_size - off )
+    {
+        tp_tx_dropped++;
+        return DAQ_ERROR;
+    }
+
+    h = (struct tpacket2_hdr*)(intf->tx_ring + (size_t)intf->tx_next * intf->tx_frame_size);
+
+    if ( h->tp_status != TP_STATUS_AVAILABLE )
+    {
+        if ( h->tp_status & TP_STATUS_WRONG_FORMAT )
+            h->tp_status = TP_STATUS_AVAILABLE;
+        else
+        {
+            intf->tx_queued = 1;
+            tp_kick(intf);
+
+            if ( h->tp_status != TP_STATUS_AVAILABLE )
+            {
+                tp_tx_dropped++;
+                return DAQ_ERROR_AGAIN;
+            }
+        }
+    }
+    memcpy((uint8_t*)h + off, data, len);
+    h->tp_len = len;
+    __sync_synchronize();
+    h->tp_status = TP_STATUS_SEND_REQUEST;
+
+    if ( ++intf->tx_next == intf->tx_frames )
+        intf->tx_next = 0;
+
+    intf->tx_queued++;
+    return DAQ_SUCCESS;
+}
+
+//--------------------------------------------------------------------
+// rx
+//--------------------------------------------------------------------
+
+// the kernel strips the outer vlan tag into the frame header; put it
+// back in the headroom reserved ahead of the mac header
+static inline uint8_t* tp_restore_vlan (struct tpacket3_hdr* h, uint8_t* data)
+{
+    uint16_t tpid = ETH_P_8021Q;
+    uint16_t tci = htons((uint16_t)h->hv1.tp_vlan_tci);
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+    if ( h->tp_status & TP_STATUS_VLAN_TPID_VALID )
+        tpid = h->hv1.tp_vlan_tpid;
+#endif
+    tpid = htons(tpid);
+
+    memmove(data - TP_VLAN_TAG_LEN, data, TP_MAC_ADDRS_LEN);
+    data -= TP_VLAN_TAG_LEN;
+
+    memcpy(data + TP_MAC_ADDRS_LEN, &tpid, sizeof(tpid));
+    memcpy(data + TP_MAC_ADDRS_LEN + sizeof(tpid), &tci, sizeof(tci));
+
+    return data;
+}
+
+static inline void tp_release (TpIntf* intf)
+{
+    __sync_synchronize();
+    intf->held->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    intf->held = NULL;
+}
+
+// process up to max frames from this interface; returns the number of
+// frames passed to the callback or -1 if the ring has nothing for us
+static int tp_walk (
+    TpContext* tc, TpIntf* intf, int max, DAQ_Analysis_Func_t callback, void* user)
+{
+    DAQ_PktHdr_t hdr;
+    int n = 0;
+
+    if ( !intf->held )
+    {
+        struct tpacket_block_desc* bd = tp_block(intf, intf->rx_block, tc->block_size);
+
+        if ( !(bd->hdr.bh1.block_status & TP_STATUS_USER) )
+            return -1;
+
+        __sync_synchronize();
+
+        if ( ++intf->rx_block == tc->block_count )
+            intf->rx_block = 0;
+
+        intf->held = bd;
+        intf->left = bd->hdr.bh1.num_pkts;
+        intf->frame = (struct tpacket3_hdr*)((uint8_t*)bd + bd->hdr.bh1.offset_to_first_pkt);
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.ingress_index = intf->index;
+    hdr.egress_index = intf->peer ? intf->peer->index : DAQ_PKTHDR_UNKNOWN;
+    hdr.ingress_group = hdr.egress_group = DAQ_PKTHDR_UNKNOWN;
+
+    while ( intf->left && (max <= 0 || n < max) && !tc->brk )
+    {
+        struct tpacket3_hdr* h = intf->frame;
+        const struct sockaddr_ll* sll = (const struct sockaddr_ll*)
+            ((uint8_t*)h + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+        uint8_t* data = (uint8_t*)h + h->tp_mac;
+        uint32_t caplen = h->tp_snaplen;
+        uint32_t pktlen = h->tp_len;
+        DAQ_Verdict verdict;
+
+        intf->frame = (struct tpacket3_hdr*)((uint8_t*)h + h->tp_next_offset);
+        intf->left--;
+
+        // inline, these are our own transmissions on the other side of
+        // a pair.  passive, they are the host's traffic and get analyzed.
+        if ( sll->sll_pkttype == PACKET_OUTGOING && tc->mode == DAQ_MODE_INLINE )
+            continue;
+
+        if ( h->tp_status & TP_STATUS_VLAN_VALID )
+        {
+            data = tp_restore_vlan(h, data);
+            caplen += TP_VLAN_TAG_LEN;
+            pktlen += TP_VLAN_TAG_LEN;
+        }
+        hdr.ts.tv_sec = h->tp_sec;
+        hdr.ts.tv_usec = h->tp_nsec / 1000;
+        hdr.caplen = ( caplen > (uint32_t)tc->snaplen ) ? (uint32_t)tc->snaplen : caplen;
+        hdr.pktlen = pktlen;
+
+        tc->stats.packets_received++;
+        n++;
+
+        verdict = callback(user, &hdr, data);
+
+        if ( verdict >= MAX_DAQ_VERDICT )
+            verdict = DAQ_VERDICT_PASS;
+
+        tc->stats.verdicts[verdict]++;
+
+        if ( !intf->peer )
+            continue;
+
+        switch ( verdict )
+        {
+        case DAQ_VERDICT_BLOCK:
+        case DAQ_VERDICT_BLACKLIST:
+            break;
+
+        default:
+            // replacements were made in place in the ring
+            (void)tp_queue(intf->peer, data, caplen);
+            break;
+        }
+    }
+    if ( !intf->left )
+        tp_release(intf);
+
+    return n;
+}
+
+static int tp_wait (TpContext* tc)
+{
+    struct pollfd pfd[TP_MAX_INTFS];
+    unsigned i;
+    int rc;
+
+    for ( i = 0; i < tc->num_intfs; i++ )
+    {
+        pfd[i].fd = tc->intf[i].rx_fd;
+        pfd[i].events = POLLIN;
+        pfd[i].revents = 0;
+    }
+    rc = poll(pfd, tc->num_intfs, tc->timeout);
+
+    if ( rc < 0 && errno != EINTR )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: poll failed: %s", __FUNCTION__, strerror(errno));
+        return DAQ_ERROR;
+    }
+    for ( i = 0; i < tc->num_intfs && rc > 0; i++ )
+    {
+        if ( pfd[i].revents & (POLLHUP | POLLERR | POLLNVAL) )
+        {
+            snprintf(tc->errbuf, sizeof(tc->errbuf),
+                "%s: interface %s went away", __FUNCTION__, tc->intf[i].name);
+            return DAQ_ERROR;
+        }
+    }
+    return rc;
+}
+
+//--------------------------------------------------------------------
+// module api
+//--------------------------------------------------------------------
+
+static int tp_daq_initialize (
+    const DAQ_Config_t* cfg, void** handle, char* errbuf, size_t len)
+{
+    TpContext* tc = (TpContext*)calloc(1, sizeof(*tc));
+    int err;
+
+    if ( !tc )
+    {
+        snprintf(errbuf, len, "%s: can't allocate context", __FUNCTION__);
+        return DAQ_ERROR_NOMEM;
+    }
+    tc->mode = cfg->mode;
+    tc->snaplen = cfg->snaplen;
+    tc->timeout = cfg->timeout ? (int)cfg->timeout : -1;
+    tc->promisc = (cfg->flags & DAQ_CFG_PROMISC) != 0;
+
+    err = tp_parse_vars(tc, cfg);
+
+    if ( !err )
+        err = tp_parse_intfs(tc, cfg->name ? cfg->name : "");
+
+    if ( err )
+    {
+        snprintf(errbuf, len, "%s", tc->errbuf);
+        free(tc);
+        return err;
+    }
+    tc->state = DAQ_STATE_INITIALIZED;
+    *handle = tc;
+
+    return DAQ_SUCCESS;
+}
+
+static int tp_daq_set_filter (void* handle, const char* filter)
+{
+    TpContext* tc = (TpContext*)handle;
+    pcap_t* dead;
+    struct bpf_program fcode;
+
+    dead = pcap_open_dead(DLT_EN10MB, tc->snaplen);
+
+    if ( !dead )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: can't allocate pcap handle", __FUNCTION__);
+        return DAQ_ERROR_NOMEM;
+    }
+    if ( pcap_compile(dead, &fcode, (char*)filter, 1, 0) < 0 )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: %s", __FUNCTION__, pcap_geterr(dead));
+        pcap_close(dead);
+        return DAQ_ERROR;
+    }
+    pcap_close(dead);
+
+    if ( tc->have_filter )
+        pcap_freecode(&tc->fcode);
+
+    tc->fcode = fcode;
+    tc->have_filter = 1;
+
+    return DAQ_SUCCESS;
+}
+
+static int tp_daq_stop (void* handle)
+{
+    TpContext* tc = (TpContext*)handle;
+    unsigned i;
+
+    tp_kick_all(tc);
+
+    for ( i = 0; i < tc->num_intfs; i++ )
+        tp_close(tc->intf + i);
+
+    tc->state = DAQ_STATE_STOPPED;
+    return DAQ_SUCCESS;
+}
+
+static int tp_daq_start (void* handle)
+{
+    TpContext* tc = (TpContext*)handle;
+    unsigned i;
+    int err = DAQ_SUCCESS;
+
+    for ( i = 0; i < tc->num_intfs && !err; i++ )
+    {
+        TpIntf* intf = tc->intf + i;
+
+        err = tp_open_rx(tc, intf);
+
+        if ( !err )
+            err = tp_open_tx(tc, intf);
+    }
+    if ( err )
+    {
+        for ( i = 0; i < tc->num_intfs; i++ )
+            tp_close(tc->intf + i);
+
+        return err;
+    }
+    memset(&tc->stats, 0, sizeof(tc->stats));
+    tc->state = DAQ_STATE_STARTED;
+
+    return DAQ_SUCCESS;
+}
+
+static int tp_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback, void* user)
+{
+    TpContext* tc = (TpContext*)handle;
+    unsigned start = 0;
+    int got = 0;
+
+    tc->in_acquire = 1;
+
+    while ( !tc->brk && (cnt <= 0 || got < cnt) )
+    {
+        int any = 0;
+        unsigned i;
+
+        // rotate the starting interface so no ring starves the others
+        for ( i = 0; i < tc->num_intfs; i++ )
+        {
+            TpIntf* intf = tc->intf + (start + i) % tc->num_intfs;
+            int n = tp_walk(tc, intf, cnt > 0 ? cnt - got : 0, callback, user);
+
+            if ( n < 0 )
+                continue;
+
+            got += n;
+            any = 1;
+
+            if ( tc->brk || (cnt > 0 && got >= cnt) )
+                break;
+        }
+        if ( ++start == tc->num_intfs )
+            start = 0;
+
+        tp_kick_all(tc);
+
+        if ( !any )
+        {
+            int rc = tp_wait(tc);
+
+            if ( rc < 0 )
+            {
+                tc->in_acquire = 0;
+                return rc;
+            }
+            // timeout; let the caller do its idle processing
+            if ( rc == 0 )
+                break;
+        }
+    }
+    tc->brk = 0;
+    tc->in_acquire = 0;
+    return DAQ_SUCCESS;
+}
+
+#ifdef HAVE_DAQ_ACQUIRE_WITH_META
+static int tp_daq_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback,
+    DAQ_Meta_Func_t metaback, void* user)
+{
+    return tp_acquire(handle, cnt, callback, user);
+}
+#else
+static int tp_daq_acquire (
+    void* handle, int cnt, DAQ_Analysis_Func_t callback, void* user)
+{
+    return tp_acquire(handle, cnt, callback, user);
+}
+#endif
+
+static TpIntf* tp_find_intf (TpContext* tc, int index)
+{
+    unsigned i;
+
+    for ( i = 0; i < tc->num_intfs; i++ )
+    {
+        if ( tc->intf[i].index == index )
+            return tc->intf + i;
+    }
+    return NULL;
+}
+
+// inject goes out the ingress interface when reversed and out the peer
+// (or the only interface in passive mode) otherwise.  within acquire the
+// frame goes out with the rest of the block's batch.
+static int tp_daq_inject (
+    void* handle, const DAQ_PktHdr_t* hdr, const uint8_t* data,
+    uint32_t len, int reverse)
+{
+    TpContext* tc = (TpContext*)handle;
+    TpIntf* intf = tp_find_intf(tc, hdr->ingress_index);
+    int err;
+
+    if ( !intf )
+        intf = tc->intf;
+
+    if ( !reverse && intf->peer )
+        intf = intf->peer;
+
+    if ( !intf->tx_ring )
+        return DAQ_ERROR;
+
+    err = tp_queue(intf, data, len);
+
+    if ( err )
+    {
+        snprintf(tc->errbuf, sizeof(tc->errbuf),
+            "%s: can't queue %u bytes on %s", __FUNCTION__, len, intf->name);
+        return err;
+    }
+    if ( !tc->in_acquire )
+        tp_kick(intf);
+
+    tc->stats.packets_injected++;
+    return DAQ_SUCCESS;
+}
+
+static int tp_daq_breakloop (void* handle)
+{
+    TpContext* tc = (TpContext*)handle;
+    tc->brk = 1;
+    return DAQ_SUCCESS;
+}
+
+static void tp_daq_shutdown (void* handle)
+{
+    TpContext* tc = (TpContext*)handle;
+
+    if ( tc->state == DAQ_STATE_STARTED )
+        tp_daq_stop(tc);
+
+    if ( tc->have_filter )
+        pcap_freecode(&tc->fcode);
+
+    free(tc);
+}
+
+static DAQ_State tp_daq_check_status (void* handle)
+{
+    return ((TpContext*)handle)->state;
+}
+
+static int tp_daq_get_stats (void* handle, DAQ_Stats_t* stats)
+{
+    TpContext* tc = (TpContext*)handle;
+    unsigned i;
+
+    // the kernel counters reset on each read so they are accumulated
+    for ( i = 0; i < tc->num_intfs; i++ )
+    {
+        struct tpacket_stats_v3 kstats;
+        socklen_t len = sizeof(kstats);
+
+        if ( tc->intf[i].rx_fd < 0 )
+            continue;
+
+        if ( !getsockopt(tc->intf[i].rx_fd, SOL_PACKET, PACKET_STATISTICS, &kstats, &len) )
+        {
+            tc->stats.hw_packets_received += kstats.tp_packets;
+            tc->stats.hw_packets_dropped += kstats.tp_drops;
+        }
+    }
+    *stats = tc->stats;
+    return DAQ_SUCCESS;
+}
+
+static void tp_daq_reset_stats (void* handle)
+{
+    TpContext* tc = (TpContext*)handle;
+    DAQ_Stats_t dummy;
+
+    tp_daq_get_stats(handle, &dummy);
+    memset(&tc->stats, 0, sizeof(tc->stats));
+}
+
+static int tp_daq_get_snaplen (void* handle)
+{
+    return ((TpContext*)handle)->snaplen;
+}
+
+static uint32_t tp_daq_get_capabilities (void* handle)
+{
+    return DAQ_CAPA_BLOCK | DAQ_CAPA_REPLACE | DAQ_CAPA_INJECT |
+        DAQ_CAPA_BREAKLOOP | DAQ_CAPA_BPF | DAQ_CAPA_DEVICE_INDEX;
+}
+
+static int tp_daq_get_datalink_type (void* handle)
+{
+    return DLT_EN10MB;
+}
+
+static const char* tp_daq_get_errbuf (void* handle)
+{
+    return ((TpContext*)handle)->errbuf;
+}
+
+static void tp_daq_set_errbuf (void* handle, const char* s)
+{
+    TpContext* tc = (TpContext*)handle;
+    snprintf(tc->errbuf, sizeof(tc->errbuf), "%s", s ? s : "");
+}
+
+static int tp_daq_get_device_index (void* handle, const char* device)
+{
+    TpContext* tc = (TpContext*)handle;
+    unsigned i;
+
+    for ( i = 0; i < tc->num_intfs; i++ )
+    {
+        if ( !strcmp(device, tc->intf[i].name) )
+            return tc->intf[i].index;
+    }
+    return DAQ_ERROR_NODEV;
+}
+
+// designated initializers since the trailing members vary by daq version
+static const DAQ_Module_t tpacket_daq_module =
+{
+    .api_version = DAQ_API_VERSION,
+    .module_version = TPACKET_DAQ_VERSION,
+    .name = TPACKET_DAQ_NAME,
+    .type = DAQ_TYPE_INTF_CAPABLE | DAQ_TYPE_INLINE_CAPABLE |
+        DAQ_TYPE_MULTI_INSTANCE | DAQ_TYPE_NO_UNPRIV,
+    .initialize = tp_daq_initialize,
+    .set_filter = tp_daq_set_filter,
+    .start = tp_daq_start,
+    .acquire = tp_daq_acquire,
+    .inject = tp_daq_inject,
+    .breakloop = tp_daq_breakloop,
+    .stop = tp_daq_stop,
+    .shutdown = tp_daq_shutdown,
+    .check_status = tp_daq_check_status,
+    .get_stats = tp_daq_get_stats,
+    .reset_stats = tp_daq_reset_stats,
+    .get_snaplen = tp_daq_get_snaplen,
+    .get_capabilities = tp_daq_get_capabilities,
+    .get_datalink_type = tp_daq_get_datalink_type,
+    .get_errbuf = tp_daq_get_errbuf,
+    .set_errbuf = tp_daq_set_errbuf,
+    .get_device_index = tp_daq_get_device_index,
+};
+
+const DAQ_Module_t* TPACKET_DAQ_GetModule (void)
+{
+    return &tpacket_daq_module;
+}
+
+uint64_t TPACKET_DAQ_GetTxDropped (void)
+{
+    return tp_tx_dropped;
+}
+
+#else
+
+const DAQ_Module_t* TPACKET_DAQ_GetModule (void)
+{
+    return NULL;
+}
+
+uint64_t TPACKET_DAQ_GetTxDropped (void)
+{
+    return 0;
+}
+
+#endif
+
@@ -0,0 +1,44 @@
+/* $Id$ */
+/****************************************************************************
+ *
+ * Copyright (C) 2005-2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ ****************************************************************************/
+
+// @file    sfdaq_tpacket.h
+//
+// built-in linux capture module using AF_PACKET TPACKET_V3 rx rings and
+// TPACKET_V2 tx rings.  it plugs in behind sfdaq.c like any other daq
+// module and is selected with --daq tpacket.  see README.daq.
+
+#ifndef __SFDAQ_TPACKET_H__
+#define __SFDAQ_TPACKET_H__
+
+#include <daq.h>
+
+#define TPACKET_DAQ_NAME     "tpacket"
+#define TPACKET_DAQ_VERSION  1
+
+// returns NULL if the module isn't available on this platform
+const DAQ_Module_t* TPACKET_DAQ_GetModule(void);
+
+// forwarded and injected frames lost to a full or too small tx ring
+uint64_t TPACKET_DAQ_GetTxDropped(void);
+
+#endif // __SFDAQ_TPACKET_H__
+
@@ -427,6 +427,37 @@ void sfxhash_save_free_node( SFXHASH *t, SFXHASH_NODE * hnode )
     }
 }
 
+/*!
+ *  Preallocate nodes onto the free list so that later adds don't have to
+ *  allocate.  Only useful when the table recycles nodes; the nodes are
+ *  charged against the memcap up front.
+ *
+ * @param t SFXHASH table pointer
+ * @param n number of nodes to preallocate
+ *
+ * @return number of nodes actually preallocated (less than n if the
+ *         memcap was reached)
+ */
+int sfxhash_prealloc( SFXHASH *t, int n )
+{
+    SFXHASH_NODE * hnode;
+    int i;
+
+    if( !t || !t->recycle_nodes )
+        return 0;
+
+    for( i = 0; i < n; i++ )
+    {
+        hnode = (SFXHASH_NODE*)s_alloc( t, sizeof(SFXHASH_NODE) +
+                                     t->keysize + t->datasize );
+        if( !hnode )
+            break;
+
+        sfxhash_save_free_node( t, hnode );
+    }
+    return i;
+}
+
 /**Get a previously freed node for reuse.
  */
 static
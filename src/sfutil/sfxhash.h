@@ -112,6 +112,7 @@ SFXHASH       * sfxhash_new( int nrows, int keysize, int datasize, unsigned long
                              int recycle_flag );
 
 void            sfxhash_set_max_nodes( SFXHASH *h, int max_nodes );
+int             sfxhash_prealloc( SFXHASH *h, int n );
 
 void            sfxhash_delete( SFXHASH * h );
 int             sfxhash_make_empty(SFXHASH *);
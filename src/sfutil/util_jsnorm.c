@@ -1221,7 +1221,7 @@ static int JSNorm_scan_fsm (JSNormState* s, int c, char *src, uint16_t srclen, c
 
 int JSNormalizeDecode(char *src, uint16_t srclen, char *dst, uint16_t destlen, char **ptr, int *bytes_copied, JSState *js, int *iis_unicode_map)
 {
-    int iRet;
+    int iRet = RET_OK;
     const char *start, *end;
     JSNormState s;
 
@@ -1242,6 +1242,15 @@ int JSNormalizeDecode(char *src, uint16_t srclen, char *dst, uint16_t destlen, c
     s.unicode_map = iis_unicode_map;
     s.num_spaces = 0;
 
+    /* continuing a script from the previous buffer.  anything saved for
+     * overwrite has already been handed back so it can't be rewound. */
+    if(js->resume && js->resume->in_script)
+    {
+        s.fsm = js->resume->fsm;
+        s.prev_event = js->resume->prev_event;
+        s.num_spaces = js->resume->num_spaces;
+    }
+
     while(!outBounds(start, end, *ptr))
     {
         iRet = JSNorm_scan_fsm(&s, **ptr, src, srclen, ptr, js);
@@ -1257,6 +1266,14 @@ int JSNormalizeDecode(char *src, uint16_t srclen, char *dst, uint16_t destlen, c
         (*ptr)++;
     }
 
+    if(js->resume)
+    {
+        js->resume->in_script = (iRet != RET_QUIT);
+        js->resume->fsm = s.fsm;
+        js->resume->prev_event = s.prev_event;
+        js->resume->num_spaces = s.num_spaces;
+    }
+
     dst = s.dest.data;
     *bytes_copied = s.dest.len;
 
@@ -35,10 +35,21 @@
 
 #define MAX_ALLOWED_OBFUSCATION 1
 
+/* Where the normalizer stopped when the buffer ran out inside a script.
+ * Kept by the caller (per response) so the next buffer picks up in the
+ * same state instead of waiting for another <script> tag. */
+typedef struct {
+    uint8_t in_script;
+    uint8_t fsm;
+    uint8_t prev_event;
+    uint16_t num_spaces;
+}JSResume;
+
 typedef struct {
     int allowed_spaces;
     int allowed_levels;
     uint16_t alerts;
+    JSResume *resume;   /* NULL to normalize each buffer on its own */
 }JSState;
 
 int JSNormalizeDecode(char *, uint16_t , char *, uint16_t destlen, char **, int *, JSState *, int *);
@@ -22,6 +22,7 @@
 #ifndef UTIL_UTF_H
 #define UTIL_UTF_H
 
+#include "sf_types.h"
 
 /* return codes */
 #define DECODE_UTF_SUCCESS 0
@@ -41,8 +42,8 @@
    state between subsequent calls. */
 typedef struct decode_utf_state
 {
-    int state;
-    int charset;
+    uint8_t state;
+    uint8_t charset;
 } decode_utf_state_t;
 
 /* Init & Terminate functions for decode_utf_state_t. */
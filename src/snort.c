@@ -87,6 +87,7 @@
 #include "encode.h"
 #include "sfdaq.h"
 #include "active.h"
+#include "flow_bypass.h"
 #include "snort.h"
 #include "rules.h"
 #include "treenodes.h"
@@ -296,6 +297,7 @@ grinder_t grinder;
 
 /* Locals/Private ************************************************************/
 static long int pcap_loop_count = 0;
+static unsigned pcap_shard = 0, pcap_shards = 0;
 static SF_QUEUE *pcap_save_queue = NULL;
 
 #if defined(INLINE_FAILOPEN) && !defined(WIN32)
@@ -421,6 +423,7 @@ static struct option long_options[] =
    {"pcap-loop", LONGOPT_ARG_REQUIRED, NULL, PCAP_LOOP},
    {"pcap-reset", LONGOPT_ARG_NONE, NULL, PCAP_RESET},
    {"pcap-show", LONGOPT_ARG_NONE, NULL, PCAP_SHOW},
+   {"pcap-shard", LONGOPT_ARG_REQUIRED, NULL, PCAP_SHARD},
 
 #ifdef EXIT_CHECK
    {"exit-check", LONGOPT_ARG_REQUIRED, NULL, ARG_EXIT_CHECK},
@@ -951,6 +954,37 @@ static void PQ_Multi (char type, const char* list)
         FatalError("Could not add pcap object to list: %s\n", list);
 }
 
+// keep every nth pcap starting with the kth so that n instances given
+// the same list each read a disjoint share of it
+static void PQ_Shard (void)
+{
+    SF_QUEUE* keep;
+    char* pcap;
+    unsigned i = 0;
+
+    if ( pcap_shards < 2 )
+        return;
+
+    keep = sfqueue_new();
+
+    if ( !keep )
+        FatalError("Could not allocate pcap queue.\n");
+
+    while ( (pcap = (char*)sfqueue_remove(pcap_queue)) )
+    {
+        if ( (i++ % pcap_shards) != pcap_shard - 1 )
+            free(pcap);
+
+        else if ( sfqueue_add(keep, (NODE_DATA)pcap) == -1 )
+            FatalError("Could not add pcap to shard list\n");
+    }
+    sfqueue_free(pcap_queue);
+    pcap_queue = keep;
+
+    LogMessage("Reading %d of %u pcaps (shard %u/%u).\n",
+        sfqueue_count(pcap_queue), i, pcap_shard, pcap_shards);
+}
+
 static void PQ_SetUp (void)
 {
     if (pcap_object_list != NULL)
@@ -972,6 +1006,11 @@ static void PQ_SetUp (void)
         if (sfqueue_count(pcap_queue) == 0)
             FatalError("No pcaps found.\n");
 
+        PQ_Shard();
+
+        if (sfqueue_count(pcap_queue) == 0)
+            FatalError("No pcaps in shard %u/%u.\n", pcap_shard, pcap_shards);
+
         /* free pcap list used to get params */
         while (sflist_count(pcap_object_list) > 0)
         {
@@ -1532,9 +1571,16 @@ static DAQ_Verdict PacketCallback(
 #endif
         else
         {
-            if ((p.packet_flags & PKT_IGNORE_PORT) ||
+            if ( p.packet_flags & PKT_FAST_PATH )
+            {
+                // already decided in ProcessPacket()
+            }
+            else if ((p.packet_flags & PKT_IGNORE_PORT) ||
                 (stream_api && (stream_api->get_ignore_direction(p.ssnptr) == SSN_DIR_BOTH)))
             {
+                if ( !(p.packet_flags & PKT_IGNORE_PORT) && FlowBypass_IsEnabled() )
+                    FlowBypass_Add(&p);
+
                 if ( !Active_GetTunnelBypass() )
                     verdict = DAQ_VERDICT_WHITELIST;
                 else
@@ -1562,6 +1608,39 @@ static DAQ_Verdict PacketCallback(
     return verdict;
 }
 
+// ethernet bursts are first staged through their L2 and L3 headers so
+// the full per-frame decode finds them in cache; otherwise the next
+// frame's headers are prefetched while the current one is processed.
+// the daq shim only builds multi-frame bursts in passive and read-file
+// modes (see sfdaq.h)
+static void PacketBurstCallback(
+    void* user, unsigned n, const DAQ_PktHdr_t** pkthdrs,
+    const uint8_t** pkts, DAQ_Verdict* verdicts)
+{
+    int staged = ( n > 1 && grinder == DecodeEthPkt );
+    unsigned i;
+
+    if ( staged )
+        DecodeEthBurstStages(n, pkthdrs, pkts);
+
+    for ( i = 0; i < n; i++ )
+    {
+#ifdef __GNUC__
+        if ( !staged && i + 1 < n )
+        {
+            __builtin_prefetch(pkthdrs[i+1]);
+            __builtin_prefetch(pkts[i+1]);
+            __builtin_prefetch(pkts[i+1] + 64);
+        }
+#endif
+        verdicts[i] = PacketCallback(user, pkthdrs[i], pkts[i]);
+    }
+#ifdef ACTIVE_RESPONSE
+    // the headers are still valid and no verdict has been rendered yet
+    Active_FlushQueue();
+#endif
+}
+
 static void PrintPacket(Packet *p)
 {
     if (p->iph != NULL)
@@ -1599,6 +1678,15 @@ DAQ_Verdict ProcessPacket(
         return verdict;
     }
 
+    /* flows that need no further inspection skip everything else */
+    if ( !ft && FlowBypass_IsEnabled() && FlowBypass_Check(p) )
+    {
+        if ( DAQ_CanWhitelist() && !Active_GetTunnelBypass() )
+            return DAQ_VERDICT_WHITELIST;
+
+        return DAQ_VERDICT_PASS;
+    }
+
     /* Make sure this packet skips the rest of the preprocessors */
     /* Remove once the IPv6 frag code is moved into frag 3 */
     if(p->packet_flags & PKT_NO_DETECT)
@@ -1799,6 +1887,7 @@ static int ShowUsage(char *program_name)
                 "                                   for <count> times.  A value of 0 will read until Snort is terminated.\n");
     FPUTS_BOTH ("   --pcap-reset                    if reading multiple pcaps, reset snort to post-configuration state before reading next pcap.\n");
     FPUTS_BOTH ("   --pcap-show                     print a line saying what pcap is currently being read.\n");
+    FPUTS_BOTH ("   --pcap-shard <k>/<n>            read only every nth pcap starting with the kth, for running n instances on one list.\n");
     FPUTS_BOTH ("   --exit-check <count>            Signal termination after <count> callbacks from DAQ_Acquire(), showing the time it\n"
                 "                                   takes from signaling until DAQ_Stop() is called.\n");
     FPUTS_BOTH ("   --conf-error-out                Same as -x\n");
@@ -2567,6 +2656,25 @@ static void ParseCmdLine(int argc, char **argv)
             case PCAP_SHOW:
                 sc->run_flags |= RUN_FLAG__PCAP_SHOW;
                 break;
+
+            case PCAP_SHARD:
+                {
+                    unsigned long k = SnortStrtoul(optarg, &endptr, 10);
+                    unsigned long n = 0;
+
+                    if ( (errno != ERANGE) && (*endptr == '/') )
+                        n = SnortStrtoul(endptr + 1, &endptr, 10);
+
+                    if ( (errno == ERANGE) || (*endptr != '\0') ||
+                        (k < 1) || (n < 1) || (k > n) || (n > 65535) )
+                    {
+                        FatalError("--pcap-shard must be <k>/<n> with "
+                            "1 <= k <= n <= 65535\n");
+                    }
+                    pcap_shard = (unsigned)k;
+                    pcap_shards = (unsigned)n;
+                }
+                break;
 #ifdef MPLS
             case ENABLE_MPLS_MULTICAST:
                 ConfigEnableMplsMulticast(sc, NULL);
@@ -2929,7 +3037,7 @@ void PacketLoop (void)
 
     while ( !exit_logged )
     {
-        error = DAQ_Acquire(pkts_to_read, PacketCallback, NULL);
+        error = DAQ_AcquireBurst(pkts_to_read, PacketBurstCallback, NULL);
 
         if ( error )
         {
@@ -3239,6 +3347,10 @@ static void SnortCleanup(int exit_val)
 #ifdef EXIT_CHECK
         if (snort_conf->exit_check)
             ExitCheckEnd();
+#endif
+#ifdef ACTIVE_RESPONSE
+        // last chance to inject responses still waiting in the queue
+        Active_FlushQueue();
 #endif
         DAQ_Stop();
     }
@@ -3342,6 +3454,7 @@ static void SnortCleanup(int exit_val)
     Active_Term();
     Encode_Term();
 #endif
+    FlowBypass_Term();
 
 
     CleanupProtoNames();
@@ -3718,6 +3831,9 @@ SnortConfig * SnortConfNew(void)
 
     sc->checksum_flags = CHECKSUM_FLAG__ALL;
     sc->tagged_packet_limit = 256;
+#ifdef ACTIVE_RESPONSE
+    sc->respond_queue = DEFAULT_RESPOND_QUEUE;
+#endif
     sc->default_rule_state = RULE_STATE_ENABLED;
     sc->pcre_match_limit = 1500;
     sc->pcre_match_limit_recursion = 1500;
@@ -4821,6 +4937,7 @@ static void SnortUnprivilegedInit(void)
     // so it is done here instead of SnortInit()
     Active_Init(snort_conf);
 #endif
+    FlowBypass_Init(snort_conf);
 
     InitPidChrootAndPrivs(snort_main_thread_pid);
 
@@ -5356,7 +5473,9 @@ static int VerifyReload(SnortConfig *sc)
 
 #ifdef ACTIVE_RESPONSE
     if ( sc->respond_attempts != snort_conf->respond_attempts ||
-         sc->respond_device != snort_conf->respond_device )
+         sc->respond_device != snort_conf->respond_device ||
+         sc->respond_queue != snort_conf->respond_queue ||
+         sc->respond_rate != snort_conf->respond_rate )
     {
         ErrorMessage("Snort Reload: Changing config response "
                      "requires a restart.\n");
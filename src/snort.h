@@ -255,6 +255,7 @@ typedef enum _GetOptLongIds
     PCAP_NO_FILTER,
     PCAP_RESET,
     PCAP_SHOW,
+    PCAP_SHARD,
 
 #define EXIT_CHECK  // allow for rollback for now
 #ifdef EXIT_CHECK
@@ -716,6 +717,7 @@ typedef struct _SnortConfig
     char* daq_mode;          /* --daq-mode or config daq_mode */
     void* daq_vars;          /* --daq-var or config daq_var */
     void* daq_dirs;          /* --daq-dir or config daq_dir */
+    uint32_t daq_burst;      /* config daq_burst */
 
     char* event_trace_file;
     uint16_t event_trace_max;
@@ -760,6 +762,8 @@ typedef struct _SnortConfig
 #ifdef ACTIVE_RESPONSE
     uint8_t respond_attempts;    /* config respond */
     char* respond_device;
+    uint32_t respond_queue;      /* response slots, 0 = send immediately */
+    uint32_t respond_rate;       /* max responses per second, 0 = no limit */
     uint8_t *eth_dst;        /* config destination MAC address */
 #endif
 
@@ -871,6 +875,8 @@ typedef struct _SnortConfig
 
     uint32_t so_rule_memcap;
     uint32_t paf_max;          /* config paf_max */
+    uint32_t flow_bypass_entries;  /* config flow_bypass */
+    uint32_t flow_bypass_timeout;
     char *cs_dir;
     char *output_dir;
     void *file_config;
@@ -1009,6 +1015,21 @@ typedef struct _PacketCount
     uint64_t internal_blacklist;
     uint64_t internal_whitelist;
 
+    uint64_t flow_bypass_adds;
+    uint64_t flow_bypass_hits;
+
+    uint64_t hw_tcp_cksums;     /* tcp checksums verified by the nic */
+
+    uint64_t ip_opts;           /* packets with ip options */
+    uint64_t ip_opts_decoded;   /* ... where the option array was accessed */
+    uint64_t tcp_opts;
+    uint64_t tcp_opts_decoded;
+
+    uint64_t rsp_queued;        /* active responses deferred for batching */
+    uint64_t rsp_sent;
+    uint64_t rsp_dropped;       /* rate limited or failed to inject */
+    uint64_t rsp_discarded;     /* still queued at exit */
+
 } PacketCount;
 
 typedef struct _PcapReadObject
@@ -69,6 +69,7 @@
 #include "util.h"
 #include "parser.h"
 #include "sfdaq.h"
+#include "sfdaq_tpacket.h"
 #include "build.h"
 #include "plugbase.h"
 #include "sf_types.h"
@@ -1039,7 +1040,7 @@ void DropStats(int exiting)
 #endif
 
     {
-        uint64_t pkts_drop, pkts_out, pkts_inj;
+        uint64_t pkts_drop, pkts_out, pkts_inj, tx_drop;
 
         pkts_recv = pkt_stats->hw_packets_received;
         pkts_drop = pkt_stats->hw_packets_dropped;
@@ -1065,6 +1066,12 @@ void DropStats(int exiting)
         LogStat("Filtered", pkt_stats->packets_filtered, pkts_recv);
         LogStat("Outstanding", pkts_out, pkts_recv);
         LogCount("Injected", pkts_inj);
+
+        // only the tpacket daq tracks frames lost on transmit
+        tx_drop = TPACKET_DAQ_GetTxDropped();
+
+        if ( tx_drop )
+            LogCount("Tx Dropped", tx_drop);
     }
 
     LogMessage("%s\n", STATS_SEPARATOR);
@@ -1129,6 +1136,9 @@ void DropStats(int exiting)
 
     LogStat("Other", pc.other, total);
     LogStat("Bad Chk Sum", pc.invalid_checksums, total);
+
+    if ( pc.hw_tcp_cksums )
+        LogStat("HW Chk Sum", pc.hw_tcp_cksums, total);
     LogStat("Bad TTL", pc.bad_ttl, total);
 
     LogStat("S5 G 1", pc.s5tcp1, total);
@@ -1136,6 +1146,16 @@ void DropStats(int exiting)
 
     LogCount("Total", total);
 
+    if ( pc.ip_opts || pc.tcp_opts )
+    {
+        // options are only parsed into the packet arrays on first access
+        LogMessage("%s\n", STATS_SEPARATOR);
+        LogMessage("Options never materialized:\n");
+
+        LogStat("IP4 Opts", pc.ip_opts - pc.ip_opts_decoded, pc.ip_opts);
+        LogStat("TCP Opts", pc.tcp_opts - pc.tcp_opts_decoded, pc.tcp_opts);
+    }
+
     if ( !ScPacketDumpMode() && !ScPacketLogMode() )
     {
         int i;
@@ -1171,7 +1191,25 @@ void DropStats(int exiting)
 
         if ( pc.internal_whitelist > 0 )
             LogStat("Int Whtlst", pc.internal_whitelist, pkts_recv);
+
+        if ( pc.flow_bypass_hits > 0 )
+        {
+            LogCount("Bypass Add", pc.flow_bypass_adds);
+            LogStat("Bypass Hit", pc.flow_bypass_hits, pkts_recv);
+        }
+    }
+#ifdef ACTIVE_RESPONSE
+    if ( pc.rsp_sent || pc.rsp_dropped || pc.rsp_discarded )
+    {
+        LogMessage("%s\n", STATS_SEPARATOR);
+        LogMessage("Active Responses:\n");
+
+        LogCount("Queued", pc.rsp_queued);
+        LogCount("Sent", pc.rsp_sent);
+        LogCount("Dropped", pc.rsp_dropped);
+        LogCount("Discarded", pc.rsp_discarded);
     }
+#endif
 #ifdef TARGET_BASED
     if (ScIdsMode() && IsAdaptiveConfigured(getDefaultPolicy(), 0))
     {
@@ -0,0 +1,387 @@
+/*
+ * Copyright (C) 2013 Sourcefire, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License Version 2 as
+ * published by the Free Software Foundation.  You may not use, modify or
+ * distribute this program under any other version of the GNU General
+ * Public License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/*
+ * fragflood writes a pcap of fragmented IPv4/UDP datagrams for
+ * benchmarking frag3, eg with snort -r fragflood.pcap and the frag3
+ * profile stats.  The fragments of each datagram can be sent in order,
+ * in reverse, shuffled or shuffled with overlaps and duplicates.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define FAILURE -1
+#define SUCCESS 0
+
+#define PCAP_MAGIC_NUMBER 0xa1b2c3d4
+#define PCAP_VERSION_MAJOR 2
+#define PCAP_VERSION_MINOR 4
+#define PCAP_SNAPLEN 65535
+#define PCAP_LINKTYPE 1 /* ethernet */
+
+#define ETH_HDR_LEN 14
+#define IP_HDR_LEN 20
+#define UDP_HDR_LEN 8
+#define IP_MAXPACKET 65535
+#define MAX_DATA (IP_MAXPACKET - IP_HDR_LEN)
+
+#define MODE_INORDER 0
+#define MODE_REVERSE 1
+#define MODE_RANDOM  2
+#define MODE_OVERLAP 3
+
+typedef struct _FragFloodConfig
+{
+    int mode;
+    unsigned datagrams;
+    unsigned frags;     /* fragments per datagram */
+    unsigned frag_size; /* payload bytes per fragment, multiple of 8 */
+    unsigned repeat;    /* times each fragment is sent in overlap mode */
+    unsigned seed;
+} FragFloodConfig;
+
+/* the on disk record header, independent of the host's struct timeval */
+typedef struct _PcapRecord
+{
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t caplen;
+    uint32_t len;
+} PcapRecord;
+
+typedef struct _PcapFileHeader
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} PcapFileHeader;
+
+typedef struct _Frag
+{
+    unsigned offset;
+    unsigned len;
+    int more;
+} Frag;
+
+static uint32_t ts_usec = 0;
+
+static uint16_t IpChecksum(const uint8_t *hdr, int len)
+{
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < len; i += 2)
+        sum += (hdr[i] << 8) | hdr[i+1];
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return (uint16_t)~sum;
+}
+
+static int PcapInitOutput(FILE *output)
+{
+    PcapFileHeader hdr;
+
+    hdr.magic = PCAP_MAGIC_NUMBER;
+    hdr.version_major = PCAP_VERSION_MAJOR;
+    hdr.version_minor = PCAP_VERSION_MINOR;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = PCAP_SNAPLEN;
+    hdr.linktype = PCAP_LINKTYPE;
+
+    if (fwrite(&hdr, sizeof(hdr), 1, output) < 1)
+    {
+        fprintf(stderr, "Error: Unable to write pcap file header\n");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Write one fragment of datagram 'id' covering data[f->offset, +f->len) */
+static int WriteFrag(FILE *output, uint16_t id, const uint8_t *data,
+                     const Frag *f)
+{
+    uint8_t pkt[ETH_HDR_LEN + IP_HDR_LEN + MAX_DATA];
+    uint8_t *ip = pkt + ETH_HDR_LEN;
+    unsigned ip_len = IP_HDR_LEN + f->len;
+    uint16_t off = (uint16_t)(f->offset >> 3);
+    uint16_t csum;
+    PcapRecord rec;
+
+    /* 00:00:00:00:00:02 <- 00:00:00:00:00:01, IPv4 */
+    memset(pkt, 0, ETH_HDR_LEN);
+    pkt[5] = 2;
+    pkt[11] = 1;
+    pkt[12] = 0x08;
+
+    if (f->more)
+        off |= 0x2000;
+
+    ip[0] = 0x45;
+    ip[1] = 0;
+    ip[2] = ip_len >> 8;
+    ip[3] = ip_len & 0xff;
+    ip[4] = id >> 8;
+    ip[5] = id & 0xff;
+    ip[6] = off >> 8;
+    ip[7] = off & 0xff;
+    ip[8] = 64;
+    ip[9] = 17;
+    ip[10] = ip[11] = 0;
+    ip[12] = 10; ip[13] = 1; ip[14] = 0; ip[15] = 1;
+    ip[16] = 10; ip[17] = 2; ip[18] = 0; ip[19] = 1;
+    csum = IpChecksum(ip, IP_HDR_LEN);
+    ip[10] = csum >> 8;
+    ip[11] = csum & 0xff;
+
+    memcpy(ip + IP_HDR_LEN, data + f->offset, f->len);
+
+    rec.ts_sec = 1 + ts_usec / 1000000;
+    rec.ts_usec = ts_usec % 1000000;
+    rec.caplen = rec.len = ETH_HDR_LEN + ip_len;
+    ts_usec++;
+
+    if ((fwrite(&rec, sizeof(rec), 1, output) < 1) ||
+        (fwrite(pkt, rec.caplen, 1, output) < 1))
+    {
+        fprintf(stderr, "Error: Unable to write packet\n");
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+static void Shuffle(Frag *frags, unsigned n)
+{
+    unsigned i;
+
+    for (i = n - 1; i > 0; i--)
+    {
+        unsigned j = (unsigned)rand() % (i + 1);
+        Frag tmp = frags[i];
+        frags[i] = frags[j];
+        frags[j] = tmp;
+    }
+}
+
+/* Build the fragment list of one datagram in send order */
+static unsigned BuildFrags(const FragFloodConfig *cfg, unsigned total,
+                           Frag *frags)
+{
+    unsigned i, r, n = 0;
+
+    for (i = 0; i < cfg->frags; i++)
+    {
+        Frag f;
+
+        f.offset = i * cfg->frag_size;
+        f.len = cfg->frag_size;
+
+        /* overlapping fragments run into the next one */
+        if (cfg->mode == MODE_OVERLAP)
+            f.len *= 2;
+
+        if (f.offset + f.len >= total)
+            f.len = total - f.offset;
+
+        f.more = (f.offset + f.len < total);
+
+        for (r = 0; r < ((cfg->mode == MODE_OVERLAP) ? cfg->repeat : 1); r++)
+            frags[n++] = f;
+    }
+
+    if (cfg->mode == MODE_REVERSE)
+    {
+        for (i = 0; i < n / 2; i++)
+        {
+            Frag tmp = frags[i];
+            frags[i] = frags[n - 1 - i];
+            frags[n - 1 - i] = tmp;
+        }
+    }
+    else if (cfg->mode >= MODE_RANDOM)
+    {
+        Shuffle(frags, n);
+    }
+
+    return n;
+}
+
+static int FragFlood(const FragFloodConfig *cfg, FILE *output)
+{
+    uint8_t data[MAX_DATA];
+    unsigned total = cfg->frags * cfg->frag_size;
+    unsigned d, i, n;
+    Frag *frags;
+
+    frags = malloc(cfg->frags * cfg->repeat * sizeof(Frag));
+    if (frags == NULL)
+    {
+        fprintf(stderr, "Error allocating memory, aborting...\n");
+        return FAILURE;
+    }
+
+    for (i = 0; i < total; i++)
+        data[i] = (uint8_t)i;
+
+    /* udp header, 9 -> 9, no checksum */
+    data[0] = 0; data[1] = 9;
+    data[2] = 0; data[3] = 9;
+    data[4] = total >> 8;
+    data[5] = total & 0xff;
+    data[6] = data[7] = 0;
+
+    if (PcapInitOutput(output) == FAILURE)
+    {
+        free(frags);
+        return FAILURE;
+    }
+
+    for (d = 0; d < cfg->datagrams; d++)
+    {
+        n = BuildFrags(cfg, total, frags);
+
+        for (i = 0; i < n; i++)
+        {
+            if (WriteFrag(output, (uint16_t)d, data, &frags[i]) == FAILURE)
+            {
+                free(frags);
+                return FAILURE;
+            }
+        }
+    }
+
+    free(frags);
+    return SUCCESS;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+        "Usage: fragflood [-m mode] [-n datagrams] [-f frags] [-s size]\n"
+        "                 [-r repeat] [-S seed] <outfile>\n"
+        "  -m  inorder, reverse, random or overlap (default random)\n"
+        "  -n  number of datagrams (default 1000)\n"
+        "  -f  fragments per datagram (default 64)\n"
+        "  -s  payload bytes per fragment, a multiple of 8 (default 8)\n"
+        "  -r  copies of each fragment in overlap mode (default 2)\n"
+        "  -S  random seed (default 1)\n");
+}
+
+int main (int argc, char *argv[])
+{
+    FragFloodConfig cfg;
+    FILE *output_file;
+    int c, ret;
+
+    cfg.mode = MODE_RANDOM;
+    cfg.datagrams = 1000;
+    cfg.frags = 64;
+    cfg.frag_size = 8;
+    cfg.repeat = 2;
+    cfg.seed = 1;
+    opterr = 0;
+
+    while ((c = getopt (argc, argv, "m:n:f:s:r:S:")) != -1)
+    {
+        switch (c)
+        {
+            case 'm':
+                if (!strcasecmp(optarg, "inorder"))
+                    cfg.mode = MODE_INORDER;
+                else if (!strcasecmp(optarg, "reverse"))
+                    cfg.mode = MODE_REVERSE;
+                else if (!strcasecmp(optarg, "random"))
+                    cfg.mode = MODE_RANDOM;
+                else if (!strcasecmp(optarg, "overlap"))
+                    cfg.mode = MODE_OVERLAP;
+                else
+                {
+                    fprintf(stderr, "Invalid mode: %s\n", optarg);
+                    return FAILURE;
+                }
+                break;
+            case 'n':
+                cfg.datagrams = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                cfg.frags = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                cfg.frag_size = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                cfg.repeat = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case 'S':
+                cfg.seed = (unsigned)strtoul(optarg, NULL, 0);
+                break;
+            case '?':
+                if (isprint (optopt))
+                    fprintf(stderr, "Unknown option or missing argument -%c.\n",
+                            optopt);
+                Usage();
+                return FAILURE;
+            default:
+                abort();
+        }
+    }
+
+    if (optind != (argc - 1))
+    {
+        Usage();
+        return FAILURE;
+    }
+
+    if (!cfg.frags || !cfg.repeat || !cfg.frag_size || (cfg.frag_size & 7) ||
+        (cfg.frags * cfg.frag_size < UDP_HDR_LEN) ||
+        (cfg.frags * cfg.frag_size > MAX_DATA))
+    {
+        fprintf(stderr, "Error: frags * size must fit in one datagram and "
+                "size must be a multiple of 8.\n");
+        return FAILURE;
+    }
+
+    output_file = fopen(argv[optind], "wb");
+    if (output_file == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open output file %s\n", argv[optind]);
+        return FAILURE;
+    }
+
+    srand(cfg.seed);
+    ret = FragFlood(&cfg, output_file);
+
+    fclose(output_file);
+    return ret;
+}